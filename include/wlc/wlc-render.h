@@ -42,6 +42,7 @@ WLC_NONULL void wlc_surface_render(wlc_resource surface, const struct wlc_geomet
 /**
  * Schedules output for rendering next frame. If output was already scheduled this is no-op,
  * if output is currently rendering, it will render immediately after.
+ * The whole output is repainted, otherwise wlc only repaints areas damaged by surfaces and views.
  */
 void wlc_output_schedule_render(wlc_handle output);
 
@@ -56,7 +57,8 @@ void wlc_surface_flush_frame_callbacks(wlc_resource surface);
 /** Enabled renderers */
 enum wlc_renderer {
     WLC_RENDERER_GLES2,
-    WLC_NO_RENDERER
+    WLC_NO_RENDERER,
+    WLC_RENDERER_PIXMAN
 };
 
 /** Returns currently active renderer on the given output */
@@ -30,6 +30,7 @@ enum wlc_backend_type {
    WLC_BACKEND_DRM,
    WLC_BACKEND_X11,
    WLC_BACKEND_WAYLAND,
+   WLC_BACKEND_HEADLESS,
 };
 
 /** mask in wlc_event_loop_add_fd(); */
@@ -159,6 +160,24 @@ struct wlc_modifiers {
    uint32_t leds, mods;
 };
 
+/** Buckets of wlc_frame_stats histogram. Bucket N counts repaints faster than 0.25ms * 2^N, last bucket counts the rest. */
+#define WLC_FRAME_STATS_BUCKETS 12
+
+/** Frames wlc_frame_stats histogram covers. */
+#define WLC_FRAME_STATS_WINDOW 256
+
+/** Frame statistics of output in wlc_output_get_frame_stats(). Times are in nanoseconds, zero if not measured. */
+struct wlc_frame_stats {
+   uint64_t frames; // frames repainted
+   uint64_t missed; // frames that reached the screen later than the vblank they were scheduled for
+   uint64_t repaint, repaint_max; // CPU time of the last repaint, and the slowest one
+   uint64_t hooks; // part of the last repaint spent in render callbacks
+   uint64_t gpu; // GPU time of the most recently measured frame, needs GL_EXT_disjoint_timer_query
+   uint64_t flip; // from the end of the last repaint to the frame reaching the screen
+   uint32_t views, subsurfaces; // drawn in the last frame
+   uint32_t histogram[WLC_FRAME_STATS_BUCKETS]; // CPU repaint times of the last WLC_FRAME_STATS_WINDOW frames
+};
+
 /** -- Callbacks API */
 
 /** Output was created. Return false if you want to destroy the output. (e.g. failed to allocate data related to view) */
@@ -256,7 +275,7 @@ void wlc_set_input_destroyed_cb(void (*cb)(struct libinput_device *device));
 
 /** -- Core API */
 
-/** Set log handler. Can be set before wlc_init. */
+/** Set log handler. Can be set before wlc_init. With WLC_LOG_ASYNC=1 it is called from a separate log thread. */
 void wlc_log_set_handler(void (*cb)(enum wlc_log_type type, const char *str));
 
 /**
@@ -367,6 +386,9 @@ bool wlc_output_set_views(wlc_handle output, const wlc_handle *views, size_t mem
 /** Focus output. Pass zero for no focus. */
 void wlc_output_focus(wlc_handle output);
 
+/** Get frame statistics. Returned pointer is a direct reference, updated as output renders. */
+const struct wlc_frame_stats* wlc_output_get_frame_stats(wlc_handle output);
+
 /** -- View API */
 
 /** Focus view. Pass zero for no focus. */
@@ -512,6 +534,13 @@ void wlc_pointer_get_position_v2(double *out_x, double *out_y);
 WLC_DEPRECATED
 void wlc_pointer_get_position(struct wlc_point *out_position);
 
+/**
+ * Get relative motion of the pointer event being handled, for use in the motion callback.
+ * Device events queued since the last wakeup arrive summed as one event.
+ * Unaccelerated deltas are zero if the backend doesn't provide them, everything is zero for absolute motion.
+ */
+void wlc_pointer_get_motion_delta(double *out_dx, double *out_dy, double *out_dx_unaccel, double *out_dy_unaccel);
+
 /** Set current pointer position. */
 void wlc_pointer_set_position_v2(double x, double y);
 
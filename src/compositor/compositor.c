@@ -16,7 +16,7 @@ wl_cb_subsurface_set_position(struct wl_client *client, struct wl_resource *reso
 {
    (void)client;
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wlc_resource((wlc_resource)wl_resource_get_user_data(resource), "surface")))
+   if (!(surface = convert_from_wlc_resource((wlc_resource)wl_resource_get_user_data(resource), WLC_TYPE_SURFACE)))
       return;
 
    surface->pending.subsurface_position = (struct wlc_point){x, y};
@@ -29,10 +29,10 @@ restack_subsurface_relative_to(wlc_resource surface, wlc_resource sibling, int32
    size_t surface_idx = (size_t)~0, target_idx = (size_t)~0;
 
    struct wlc_surface *surface_ptr;
-   if (!(surface_ptr = convert_from_wlc_resource(surface, "surface")))
+   if (!(surface_ptr = convert_from_wlc_resource(surface, WLC_TYPE_SURFACE)))
       return;
 
-   struct wlc_surface *parent = convert_from_wlc_resource(surface_ptr->parent, "surface");
+   struct wlc_surface *parent = convert_from_wlc_resource(surface_ptr->parent, WLC_TYPE_SURFACE);
    wlc_resource *sub;
    chck_iter_pool_for_each(&parent->subsurface_list, sub) {
       if (*sub == surface)
@@ -84,7 +84,7 @@ recursive_set_subsurface_parent_sync_state(struct wlc_surface *surface, bool sta
 
    wlc_resource *r;
    chck_iter_pool_for_each(&surface->subsurface_list, r)
-      recursive_set_subsurface_parent_sync_state(convert_from_wlc_resource(*r, "surface"), state);
+      recursive_set_subsurface_parent_sync_state(convert_from_wlc_resource(*r, WLC_TYPE_SURFACE), state);
 }
 
 static void
@@ -93,7 +93,7 @@ wl_cb_subsurface_set_sync(struct wl_client *client, struct wl_resource *resource
    (void)client;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wlc_resource((wlc_resource)wl_resource_get_user_data(resource), "surface")))
+   if (!(surface = convert_from_wlc_resource((wlc_resource)wl_resource_get_user_data(resource), WLC_TYPE_SURFACE)))
       return;
 
    if (surface) {
@@ -108,14 +108,14 @@ wl_cb_subsurface_set_desync(struct wl_client *client, struct wl_resource *resour
    (void)client;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wlc_resource((wlc_resource)wl_resource_get_user_data(resource), "surface")))
+   if (!(surface = convert_from_wlc_resource((wlc_resource)wl_resource_get_user_data(resource), WLC_TYPE_SURFACE)))
       return;
 
    if (surface) {
       surface->synchronized = false;
       recursive_set_subsurface_parent_sync_state(surface, false);
 
-      struct wlc_surface *parent = convert_from_wlc_resource(surface->parent, "surface");
+      struct wlc_surface *parent = convert_from_wlc_resource(surface->parent, WLC_TYPE_SURFACE);
 
       if (parent && !parent->synchronized && !parent->parent_synchronized)
          wlc_surface_commit(surface);
@@ -151,7 +151,7 @@ wl_cb_subcompositor_get_subsurface(struct wl_client *client, struct wl_resource
       return;
 
    wlc_resource_implement(r, &wl_subsurface_implementation, (void*)surface);
-   wlc_surface_set_parent(convert_from_wlc_resource(surface, "surface"), convert_from_wlc_resource(parent, "surface"));
+   wlc_surface_set_parent(convert_from_wlc_resource(surface, WLC_TYPE_SURFACE), convert_from_wlc_resource(parent, WLC_TYPE_SURFACE));
 }
 
 static void
@@ -189,7 +189,7 @@ wl_cb_surface_create(struct wl_client *client, struct wl_resource *resource, uin
 
    wlc_resource_implement(r, wlc_surface_implementation(), compositor);
 
-   struct wlc_surface_event ev = { .surface = convert_from_wlc_resource(r, "surface"), .type = WLC_SURFACE_EVENT_CREATED };
+   struct wlc_surface_event ev = { .surface = convert_from_wlc_resource(r, WLC_TYPE_SURFACE), .type = WLC_SURFACE_EVENT_CREATED };
    wl_signal_emit(&wlc_system_signals()->surface, &ev);
 }
 
@@ -248,10 +248,10 @@ deactivate_tty(struct wlc_compositor *compositor)
    if (compositor->state.tty != DEACTIVATING)
       return;
 
-   // check that all outputs are surfaceless
+   // check that all outputs are done with the device
    struct wlc_output *o;
-   chck_pool_for_each(&compositor->outputs.pool, o) {
-      if (o->bsurface.display)
+   wlc_slab_for_each(&compositor->outputs.pool, o) {
+      if (o->bsurface.display && !o->state.suspended)
          return;
    }
 
@@ -284,14 +284,16 @@ activate_event(struct wl_listener *listener, void *data)
    if (!ev->active) {
       compositor->state.tty = DEACTIVATING;
       compositor->state.vt = ev->vt;
-      chck_pool_for_each_call(&compositor->outputs.pool, wlc_output_set_backend_surface, NULL);
+      wlc_slab_for_each_call(&compositor->outputs.pool, wlc_output_suspend, true);
       deactivate_tty(compositor);
    } else {
       compositor->state.tty = ACTIVATING;
       compositor->state.vt = 0;
       activate_tty(compositor);
+      // existing outputs keep their surfaces, only hotplugged connectors are added or removed
       wlc_backend_update_outputs(&compositor->backend, &compositor->outputs.pool);
-      chck_pool_for_each_call(&compositor->outputs.pool, wlc_output_set_sleep_ptr, false);
+      wlc_slab_for_each_call(&compositor->outputs.pool, wlc_output_suspend, false);
+      wlc_slab_for_each_call(&compositor->outputs.pool, wlc_output_set_sleep_ptr, false);
    }
 }
 
@@ -344,17 +346,17 @@ attach_surface_to_view_or_create(struct wlc_compositor *compositor, struct wlc_s
       &view->custom_surface,
    };
 
-   const char *name[WLC_SURFACE_ROLE_LAST] = {
-      "shell-surface",
-      "xdg-surface",
-      "xdg-toplevel",
-      "custom-surface",
+   const enum wlc_type types[WLC_SURFACE_ROLE_LAST] = {
+      WLC_TYPE_SHELL_SURFACE,
+      WLC_TYPE_XDG_SURFACE,
+      WLC_TYPE_XDG_TOPLEVEL,
+      WLC_TYPE_CUSTOM_SURFACE,
    };
 
    *res[type] = role;
 
    if (type != WLC_CUSTOM_SURFACE)
-      wl_resource_set_user_data(wl_resource_from_wlc_resource(role, name[type]), (void*)convert_to_wlc_handle(view));
+      wl_resource_set_user_data(wl_resource_from_wlc_resource(role, types[type]), (void*)convert_to_wlc_handle(view));
 }
 
 static void
@@ -367,9 +369,9 @@ attach_popup_to_view_or_create(struct wlc_compositor *compositor, struct wlc_sur
       return;
 
    view->xdg_popup = role;
-   wlc_view_set_parent_ptr(view, convert_from_wlc_handle(parent->view, "view"));
+   wlc_view_set_parent_ptr(view, convert_from_wlc_handle(parent->view, WLC_TYPE_VIEW));
    wlc_view_set_type_ptr(view, WLC_BIT_POPUP, true);
-   wl_resource_set_user_data(wl_resource_from_wlc_resource(role, "xdg-popup"), (void*)convert_to_wlc_handle(view));
+   wl_resource_set_user_data(wl_resource_from_wlc_resource(role, WLC_TYPE_XDG_POPUP), (void*)convert_to_wlc_handle(view));
 }
 
 static void
@@ -391,13 +393,13 @@ surface_event(struct wl_listener *listener, void *data)
       case WLC_SURFACE_EVENT_DESTROYED:
       {
          struct wlc_view *v;
-         chck_pool_for_each(&compositor->views.pool, v) {
+         wlc_slab_for_each(&compositor->views.pool, v) {
             if (v->parent == ev->surface->view)
                wlc_view_set_parent_ptr(v, NULL);
          }
 
          struct wlc_surface *s;
-         chck_pool_for_each(&compositor->surfaces.pool, s) {
+         wlc_slab_for_each(&compositor->surfaces.pool, s) {
             if (s->parent == convert_to_wlc_resource(ev->surface))
                wlc_surface_set_parent(s, NULL);
          }
@@ -412,7 +414,7 @@ static struct wlc_output*
 get_surfaceless_output(struct wlc_compositor *compositor)
 {
    struct wlc_output *o;
-   chck_pool_for_each(&compositor->outputs.pool, o) {
+   wlc_slab_for_each(&compositor->outputs.pool, o) {
       if (!o->bsurface.display)
          return o;
    }
@@ -432,7 +434,7 @@ active_output(struct wlc_compositor *compositor, struct wlc_output *output)
    if (compositor->active.output)
       WLC_INTERFACE_EMIT(output.focus, compositor->active.output, false);
 
-   wlc_output_schedule_repaint(convert_from_wlc_handle(compositor->active.output, "output"));
+   wlc_output_schedule_repaint(convert_from_wlc_handle(compositor->active.output, WLC_TYPE_OUTPUT));
    compositor->active.output = convert_to_wlc_handle(output);
 
    if (compositor->active.output) {
@@ -479,7 +481,7 @@ remove_output(struct wlc_compositor *compositor, struct wlc_output *output)
    assert(compositor && output);
 
    struct wlc_output *o, *alive = NULL;
-   chck_pool_for_each(&compositor->outputs.pool, o) {
+   wlc_slab_for_each(&compositor->outputs.pool, o) {
       if (!o->bsurface.display || o == output)
          continue;
 
@@ -552,10 +554,10 @@ struct wlc_view*
 wlc_compositor_view_for_surface(struct wlc_compositor *compositor, struct wlc_surface *surface)
 {
    struct wlc_view *view;
-   if (!(view = convert_from_wlc_handle(surface->view, "view")) && !(view = wlc_handle_create(&compositor->views)))
+   if (!(view = convert_from_wlc_handle(surface->view, WLC_TYPE_VIEW)) && !(view = wlc_handle_create(&compositor->views)))
       return NULL;
 
-   wlc_surface_attach_to_output(surface, convert_from_wlc_handle(compositor->active.output, "output"), wlc_surface_get_buffer(surface));
+   wlc_surface_attach_to_output(surface, convert_from_wlc_handle(compositor->active.output, WLC_TYPE_OUTPUT), wlc_surface_get_buffer(surface));
    wlc_surface_attach_to_view(surface, view);
    return view;
 }
@@ -576,18 +578,18 @@ wlc_get_outputs(size_t *out_memb)
 
    // Allocate linear array which we then return
    free(_g_compositor->tmp.outputs);
-   if (!(_g_compositor->tmp.outputs = chck_malloc_mul_of(_g_compositor->outputs.pool.items.count, sizeof(wlc_handle))))
+   if (!(_g_compositor->tmp.outputs = chck_malloc_mul_of(_g_compositor->outputs.pool.count, sizeof(wlc_handle))))
       return NULL;
 
    {
       size_t i = 0;
       struct wlc_output *o;
-      chck_pool_for_each(&_g_compositor->outputs.pool, o)
+      wlc_slab_for_each(&_g_compositor->outputs.pool, o)
          _g_compositor->tmp.outputs[i++] = convert_to_wlc_handle(o);
    }
 
    if (out_memb)
-      *out_memb = _g_compositor->outputs.pool.items.count;
+      *out_memb = _g_compositor->outputs.pool.count;
 
    return _g_compositor->tmp.outputs;
 }
@@ -642,6 +644,16 @@ wlc_pointer_get_position_v2(double *out_x, double *out_y)
    *out_y = _g_compositor->seat.pointer.pos.y;
 }
 
+WLC_API void
+wlc_pointer_get_motion_delta(double *out_dx, double *out_dy, double *out_dx_unaccel, double *out_dy_unaccel)
+{
+   assert(_g_compositor && out_dx && out_dy && out_dx_unaccel && out_dy_unaccel);
+   *out_dx = _g_compositor->seat.pointer.delta.dx;
+   *out_dy = _g_compositor->seat.pointer.delta.dy;
+   *out_dx_unaccel = _g_compositor->seat.pointer.delta.dx_unaccel;
+   *out_dy_unaccel = _g_compositor->seat.pointer.delta.dy_unaccel;
+}
+
 WLC_API void
 wlc_pointer_get_position(struct wlc_point *out_position)
 {
@@ -678,8 +690,8 @@ wlc_compositor_terminate(struct wlc_compositor *compositor)
 
       WLC_INTERFACE_EMIT(compositor.terminate);
 
-      if (compositor->outputs.pool.items.count > 0) {
-         chck_pool_for_each_call(&compositor->outputs.pool, wlc_output_terminate);
+      if (compositor->outputs.pool.count > 0) {
+         wlc_slab_for_each_call(&compositor->outputs.pool, wlc_output_terminate);
          return;
       }
    }
@@ -694,7 +706,7 @@ wlc_compositor_is_good(struct wlc_compositor *compositor)
    assert(compositor);
 
    struct wlc_output *o;
-   chck_pool_for_each(&compositor->outputs.pool, o) {
+   wlc_slab_for_each(&compositor->outputs.pool, o) {
       if (o->context.context)
          return true;
    }
@@ -722,6 +734,7 @@ wlc_compositor_release(struct wlc_compositor *compositor)
    wlc_shell_release(&compositor->shell);
    wlc_xdg_shell_release(&compositor->xdg_shell);
    wlc_custom_shell_release(&compositor->custom_shell);
+   wlc_presentation_release(&compositor->presentation);
    wlc_seat_release(&compositor->seat);
 
    if (compositor->wl.subcompositor)
@@ -767,11 +780,11 @@ wlc_compositor(struct wlc_compositor *compositor)
    wl_signal_add(&wlc_system_signals()->output, &compositor->listener.output);
    wl_signal_add(&wlc_system_signals()->focus, &compositor->listener.focus);
 
-   if (!wlc_source(&compositor->outputs, "output", wlc_output, wlc_output_release, 4, sizeof(struct wlc_output)) ||
-       !wlc_source(&compositor->views, "view", wlc_view, wlc_view_release, 32, sizeof(struct wlc_view)) ||
-       !wlc_source(&compositor->surfaces, "surface", wlc_surface, wlc_surface_release, 32, sizeof(struct wlc_surface)) ||
-       !wlc_source(&compositor->subsurfaces, "subsurface", NULL, NULL, 32, sizeof(struct wlc_resource)) ||
-       !wlc_source(&compositor->regions, "region", NULL, wlc_region_release, 32, sizeof(struct wlc_region)))
+   if (!wlc_source(&compositor->outputs, WLC_TYPE_OUTPUT, wlc_output, wlc_output_release, 4, sizeof(struct wlc_output)) ||
+       !wlc_source(&compositor->views, WLC_TYPE_VIEW, wlc_view, wlc_view_release, 32, sizeof(struct wlc_view)) ||
+       !wlc_source(&compositor->surfaces, WLC_TYPE_SURFACE, wlc_surface, wlc_surface_release, 32, sizeof(struct wlc_surface)) ||
+       !wlc_source(&compositor->subsurfaces, WLC_TYPE_SUBSURFACE, NULL, NULL, 32, sizeof(struct wlc_resource)) ||
+       !wlc_source(&compositor->regions, WLC_TYPE_REGION, NULL, wlc_region_release, 32, sizeof(struct wlc_region)))
       goto fail;
 
    if (!(compositor->wl.compositor = wl_global_create(wlc_display(), &wl_compositor_interface, 3, compositor, wl_compositor_bind)))
@@ -784,6 +797,7 @@ wlc_compositor(struct wlc_compositor *compositor)
        !wlc_shell(&compositor->shell) ||
        !wlc_xdg_shell(&compositor->xdg_shell) ||
        !wlc_custom_shell(&compositor->custom_shell) ||
+       !wlc_presentation(&compositor->presentation) ||
        !wlc_backend(&compositor->backend))
       goto fail;
 
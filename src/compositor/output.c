@@ -1,22 +1,56 @@
 #include "output.h"
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <sys/timerfd.h>
 #include <wayland-server.h>
 #include <chck/string/string.h>
 #include <chck/math/math.h>
-#include <chck/overflow/overflow.h>
 #include "internal.h"
 #include "visibility.h"
 #include "macros.h"
 #include "output.h"
 #include "view.h"
+#include "presentation.h"
+#include "trace.h"
 #include "resources/types/surface.h"
+#include "resources/types/buffer.h"
+
+// Slack on top of the slowest recent repaint, covers timer wakeup latency and flip submission
+#define REPAINT_SLACK_NS (1000000)
 
 static struct wlc_output *rendering_output;
 
 // FIXME: this is a hack
 static EGLNativeDisplayType INVALID_DISPLAY = (EGLNativeDisplayType)~0;
 
+// Render callback, time spent there is accounted separately in frame stats
+#define EMIT_RENDER_HOOK(o, x, ...) { \
+   if (wlc_interface()->x) { \
+      const uint64_t hook_start = get_time_ns(); \
+      wlc_interface()->x(__VA_ARGS__); \
+      o->stats.frame.hooks += get_time_ns() - hook_start; \
+   } \
+}
+
+static uint64_t
+timespec_to_ns(const struct timespec *ts)
+{
+   assert(ts);
+   return (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static uint64_t
+get_time_ns(void)
+{
+   struct timespec ts;
+   wlc_get_time(&ts);
+   return timespec_to_ns(&ts);
+}
+
 WLC_PURE static const char*
 name_for_connector(enum wlc_connector_type connector)
 {
@@ -76,7 +110,7 @@ static void
 output_push_to_resource(struct wlc_output *output, wlc_resource r)
 {
    struct wl_resource *resource;
-   if (!(resource = wl_resource_from_wlc_resource(r, "output")))
+   if (!(resource = wl_resource_from_wlc_resource(r, WLC_TYPE_OUTPUT)))
       return;
 
    const uint32_t version = wl_resource_get_version(resource);
@@ -106,7 +140,7 @@ static void
 output_push_to_resources(struct wlc_output *output)
 {
    wlc_resource *r;
-   chck_pool_for_each(&output->resources.pool, r)
+   wlc_slab_for_each(&output->resources.pool, r)
       output_push_to_resource(output, *r);
 }
 
@@ -124,56 +158,158 @@ wl_output_bind(struct wl_client *client, void *data, uint32_t version, uint32_t
    output_push_to_resource(output, r);
 }
 
-static bool
-view_visible(struct wlc_view *view, struct wlc_surface *surface, uint32_t mask)
+static void
+add_damage(struct wlc_output *output, const struct wlc_geometry *g)
 {
-   if (!view || !surface)
-      return false;
+   assert(output && g);
 
-   return (surface->commit.attached && (view->mask & mask));
+   if (g->size.w == 0 || g->size.h == 0)
+      return;
+
+   // scissor of the frame being rendered is already set, so its damage goes to the next frame
+   pixman_region32_t *damage = (output == rendering_output ? &output->damage.pending : &output->damage.current);
+   pixman_region32_union_rect(damage, damage, g->origin.x, g->origin.y, g->size.w, g->size.h);
+   pixman_region32_intersect_rect(damage, damage, 0, 0, output->virtual.w, output->virtual.h);
 }
 
-static bool
-blit(bool *g, const struct wlc_size *r, const struct wlc_point *a, const struct wlc_point *b, bool should_blit)
+static void
+damage_painted(struct wlc_output *output, struct wlc_surface *surface)
 {
-   assert(g && r && a && b);
+   assert(output);
 
-   bool visible = false;
-   const size_t gsz = r->w * r->h;
-   assert(b->x - a->x >= 0);
-   assert(a->x >= 0 && b->x <= (int32_t)r->w && a->y >= 0 && b->y <= (int32_t)r->h);
-   for (int32_t y = a->y; y < b->y; ++y) {
-      const size_t off = a->x + y * r->w, memb = (b->x - a->x);
-      assert(off + memb <= gsz);
+   if (!surface)
+      return;
 
-      if (!visible && memchr(g + off, false, memb)) {
-         visible = true;
+   // commit damage is left alone, it is still repainted once the surface is painted again
+   add_damage(output, &surface->painted);
+   surface->painted = wlc_geometry_zero;
 
-         if (!should_blit)
-            break;
+   wlc_resource *sub;
+   chck_iter_pool_for_each(&surface->subsurface_list, sub)
+      damage_painted(output, convert_from_wlc_resource(*sub, WLC_TYPE_SURFACE));
+}
+
+static void
+damage_surface(struct wlc_output *output, struct wlc_surface *surface, const struct wlc_geometry *g)
+{
+   assert(output && surface && g);
+
+   if (!wlc_geometry_equals(&surface->painted, g)) {
+      // moved or resized, repaint both where it was and where it will be
+      add_damage(output, &surface->painted);
+      add_damage(output, g);
+      surface->painted = *g;
+   } else if (pixman_region32_not_empty(&surface->commit.damage)) {
+      if (wlc_size_equals(&surface->size, &g->size)) {
+         // surface damage is cleared below, so we can translate it in place
+         pixman_region32_translate(&surface->commit.damage, g->origin.x, g->origin.y);
+         pixman_region32_union(&output->damage.current, &output->damage.current, &surface->commit.damage);
+         pixman_region32_intersect_rect(&output->damage.current, &output->damage.current, 0, 0, output->virtual.w, output->virtual.h);
+      } else {
+         // scaled surfaces are not worth the trouble, just damage all of it
+         add_damage(output, g);
       }
+   }
+
+   pixman_region32_clear(&surface->commit.damage);
+}
+
+static void
+damage_detached_surfaces(struct wlc_output *output)
+{
+   assert(output);
+
+   // Surfaces not part of any view (cursors, surfaces rendered from hooks) are damaged as whole
+   wlc_resource *r;
+   chck_iter_pool_for_each(&output->surfaces, r) {
+      struct wlc_surface *s;
+      if (!(s = convert_from_wlc_resource(*r, WLC_TYPE_SURFACE)) || !pixman_region32_not_empty(&s->commit.damage))
+         continue;
 
-      if (should_blit)
-         memset(g + off, true, memb);
+      add_damage(output, &s->painted);
+      pixman_region32_clear(&s->commit.damage);
    }
+}
+
+static void
+subsurface_geometry(struct wlc_surface *surface, struct wlc_point offset, struct wlc_coordinate_scale parent_scale, struct wlc_geometry *out_geometry)
+{
+   assert(surface && out_geometry);
+
+   *out_geometry = (struct wlc_geometry){
+      .origin = {
+         .x = offset.x + parent_scale.w * (surface->commit.subsurface_position.x + surface->commit.offset.x),
+         .y = offset.y + parent_scale.h * (surface->commit.subsurface_position.y + surface->commit.offset.y)
+      },
+      .size = {
+         .w = surface->size.w * parent_scale.w,
+         .h = surface->size.h * parent_scale.h
+      },
+   };
+}
+
+static struct wlc_point
+subsurface_offset(struct wlc_surface *surface, struct wlc_point offset, struct wlc_coordinate_scale parent_scale)
+{
+   assert(surface);
 
-   return visible;
+   return (struct wlc_point){
+      offset.x + (surface->parent ? 0 : surface->commit.subsurface_position.x / parent_scale.w),
+      offset.y + (surface->parent ? 0 : surface->commit.subsurface_position.y / parent_scale.h)
+   };
+}
+
+static void
+subsurfaces_damage(struct wlc_output *output, struct wlc_surface *surface, struct wlc_coordinate_scale parent_scale, struct wlc_point offset)
+{
+   if (!surface)
+      return;
+
+   if (surface->parent) {
+      struct wlc_geometry g;
+      subsurface_geometry(surface, offset, parent_scale, &g);
+      damage_surface(output, surface, &g);
+   }
+
+   wlc_resource *sub;
+   chck_iter_pool_for_each(&surface->subsurface_list, sub)
+      subsurfaces_damage(output, convert_from_wlc_resource(*sub, WLC_TYPE_SURFACE), surface->coordinate_transform, subsurface_offset(surface, offset, parent_scale));
+}
+
+static void
+view_damage(struct wlc_output *output, struct wlc_view *view, struct wlc_surface *surface)
+{
+   assert(output && view && surface);
+
+   struct wlc_geometry b;
+   wlc_view_get_bounds(view, &b, NULL);
+   damage_surface(output, surface, &b);
+   subsurfaces_damage(output, surface, (struct wlc_coordinate_scale){1, 1}, b.origin);
+}
+
+static bool
+view_visible(struct wlc_view *view, struct wlc_surface *surface, uint32_t mask)
+{
+   if (!view || !surface)
+      return false;
+
+   return (surface->commit.attached && (view->mask & mask));
 }
 
 static bool
 get_visible_views(struct wlc_output *output, struct chck_iter_pool *visible)
 {
-   assert(output && output->blit);
+   assert(output);
 
-   const size_t gsz = output->virtual.w * output->virtual.h;
-   memset(output->blit, false, gsz);
+   // Area covered by opaque surfaces, accumulated from top to bottom
+   pixman_region32_t occluded, opaque;
+   pixman_region32_init(&occluded);
+   pixman_region32_init(&opaque);
 
-   wlc_handle *h;
-   chck_iter_pool_for_each_reverse(&output->views, h) {
-      struct wlc_view *v;
+   struct wlc_view *v;
+   wl_list_for_each_reverse(v, &output->stack, stack.link) {
       struct wlc_surface *s;
-      if (!(v = convert_from_wlc_handle(*h, "view")) ||
-          !(s = convert_from_wlc_resource(v->surface, "surface")))
+      if (!(s = convert_from_wlc_resource(v->surface, WLC_TYPE_SURFACE)))
          continue;
 
       wlc_view_commit_state(v, &v->pending, &v->commit);
@@ -192,27 +328,77 @@ get_visible_views(struct wlc_output *output, struct chck_iter_pool *visible)
          wlc_x11_set_window_hidden(&v->x11, !vis);
       }
 
-      if (!vis)
+      if (!vis) {
+         damage_painted(output, s);
          continue;
+      }
+
+      view_damage(output, v, s);
 
-      struct wlc_geometry o;
-      struct wlc_point a, b;
-      const bool should_blit = wlc_view_get_opaque(v, &o);
-      a.x = chck_clamp32(o.origin.x, 0, output->virtual.w);
-      a.y = chck_clamp32(o.origin.y, 0, output->virtual.h);
-      b.x = chck_clamp32((o.origin.x + o.size.w), 1, output->virtual.w);
-      b.y = chck_clamp32((o.origin.y + o.size.h), 1, output->virtual.h);
+      struct wlc_geometry b;
+      wlc_view_get_bounds(v, &b, NULL);
+      pixman_box32_t box = {
+         chck_clamp32(b.origin.x, 0, output->virtual.w),
+         chck_clamp32(b.origin.y, 0, output->virtual.h),
+         chck_clamp32(b.origin.x + (int32_t)b.size.w, 0, output->virtual.w),
+         chck_clamp32(b.origin.y + (int32_t)b.size.h, 0, output->virtual.h),
+      };
 
-      if (!blit(output->blit, &output->virtual, &a, &b, should_blit)) {
-         wlc_dlog(WLC_DBG_RENDER_LOOP, "%" PRIuWLC " is not visible (%d,%d+%d,%d %d,%d+%ux%u)", *h, a.x, a.y, b.x, b.y, o.origin.x, o.origin.y, o.size.w, o.size.h);
+      if (box.x1 >= box.x2 || box.y1 >= box.y2 || pixman_region32_contains_rectangle(&occluded, &box) == PIXMAN_REGION_IN) {
+         wlc_dlog(WLC_DBG_RENDER_LOOP, "%" PRIuWLC " is not visible (%d,%d+%d,%d %d,%d+%ux%u)", convert_to_wlc_handle(v), box.x1, box.y1, box.x2, box.y2, b.origin.x, b.origin.y, b.size.w, b.size.h);
          continue;
       }
 
-      wlc_dlog(WLC_DBG_RENDER_LOOP, "%" PRIuWLC " is visible (%d,%d+%d,%d %d,%d+%ux%u)", *h, a.x, a.y, b.x, b.y, o.origin.x, o.origin.y, o.size.w, o.size.h);
+      wlc_dlog(WLC_DBG_RENDER_LOOP, "%" PRIuWLC " is visible (%d,%d+%d,%d %d,%d+%ux%u)", convert_to_wlc_handle(v), box.x1, box.y1, box.x2, box.y2, b.origin.x, b.origin.y, b.size.w, b.size.h);
       chck_iter_pool_push_front(visible, &v);
+
+      wlc_view_get_opaque_region(v, &opaque);
+      pixman_region32_union(&occluded, &occluded, &opaque);
    }
 
-   return memchr(output->blit, false, gsz);
+   pixman_box32_t screen = { 0, 0, output->virtual.w, output->virtual.h };
+   const bool background_visible = (pixman_region32_contains_rectangle(&occluded, &screen) != PIXMAN_REGION_IN);
+   pixman_region32_fini(&opaque);
+   pixman_region32_fini(&occluded);
+   return background_visible;
+}
+
+static bool
+upload_surface(struct wlc_output *output, struct wlc_surface *surface)
+{
+   assert(output && surface);
+
+   if (!surface->needs_upload)
+      return true;
+
+   surface->needs_upload = false;
+
+   const bool uploaded = wlc_render_surface_attach(&output->render, &output->context, surface, wlc_surface_get_buffer(surface));
+   pixman_region32_clear(&surface->upload_damage);
+
+   if (!uploaded) {
+      wlc_log(WLC_LOG_WARN, "Failed to upload buffer of surface (%" PRIuWLC ")", convert_to_wlc_resource(surface));
+      surface->commit.attached = false;
+      return false;
+   }
+
+   return true;
+}
+
+static bool
+upload_surfaces(struct wlc_output *output, struct wlc_surface *skip)
+{
+   assert(output);
+
+   bool uploaded = true;
+   wlc_resource *r;
+   chck_iter_pool_for_each(&output->surfaces, r) {
+      struct wlc_surface *s;
+      if ((s = convert_from_wlc_resource(*r, WLC_TYPE_SURFACE)) && s != skip && !upload_surface(output, s))
+         uploaded = false;
+   }
+
+   return uploaded;
 }
 
 static void
@@ -225,6 +411,11 @@ finish_frame_tasks(struct wlc_output *output)
       memset(&output->task.bsurface, 0, sizeof(output->task.bsurface));
    }
 
+   if (output->task.suspend) {
+      output->task.suspend = false;
+      wlc_output_suspend(output, true);
+   }
+
    if (output->task.sleep) {
       wlc_output_set_sleep_ptr(output, true);
       output->task.sleep = false;
@@ -239,17 +430,10 @@ finish_frame_tasks(struct wlc_output *output)
 static void
 render_subsurface(struct wlc_output *output, struct wlc_surface *surface, struct wlc_point offset, struct wlc_coordinate_scale parent_scale)
 {
-   const struct wlc_geometry g = {
-      .origin = {
-         .x = offset.x + parent_scale.w * (surface->commit.subsurface_position.x + surface->commit.offset.x),
-         .y = offset.y + parent_scale.h * (surface->commit.subsurface_position.y + surface->commit.offset.y)
-      },
-      .size = {
-         .w = surface->size.w * parent_scale.w,
-         .h = surface->size.h * parent_scale.h
-      },
-   };
+   struct wlc_geometry g;
+   subsurface_geometry(surface, offset, parent_scale, &g);
    wlc_render_surface_paint(&output->render, &output->context, surface, &g);
+   output->stats.frame.subsurfaces++;
 }
 
 static void
@@ -263,19 +447,20 @@ subsurfaces_render(struct wlc_output *output, struct wlc_surface *surface, struc
        render_subsurface(output, surface, offset, parent_scale);
 
    wlc_resource *sub;
-   chck_iter_pool_for_each(&surface->subsurface_list, sub) {
-       subsurfaces_render(output, convert_from_wlc_resource(*sub, "surface"), surface->coordinate_transform,
-             callbacks,
-             (struct wlc_point) {
-             offset.x + (surface->parent ? 0 : surface->commit.subsurface_position.x / parent_scale.w),
-             offset.y + (surface->parent ? 0 : surface->commit.subsurface_position.y / parent_scale.h)
-             });
-   }
+   chck_iter_pool_for_each(&surface->subsurface_list, sub)
+       subsurfaces_render(output, convert_from_wlc_resource(*sub, WLC_TYPE_SURFACE), surface->coordinate_transform, callbacks, subsurface_offset(surface, offset, parent_scale));
 
-   wlc_resource *r;
-   chck_iter_pool_for_each(&surface->commit.frame_cbs, r)
-      chck_iter_pool_push_back(callbacks, r);
-   chck_iter_pool_flush(&surface->commit.frame_cbs);
+   wlc_output_take_frame_callbacks(output, surface, callbacks);
+}
+
+static void
+flush_for_hook(struct wlc_output *output, bool hooked)
+{
+   assert(output);
+
+   // renderer may batch draws, hooks expect everything before them to be drawn
+   if (hooked)
+      wlc_render_flush(&output->render, &output->context);
 }
 
 static void
@@ -287,26 +472,232 @@ render_view(struct wlc_output *output, struct wlc_view *view, struct chck_iter_p
       return;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wlc_resource(view->surface, "surface")))
+   if (!(surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
       return;
 
-   WLC_INTERFACE_EMIT(view.render.pre, convert_to_wlc_handle(view));
+   flush_for_hook(output, wlc_interface()->view.render.pre);
+   EMIT_RENDER_HOOK(output, view.render.pre, convert_to_wlc_handle(view));
    wlc_render_flush_fakefb(&output->render, &output->context);
    wlc_render_view_paint(&output->render, &output->context, view);
+   output->stats.frame.views++;
 
    struct wlc_geometry b;
    wlc_view_get_bounds(view, &b, NULL);
    subsurfaces_render(output, surface, (struct wlc_coordinate_scale) {1, 1}, callbacks, b.origin);
 
-   WLC_INTERFACE_EMIT(view.render.post, convert_to_wlc_handle(view));
+   flush_for_hook(output, wlc_interface()->view.render.post);
+   EMIT_RENDER_HOOK(output, view.render.post, convert_to_wlc_handle(view));
    wlc_render_flush_fakefb(&output->render, &output->context);
 }
 
+static bool
+get_repair_damage(struct wlc_output *output, pixman_region32_t *out_repair)
+{
+   assert(output && out_repair);
+
+   // Back buffer with age N is missing the damage of the last N - 1 frames
+   // Age 0 means the contents are unknown, so we repaint everything
+   const int32_t age = wlc_context_get_buffer_age(&output->context);
+   if (age <= 0 || age > WLC_OUTPUT_DAMAGE_HISTORY + 1)
+      return false;
+
+   pixman_region32_copy(out_repair, &output->damage.current);
+   for (int32_t i = 0; i < age - 1; ++i) {
+      const uint32_t index = (output->damage.index + WLC_OUTPUT_DAMAGE_HISTORY - i) % WLC_OUTPUT_DAMAGE_HISTORY;
+      pixman_region32_union(out_repair, out_repair, &output->damage.previous[index]);
+   }
+
+   return true;
+}
+
+static uint32_t
+get_swap_damage(struct wlc_output *output, struct wlc_geometry *out_rects, uint32_t memb)
+{
+   assert(output && out_rects && memb > 0);
+
+   int nrects;
+   const pixman_box32_t *boxes = pixman_region32_rectangles(&output->damage.current, &nrects);
+
+   if ((uint32_t)nrects > memb) {
+      boxes = pixman_region32_extents(&output->damage.current);
+      nrects = 1;
+   }
+
+   // swap damage is in mode pixels
+   const float sx = (float)output->mode.w / chck_maxu32(output->virtual.w, 1);
+   const float sy = (float)output->mode.h / chck_maxu32(output->virtual.h, 1);
+   for (int i = 0; i < nrects; ++i) {
+      // round outwards, partially covered mode pixels must be swapped too
+      const int32_t x1 = floor(boxes[i].x1 * sx), y1 = floor(boxes[i].y1 * sy);
+      const int32_t x2 = ceil(boxes[i].x2 * sx), y2 = ceil(boxes[i].y2 * sy);
+      out_rects[i].origin = (struct wlc_point){ x1, y1 };
+      out_rects[i].size = (struct wlc_size){ x2 - x1, y2 - y1 };
+   }
+
+   return nrects;
+}
+
+static void
+push_damage_history(struct wlc_output *output)
+{
+   assert(output);
+   output->damage.index = (output->damage.index + 1) % WLC_OUTPUT_DAMAGE_HISTORY;
+   pixman_region32_copy(&output->damage.previous[output->damage.index], &output->damage.current);
+   pixman_region32_copy(&output->damage.current, &output->damage.pending);
+   pixman_region32_clear(&output->damage.pending);
+}
+
+static void
+send_frame_callbacks(struct wlc_output *output, uint32_t time)
+{
+   assert(output);
+
+   wlc_resource *r;
+   chck_iter_pool_for_each(&output->callbacks, r) {
+      struct wl_resource *resource;
+      if ((resource = wl_resource_from_wlc_resource(*r, WLC_TYPE_CALLBACK)))
+         wl_callback_send_done(resource, time);
+      wlc_resource_release_ptr(r);
+   }
+   chck_iter_pool_flush(&output->callbacks);
+}
+
+static void
+discard_feedbacks(struct wlc_output *output)
+{
+   assert(output);
+
+   wlc_resource *r;
+   chck_iter_pool_for_each(&output->feedbacks, r)
+      wlc_presentation_feedback_discarded(*r);
+   chck_iter_pool_flush(&output->feedbacks);
+}
+
+static bool
+software_pointer_visible(struct wlc_output *output)
+{
+   assert(output);
+   struct wlc_render_event ev = { .output = output, .type = WLC_RENDER_EVENT_POINTER_QUERY };
+   wl_signal_emit(&wlc_system_signals()->render, &ev);
+   return ev.pointer_visible;
+}
+
+static bool
+plane_eligible(struct wlc_surface *surface, struct wlc_buffer *buffer)
+{
+   assert(surface && buffer);
+
+   // planes show the buffer as is, anything else needs composition
+   return (buffer->y_inverted && surface->commit.scale == 1 && surface->commit.transform == WL_OUTPUT_TRANSFORM_NORMAL &&
+           surface->subsurface_list.items.count == 0);
+}
+
+static struct wlc_surface*
+scanout_view(struct wlc_output *output)
+{
+   assert(output);
+
+   if (!output->bsurface.api.scanout || output->state.background_visible || output->visible.items.count != 1)
+      return NULL;
+
+   // hooks may draw on top of views, which needs composition
+   if (wlc_interface()->output.render.pre || wlc_interface()->output.render.post ||
+       wlc_interface()->view.render.pre || wlc_interface()->view.render.post)
+      return NULL;
+
+   struct wlc_view **v = chck_iter_pool_get(&output->visible, 0);
+
+   struct wlc_surface *surface;
+   struct wlc_buffer *buffer;
+   if (!(surface = convert_from_wlc_resource((*v)->surface, WLC_TYPE_SURFACE)) || !(buffer = wlc_surface_get_buffer(surface)))
+      return NULL;
+
+   // buffer must cover the output exactly, anything else needs scaling, borders or clipping
+   struct wlc_geometry bounds, visible;
+   wlc_view_get_bounds(*v, &bounds, &visible);
+   const struct wlc_geometry screen = { wlc_point_zero, output->mode };
+   if (output->scale != 1 || !wlc_size_equals(&output->virtual, &output->mode) ||
+       !wlc_geometry_equals(&bounds, &screen) || !wlc_geometry_equals(&visible, &screen) ||
+       !wlc_size_equals(&buffer->size, &output->mode) || !plane_eligible(surface, buffer))
+      return NULL;
+
+   // software cursor would not be drawn
+   if (software_pointer_visible(output))
+      return NULL;
+
+   if (!output->bsurface.api.scanout(&output->bsurface, buffer))
+      return NULL;
+
+   wlc_output_take_frame_callbacks(output, surface, &output->callbacks);
+
+   wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Scanout of %" PRIuWLC, convert_to_wlc_handle(*v));
+   wlc_trace(WLC_TRACE_SCANOUT, convert_to_wlc_handle(output), convert_to_wlc_handle(*v), 0);
+   return surface;
+}
+
+static void
+assign_overlays(struct wlc_output *output)
+{
+   assert(output);
+
+   wlc_handle assigned[WLC_BACKEND_MAX_OVERLAYS] = {0};
+   uint32_t count = 0;
+
+   // Planes are stacked above everything composited, so hooks or software cursor drawing on top rule them out.
+   // Plane geometry is in mode pixels, so only unscaled outputs are considered.
+   const bool usable = (output->bsurface.api.assign_overlay && output->scale == 1 && wlc_size_equals(&output->virtual, &output->mode) &&
+                        !wlc_interface()->output.render.post && !wlc_interface()->view.render.pre && !wlc_interface()->view.render.post &&
+                        !software_pointer_visible(output));
+
+   if (usable) {
+      pixman_region32_t taken;
+      pixman_region32_init(&taken);
+
+      // Visible views are in paint order, walk from the top until first view that can't be lifted
+      for (size_t i = output->visible.items.count; i > 0 && count < LENGTH(assigned); --i) {
+         struct wlc_view **v = chck_iter_pool_get(&output->visible, i - 1);
+
+         struct wlc_surface *surface;
+         struct wlc_buffer *buffer;
+         if (!(surface = convert_from_wlc_resource((*v)->surface, WLC_TYPE_SURFACE)) || !(buffer = wlc_surface_get_buffer(surface)) || !plane_eligible(surface, buffer))
+            break;
+
+         // black borders need composition
+         struct wlc_geometry bounds, visible;
+         wlc_view_get_bounds(*v, &bounds, &visible);
+         if (!wlc_geometry_equals(&bounds, &visible))
+            break;
+
+         // stacking order between overlay planes is not known, so they must not overlap
+         pixman_box32_t box = { bounds.origin.x, bounds.origin.y, bounds.origin.x + (int32_t)bounds.size.w, bounds.origin.y + (int32_t)bounds.size.h };
+         if (pixman_region32_contains_rectangle(&taken, &box) != PIXMAN_REGION_OUT)
+            break;
+
+         if (!output->bsurface.api.assign_overlay(&output->bsurface, buffer, &bounds))
+            break;
+
+         wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Overlay plane for %" PRIuWLC, convert_to_wlc_handle(*v));
+         pixman_region32_union_rect(&taken, &taken, box.x1, box.y1, bounds.size.w, bounds.size.h);
+         assigned[count++] = convert_to_wlc_handle(*v);
+         wlc_output_take_frame_callbacks(output, surface, &output->callbacks);
+         chck_iter_pool_remove(&output->visible, i - 1);
+      }
+
+      pixman_region32_fini(&taken);
+   }
+
+   if (memcmp(assigned, output->overlays, sizeof(assigned))) {
+      // what was below or on the planes has to be composited again
+      wlc_output_damage_whole(output);
+      memcpy(output->overlays, assigned, sizeof(assigned));
+   }
+}
+
 static bool
 should_render(struct wlc_output *output)
 {
    assert(output);
-   return (wlc_get_active() && !output->state.pending && output->bsurface.display && output->active.mode != UINT_MAX);
+   return (wlc_get_active() && !output->state.pending && !output->state.suspended && output->bsurface.display && output->active.mode != UINT_MAX);
 }
 
 static bool
@@ -317,6 +708,7 @@ repaint(struct wlc_output *output)
 
    if (!should_render(output)) {
       wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Skipped repaint");
+      wlc_trace(WLC_TRACE_REPAINT_SKIP, convert_to_wlc_handle(output), 0, 0);
       output->state.activity = output->state.scheduled = false;
       finish_frame_tasks(output);
       return false;
@@ -324,11 +716,16 @@ repaint(struct wlc_output *output)
 
    wlc_render_resolution(&output->render, &output->context, &output->mode, &output->virtual, output->scale);
 
+   output->stats.frame.views = output->stats.frame.subsurfaces = 0;
+   output->stats.frame.hooks = 0;
+
    if (output->state.sleeping) {
       // fake sleep
+      wlc_render_scissor(&output->render, &output->context, NULL);
       wlc_render_clear(&output->render, &output->context);
       output->state.pending = true;
-      wlc_context_swap(&output->context, &output->bsurface);
+      output->stats.swapped = get_time_ns();
+      wlc_context_swap(&output->context, &output->bsurface, NULL, 0);
       wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Repaint");
       return true;
    }
@@ -343,11 +740,65 @@ repaint(struct wlc_output *output)
       output->state.background_visible = false;
    }
 
+   // Scanned out buffer is not touched by GL, it gets uploaded once we composite it again.
+   // Partial uploads use the surface's own upload damage, so collecting output damage first is fine.
+   struct wlc_surface *scanout;
+   if ((scanout = scanout_view(output))) {
+      upload_surfaces(output, scanout);
+      damage_detached_surfaces(output);
+      chck_iter_pool_flush(&output->visible);
+      // damage is not in any of our buffers, full repaint happens once we composite again
+      pixman_region32_clear(&output->damage.current);
+      memset(output->overlays, 0, sizeof(output->overlays));
+      output->state.scanout = true;
+      output->state.pending = true;
+      output->stats.swapped = get_time_ns();
+      wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Repaint");
+      return true;
+   }
+
+   // failed upload detaches the buffer, so its view is no longer visible
+   if (!upload_surfaces(output, NULL)) {
+      chck_iter_pool_flush(&output->visible);
+      output->state.background_visible = get_visible_views(output, &output->visible);
+   }
+
+   damage_detached_surfaces(output);
+
+   if (output->state.scanout) {
+      wlc_output_damage_whole(output);
+      output->state.scanout = false;
+   }
+
+   assign_overlays(output);
+
+   bool partial;
+   {
+      pixman_region32_t repair;
+      pixman_region32_init(&repair);
+
+      if ((partial = get_repair_damage(output, &repair))) {
+         const pixman_box32_t *e = pixman_region32_extents(&repair);
+         const struct wlc_geometry g = { .origin = { e->x1, e->y1 }, .size = { e->x2 - e->x1, e->y2 - e->y1 } };
+         wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Repairing %d,%d+%ux%u", g.origin.x, g.origin.y, g.size.w, g.size.h);
+         wlc_render_scissor(&output->render, &output->context, &g);
+      } else {
+         wlc_render_scissor(&output->render, &output->context, NULL);
+      }
+
+      pixman_region32_fini(&repair);
+   }
+
+   // GPU finishes frames later, pick up whatever has completed by now
+   wlc_render_timer_result(&output->render, &output->context, &output->stats.frame.gpu);
+   wlc_render_timer_begin(&output->render, &output->context);
+
    rendering_output = output;
    wlc_render_clear(&output->render, &output->context);
 
    if (output->state.background_visible) {
-      WLC_INTERFACE_EMIT(output.render.pre, convert_to_wlc_handle(output));
+      flush_for_hook(output, wlc_interface()->output.render.pre);
+      EMIT_RENDER_HOOK(output, output.render.pre, convert_to_wlc_handle(output));
       wlc_render_flush_fakefb(&output->render, &output->context);
    }
 
@@ -358,49 +809,165 @@ repaint(struct wlc_output *output)
       chck_iter_pool_flush(&output->visible);
    }
 
-   WLC_INTERFACE_EMIT(output.render.post, convert_to_wlc_handle(output));
+   flush_for_hook(output, wlc_interface()->output.render.post);
+   EMIT_RENDER_HOOK(output, output.render.post, convert_to_wlc_handle(output));
    wlc_render_flush_fakefb(&output->render, &output->context);
 
    struct wlc_render_event ev = { .output = output, .type = WLC_RENDER_EVENT_POINTER };
    wl_signal_emit(&wlc_system_signals()->render, &ev);
 
    rendering_output = NULL;
+   wlc_render_flush(&output->render, &output->context);
+   wlc_render_timer_end(&output->render, &output->context);
+
+   struct wlc_geometry rects[16];
+   const uint32_t nrects = (partial ? get_swap_damage(output, rects, LENGTH(rects)) : 0);
+   push_damage_history(output);
 
    output->state.pending = true;
-   wlc_context_swap(&output->context, &output->bsurface);
+   wlc_trace(WLC_TRACE_SWAP, convert_to_wlc_handle(output), nrects, 0);
 
-   {
-      wlc_resource *r;
-      chck_iter_pool_for_each(&output->callbacks, r) {
-         struct wl_resource *resource;
-         if ((resource = wl_resource_from_wlc_resource(*r, "callback")))
-            wl_callback_send_done(resource, output->state.frame_time);
-         wlc_resource_release_ptr(r);
-      }
-      chck_iter_pool_flush(&output->callbacks);
-   }
+   // some backends finish the frame from within the swap, so this must be known before it
+   output->stats.swapped = get_time_ns();
+   wlc_context_swap(&output->context, &output->bsurface, (partial ? rects : NULL), nrects);
 
    wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Repaint");
    return true;
 }
 
+static uint64_t
+get_refresh_period(struct wlc_output *output)
+{
+   assert(output);
+
+   struct wlc_output_mode *mode;
+   if (output->active.mode == UINT_MAX || !(mode = chck_iter_pool_get(&output->information.modes, output->active.mode)) || mode->refresh <= 0)
+      return 0;
+
+   return 1000000000000 / mode->refresh; // mHz
+}
+
+static uint64_t
+get_render_budget(struct wlc_output *output)
+{
+   assert(output);
+
+   uint64_t slowest = 0;
+   for (uint32_t i = 0; i < WLC_OUTPUT_RENDER_HISTORY; ++i)
+      slowest = (output->timing.render[i] > slowest ? output->timing.render[i] : slowest);
+
+   return slowest + slowest / 4 + REPAINT_SLACK_NS;
+}
+
+static void
+arm_repaint_timer(struct wlc_output *output, uint64_t deadline)
+{
+   assert(output);
+
+   // zero would disarm the timer, deadline in the past expires immediately
+   deadline = (deadline > 0 ? deadline : 1);
+   const struct itimerspec its = { .it_value = { .tv_sec = deadline / 1000000000, .tv_nsec = deadline % 1000000000 } };
+   if (timerfd_settime(output->timer.fd, TFD_TIMER_ABSTIME, &its, NULL) != 0)
+      wlc_log(WLC_LOG_WARN, "Failed to arm repaint timer: %m");
+}
+
+static void
+schedule_deadline(struct wlc_output *output)
+{
+   assert(output);
+
+   const uint64_t now = get_time_ns(), period = get_refresh_period(output);
+
+   // Nothing to predict from, repaint right away
+   if (!period || !output->timing.last_flip || output->timing.last_flip > now || output->state.sleeping) {
+      output->stats.target = 0;
+      arm_repaint_timer(output, now);
+      return;
+   }
+
+   // Display keeps refreshing at mode rate, so next vblank is in phase with the last flip.
+   // Start the repaint as late as the recent repaints allow, if that's already behind us start now.
+   const uint64_t vblank = output->timing.last_flip + ((now - output->timing.last_flip) / period + 1) * period;
+   const uint64_t budget = get_render_budget(output);
+   const uint64_t deadline = (vblank > budget ? vblank - budget : 0);
+   output->stats.target = vblank;
+   wlc_trace(WLC_TRACE_REPAINT_SCHEDULE, convert_to_wlc_handle(output), deadline, vblank);
+   wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Repaint deadline in %ldus (vblank in %ldus, budget %ldus)",
+            (long)(((int64_t)deadline - (int64_t)now) / 1000), (long)((vblank - now) / 1000), (long)(budget / 1000));
+   arm_repaint_timer(output, deadline);
+}
+
+static uint32_t
+histogram_bucket(uint64_t duration)
+{
+   uint32_t bucket = 0;
+   for (uint64_t limit = 250000; duration >= limit && bucket < WLC_FRAME_STATS_BUCKETS - 1; limit *= 2)
+      ++bucket;
+   return bucket;
+}
+
+static void
+record_repaint(struct wlc_output *output, uint64_t duration)
+{
+   assert(output);
+
+   struct wlc_frame_stats *stats = &output->stats.frame;
+   const uint32_t slot = stats->frames % WLC_FRAME_STATS_WINDOW;
+
+   // oldest frame falls out of the window once it's full
+   if (stats->frames >= WLC_FRAME_STATS_WINDOW)
+      stats->histogram[output->stats.window[slot]]--;
+
+   output->stats.window[slot] = histogram_bucket(duration);
+   stats->histogram[output->stats.window[slot]]++;
+   stats->frames++;
+   stats->repaint = duration;
+   stats->repaint_max = (duration > stats->repaint_max ? duration : stats->repaint_max);
+}
+
 static int
-cb_idle_timer(void *data)
+cb_repaint_timer(int fd, uint32_t mask, void *data)
 {
+   (void)mask;
    assert(data);
-   repaint(convert_from_wlc_handle((wlc_handle)data, "output"));
+
+   uint64_t expirations;
+   if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+      return 0;
+
+   struct wlc_output *output;
+   if (!(output = convert_from_wlc_handle((wlc_handle)data, WLC_TYPE_OUTPUT)))
+      return 0;
+
+   // anything that happens from now on needs another frame
+   output->state.activity = false;
+
+   wlc_trace(WLC_TRACE_REPAINT_BEGIN, (wlc_handle)data, 0, 0);
+
+   const uint64_t start = get_time_ns();
+   if (repaint(output)) {
+      const uint64_t end = get_time_ns();
+      output->timing.render[output->timing.index] = end - start;
+      output->timing.index = (output->timing.index + 1) % WLC_OUTPUT_RENDER_HISTORY;
+      record_repaint(output, end - start);
+   } else {
+      output->stats.target = 0;
+   }
+
+   wlc_trace(WLC_TRACE_REPAINT_END, (wlc_handle)data, output->stats.frame.views, output->stats.frame.subsurfaces);
    return 1;
 }
 
 static void
 cancel_repaint(struct wlc_output *output)
 {
-   wl_event_source_timer_update(output->timer.idle, 0);
+   const struct itimerspec its = {{0}};
+   timerfd_settime(output->timer.fd, 0, &its, NULL);
    output->state.scheduled = output->state.activity = false;
 }
 
 void
-wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts)
+wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts, uint64_t seq, uint32_t flags)
 {
    assert(ts);
 
@@ -408,21 +975,40 @@ wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts)
       return;
 
    output->state.pending = false;
+   output->timing.last_flip = timespec_to_ns(ts);
+   wlc_trace(WLC_TRACE_FLIP, convert_to_wlc_handle(output), seq, flags);
+
+   {
+      const uint64_t period = get_refresh_period(output);
+      if (output->stats.swapped && output->timing.last_flip > output->stats.swapped)
+         output->stats.frame.flip = output->timing.last_flip - output->stats.swapped;
+
+      // only real vblanks tell us anything, half a period absorbs clock jitter
+      if ((flags & WLC_PRESENTATION_VSYNC) && output->stats.target && period && output->timing.last_flip > output->stats.target + period / 2) {
+         output->stats.frame.missed++;
+         wlc_trace(WLC_TRACE_MISSED, convert_to_wlc_handle(output), output->timing.last_flip - output->stats.target, 0);
+      }
 
-   // XXX: uint32_t holds mostly for 50 days before overflowing
-   //      is this tied to wayland somewhere, or should we increase precision?
-   const uint32_t last = output->state.frame_time;
-   output->state.frame_time = ts->tv_sec * 1000 + ts->tv_nsec / 1000000;
-   const uint32_t ms = output->state.frame_time - last;
+      output->stats.swapped = output->stats.target = 0;
+   }
+
+   // Frame is on screen now, so this is when clients get to know about it.
+   // wl_callback.done carries milliseconds in uint32_t and wraps, presentation feedback has the full timestamp.
+   send_frame_callbacks(output, output->timing.last_flip / 1000000);
 
-   // TODO: handle presentation feedback here
+   {
+      const uint64_t refresh = ((flags & WLC_PRESENTATION_VSYNC) ? get_refresh_period(output) : 0);
+      flags |= (output->state.scanout ? WLC_PRESENTATION_ZERO_COPY : 0);
+
+      wlc_resource *r;
+      chck_iter_pool_for_each(&output->feedbacks, r)
+         wlc_presentation_feedback_presented(*r, output, ts, refresh, seq, flags);
+      chck_iter_pool_flush(&output->feedbacks);
+   }
 
    if (output->state.activity && !output->task.terminate) {
-      output->state.ims = chck_clampf(output->state.ims * (output->state.activity ? 0.9 : 1.1), 1, 41);
-      wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Interpolated idle time %f (%u : %d)", output->state.ims, ms, output->state.activity);
-      wl_event_source_timer_update(output->timer.idle, output->state.ims);
+      schedule_deadline(output);
       output->state.scheduled = true;
-      output->state.activity = false;
    } else {
       output->state.scheduled = false;
    }
@@ -432,17 +1018,28 @@ wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts)
 }
 
 void
-wlc_output_surface_destroy(struct wlc_output *output, struct wlc_surface *surface)
+wlc_output_discard_frame(struct wlc_output *output)
 {
    if (!output)
       return;
 
-   assert(surface && surface->output == convert_to_wlc_handle(output));
+   // frame never reached the screen, clients still need their frame callbacks to keep going
+   discard_feedbacks(output);
+
+   struct timespec ts;
+   wlc_get_time(&ts);
+   wlc_output_finish_frame(output, &ts, 0, 0);
+}
+
+static void
+detach_surface(struct wlc_output *output, struct wlc_surface *surface)
+{
+   assert(output && surface);
 
-   wlc_render_surface_destroy(&output->render, &output->context, surface);
    surface->output = 0;
 
-   wlc_output_schedule_repaint(output);
+   wlc_output_damage(output, &surface->painted);
+   surface->painted = wlc_geometry_zero;
 
    wlc_resource *r;
    chck_iter_pool_for_each(&output->surfaces, r) {
@@ -456,6 +1053,18 @@ wlc_output_surface_destroy(struct wlc_output *output, struct wlc_surface *surfac
    wlc_dlog(WLC_DBG_RENDER, "-> Deattached surface (%" PRIuWLC ") from output (%" PRIuWLC ")", convert_to_wlc_resource(surface), convert_to_wlc_handle(output));
 }
 
+void
+wlc_output_surface_destroy(struct wlc_output *output, struct wlc_surface *surface)
+{
+   if (!output)
+      return;
+
+   assert(surface && surface->output == convert_to_wlc_handle(output));
+
+   wlc_render_surface_destroy(&output->render, &output->context, surface);
+   detach_surface(output, surface);
+}
+
 bool
 wlc_output_surface_attach(struct wlc_output *output, struct wlc_surface *surface, struct wlc_buffer *buffer)
 {
@@ -464,16 +1073,33 @@ wlc_output_surface_attach(struct wlc_output *output, struct wlc_surface *surface
    if (!output)
       return false;
 
-   bool new_surface = false;
+   bool new_surface = false, moved = false;
    if (surface->output != convert_to_wlc_handle(output)) {
-      wlc_surface_invalidate(surface);
+      struct wlc_output *old = convert_from_wlc_handle(surface->output, WLC_TYPE_OUTPUT);
+
+      // Textures of the surface are usable on outputs whose contexts share them, move instead of uploading again.
+      // Only the current buffer can be carried over, new contents must go through the usual upload.
+      if (old && buffer && buffer == wlc_surface_get_buffer(surface) && wlc_context_shares(&old->context, &output->context)) {
+         detach_surface(old, surface);
+         moved = true;
+      } else {
+         wlc_surface_invalidate(surface);
+      }
+
       surface->output = convert_to_wlc_handle(output);
       new_surface = true;
    }
 
-   if (!wlc_render_surface_attach(&output->render, &output->context, surface, buffer)) {
-      surface->output = 0;
-      return false;
+   if (!moved) {
+      // Buffers are only queried here, upload happens once on repaint.
+      // If client commits multiple buffers before that, the superseded buffers are never touched.
+      const bool attached = (buffer ? wlc_render_buffer_query(&output->render, &output->context, buffer) : wlc_render_surface_attach(&output->render, &output->context, surface, NULL));
+      if (!attached) {
+         surface->output = 0;
+         return false;
+      }
+
+      surface->needs_upload = (buffer ? true : false);
    }
 
    if (new_surface) {
@@ -494,7 +1120,7 @@ static bool
 attach_view(struct wlc_output *output, struct wlc_view *view)
 {
    struct wlc_surface *surface;
-   if (!output || !view || !(surface = convert_from_wlc_resource(view->surface, "surface")))
+   if (!output || !view || !(surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
       return false;
 
    struct wlc_buffer *buffer;
@@ -510,8 +1136,10 @@ wlc_output_schedule_repaint(struct wlc_output *output)
    if (!output)
       return;
 
-   if (!output->state.activity)
+   if (!output->state.activity) {
       wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Activity marked");
+      wlc_trace(WLC_TRACE_ACTIVITY, convert_to_wlc_handle(output), 0, 0);
+   }
 
    output->state.activity = true;
 
@@ -519,10 +1147,74 @@ wlc_output_schedule_repaint(struct wlc_output *output)
       return;
 
    output->state.scheduled = true;
-   wl_event_source_timer_update(output->timer.idle, 1);
+
+   // frame in flight, finishing it schedules the next repaint
+   if (output->state.pending)
+      return;
+
+   schedule_deadline(output);
    wlc_dlog(WLC_DBG_RENDER_LOOP, "-> Repaint scheduled");
 }
 
+void
+wlc_output_damage(struct wlc_output *output, const struct wlc_geometry *geometry)
+{
+   assert(geometry);
+
+   if (!output)
+      return;
+
+   add_damage(output, geometry);
+   wlc_output_schedule_repaint(output);
+}
+
+void
+wlc_output_damage_whole(struct wlc_output *output)
+{
+   if (!output)
+      return;
+
+   // History is damaged as well, so back buffers of any age get repainted fully
+   pixman_box32_t box = { 0, 0, output->virtual.w, output->virtual.h };
+   pixman_region32_reset(&output->damage.current, &box);
+   for (uint32_t i = 0; i < WLC_OUTPUT_DAMAGE_HISTORY; ++i)
+      pixman_region32_reset(&output->damage.previous[i], &box);
+
+   wlc_output_schedule_repaint(output);
+}
+
+bool
+wlc_output_set_cursor(struct wlc_output *output, const uint8_t *argb8888, uint32_t stride, const struct wlc_size *size, uint32_t scale)
+{
+   if (!output || !output->bsurface.api.set_cursor)
+      return false;
+
+   if (!argb8888)
+      return output->bsurface.api.set_cursor(&output->bsurface, NULL, 0, NULL);
+
+   // Cursor plane is not scaled, so image must already be in mode pixels
+   if (!size || output->virtual.w * scale != output->mode.w || output->virtual.h * scale != output->mode.h)
+      return false;
+
+   return output->bsurface.api.set_cursor(&output->bsurface, argb8888, stride, size);
+}
+
+bool
+wlc_output_move_cursor(struct wlc_output *output, const struct wlc_point *pos)
+{
+   assert(pos);
+
+   if (!output || !output->bsurface.api.move_cursor || !output->virtual.w || !output->virtual.h)
+      return false;
+
+   const struct wlc_point p = {
+      pos->x * (int32_t)output->mode.w / (int32_t)output->virtual.w,
+      pos->y * (int32_t)output->mode.h / (int32_t)output->virtual.h,
+   };
+
+   return output->bsurface.api.move_cursor(&output->bsurface, &p);
+}
+
 bool
 wlc_output_set_backend_surface(struct wlc_output *output, struct wlc_backend_surface *bsurface)
 {
@@ -545,7 +1237,7 @@ wlc_output_set_backend_surface(struct wlc_output *output, struct wlc_backend_sur
       wlc_resource *r;
       chck_iter_pool_for_each(&output->surfaces, r) {
          struct wlc_surface *s;
-         if ((s = convert_from_wlc_resource(*r, "surface")))
+         if ((s = convert_from_wlc_resource(*r, WLC_TYPE_SURFACE)))
             wlc_render_surface_destroy(&output->render, &output->context, s);
       }
    }
@@ -575,7 +1267,7 @@ wlc_output_set_backend_surface(struct wlc_output *output, struct wlc_backend_sur
          wlc_resource *r;
          chck_iter_pool_for_each(&output->surfaces, r) {
             struct wlc_surface *s;
-            if (!(s = convert_from_wlc_resource(*r, "surface")))
+            if (!(s = convert_from_wlc_resource(*r, WLC_TYPE_SURFACE)))
                continue;
 
             wlc_surface_attach_to_output(s, output, wlc_surface_get_buffer(s));
@@ -668,25 +1360,126 @@ remove_from_pool(struct chck_iter_pool *pool, wlc_handle handle)
    }
 }
 
-static bool
-exists_in_pool(struct chck_iter_pool *pool, wlc_handle handle)
+static void
+set_mutable_owner(struct wlc_output *output, wlc_handle from, wlc_handle to)
 {
+   assert(output);
+
    wlc_handle *h;
-   chck_iter_pool_for_each(pool, h) {
-      if (*h == handle)
-         return true;
+   chck_iter_pool_for_each(&output->mutable, h) {
+      struct wlc_view *v;
+      if ((v = convert_from_wlc_handle(*h, WLC_TYPE_VIEW)) && v->stack.mutable == from)
+         v->stack.mutable = to;
    }
-   return false;
+}
+
+static void
+unstack_view(struct wlc_view *view, bool keep_mutable)
+{
+   assert(view);
+
+   if (view->stack.output) {
+      struct wlc_output *owner;
+      if ((owner = convert_from_wlc_handle(view->stack.output, WLC_TYPE_OUTPUT))) {
+         wlc_view_grid_remove(&owner->grid, view);
+         owner->state.restacked = true;
+      }
+
+      wl_list_remove(&view->stack.link);
+      wl_list_init(&view->stack.link);
+      view->stack.output = 0;
+   }
+
+   if (keep_mutable || !view->stack.mutable)
+      return;
+
+   struct wlc_output *owner;
+   if ((owner = convert_from_wlc_handle(view->stack.mutable, WLC_TYPE_OUTPUT)))
+      remove_from_pool(&owner->mutable, convert_to_wlc_handle(view));
+
+   view->stack.mutable = 0;
+}
+
+// Leaves room for 2^30 views stacked on either end before orders must be renumbered
+#define STACK_ORDER_BASE ((uint64_t)1 << 62)
+#define STACK_ORDER_STEP ((uint64_t)1 << 32)
+
+static void
+renumber_stack(struct wlc_output *output)
+{
+   assert(output);
+
+   uint64_t order = STACK_ORDER_BASE;
+   struct wlc_view *v;
+   wl_list_for_each(v, &output->stack, stack.link) {
+      v->stack.order = order;
+      order += STACK_ORDER_STEP;
+   }
+}
+
+static void
+order_view(struct wlc_output *output, struct wlc_view *view)
+{
+   assert(output && view);
+
+   struct wlc_view *prev = NULL, *next = NULL;
+   if (view->stack.link.prev != &output->stack)
+      prev = wl_container_of(view->stack.link.prev, prev, stack.link);
+   if (view->stack.link.next != &output->stack)
+      next = wl_container_of(view->stack.link.next, next, stack.link);
+
+   const uint64_t lo = (prev ? prev->stack.order : 0), hi = (next ? next->stack.order : UINT64_MAX);
+
+   if (!prev && !next) {
+      view->stack.order = STACK_ORDER_BASE;
+   } else if (!next && hi - lo > STACK_ORDER_STEP) {
+      view->stack.order = lo + STACK_ORDER_STEP;
+   } else if (!prev && hi > STACK_ORDER_STEP) {
+      view->stack.order = hi - STACK_ORDER_STEP;
+   } else if (hi - lo > 1) {
+      view->stack.order = lo + (hi - lo) / 2;
+   } else {
+      renumber_stack(output);
+   }
+}
+
+static void
+stack_view(struct wlc_output *output, struct wlc_view *view, enum output_link link, struct wlc_view *other)
+{
+   assert(output && view && other != view);
+
+   // restacking within output keeps the view in grid, only the order changes
+   const bool moved = (view->stack.output != convert_to_wlc_handle(output));
+   if (moved)
+      unstack_view(view, true);
+   else
+      wl_list_remove(&view->stack.link);
+
+   struct wl_list *after;
+   if (other)
+      after = (link == LINK_ABOVE ? &other->stack.link : other->stack.link.prev);
+   else
+      after = (link == LINK_ABOVE ? output->stack.prev : &output->stack);
+
+   wl_list_insert(after, &view->stack.link);
+   view->stack.output = convert_to_wlc_handle(output);
+   order_view(output, view);
+   output->state.restacked = true;
+
+   if (moved)
+      wlc_view_grid_invalidate(view);
 }
 
 void
 wlc_output_unlink_view(struct wlc_output *output, struct wlc_view *view)
 {
+   // view must not be left in any stack, even if surface lost its output
+   unstack_view(view, false);
+
    if (!output || wlc_view_get_output_ptr(view) != output)
       return;
 
-   remove_from_pool(&output->views, convert_to_wlc_handle(view));
-   remove_from_pool(&output->mutable, convert_to_wlc_handle(view));
+   damage_painted(output, convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE));
    wlc_output_schedule_repaint(output);
 }
 
@@ -698,42 +1491,28 @@ wlc_output_link_view(struct wlc_output *output, struct wlc_view *view, enum outp
    if (!output)
       return;
 
+   const wlc_handle handle = convert_to_wlc_handle(view);
+   if (view->stack.output != convert_to_wlc_handle(output))
+      unstack_view(view, (view->stack.mutable == convert_to_wlc_handle(output)));
+
    struct wlc_output *old;
    if ((old = wlc_view_get_output_ptr(view))) {
-      remove_from_pool(&old->views, convert_to_wlc_handle(view));
-      if (old != output)
-         remove_from_pool(&old->mutable, convert_to_wlc_handle(view));
+      // restacked or moved, the old area must be repainted
+      damage_painted(old, convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE));
+      wlc_output_schedule_repaint(old);
    }
 
    bool added = false;
-   wlc_handle handle = convert_to_wlc_handle(view);
-
-   if (other) {
-      wlc_handle *h, otherh = convert_to_wlc_handle(other);
-      chck_iter_pool_for_each(&output->views, h) {
-         if (*h != otherh)
-            continue;
-
-         added = chck_iter_pool_insert(&output->views, (link == LINK_ABOVE ? _I : _I - 1), &handle);
-         break;
-      }
-   } else {
-      switch (link) {
-         case LINK_ABOVE:
-            added = chck_iter_pool_push_back(&output->views, &handle);
-            break;
-
-         case LINK_BELOW:
-            added = chck_iter_pool_push_front(&output->views, &handle);
-            break;
-      }
+   if (!other || (other != view && other->stack.output == convert_to_wlc_handle(output))) {
+      stack_view(output, view, link, other);
+      added = true;
    }
 
-   if (!exists_in_pool(&output->mutable, handle))
-      chck_iter_pool_push_back(&output->mutable, &handle);
+   if (!view->stack.mutable && chck_iter_pool_push_back(&output->mutable, &handle))
+      view->stack.mutable = convert_to_wlc_handle(output);
 
    if (old != output && view->state.created)
-      WLC_INTERFACE_EMIT(view.move_to_output, convert_to_wlc_handle(view), convert_to_wlc_handle(old), (added ? convert_to_wlc_handle(output) : 0));
+      WLC_INTERFACE_EMIT(view.move_to_output, handle, convert_to_wlc_handle(old), (added ? convert_to_wlc_handle(output) : 0));
 
    if (!added)
       return;
@@ -762,26 +1541,59 @@ wlc_output_set_resolution_ptr(struct wlc_output *output, const struct wlc_size *
    virtual.w /= scale;
    virtual.h /= scale;
 
-   size_t gsz;
-   if (chck_mul_ofsz(virtual.w, virtual.h, &gsz)) {
-      wlc_log(WLC_LOG_WARN, "Requested resolution %ux%u (%ux%u) overflows when multiplied, ignoring resolution", resolution->w, resolution->h, virtual.w, virtual.h);
+   if (virtual.w > INT32_MAX || virtual.h > INT32_MAX) {
+      wlc_log(WLC_LOG_WARN, "Requested resolution %ux%u (%ux%u) is too large, ignoring resolution", resolution->w, resolution->h, virtual.w, virtual.h);
       return false;
    }
 
-   free(output->blit);
-   except(output->blit = calloc(1, gsz));
-
    struct wlc_size old = output->resolution;
    output->resolution = *resolution;
    output->virtual = virtual;
    output->scale = scale;
 
+   // cells are reallocated and every view is queued for placement again, on failure the old grid stays in use
+   if (!wlc_view_grid_resize(&output->grid, &output->virtual, &output->stack))
+      wlc_log(WLC_LOG_WARN, "Failed to resize view grid of output %" PRIuWLC, convert_to_wlc_handle(output));
+
    output_push_to_resources(output);
    WLC_INTERFACE_EMIT(output.resolution, convert_to_wlc_handle(output), &old, &output->resolution);
-   wlc_output_schedule_repaint(output);
+   wlc_output_damage_whole(output);
    return true;
 }
 
+void
+wlc_output_suspend(struct wlc_output *output, bool suspend)
+{
+   if (!output)
+      return;
+
+   if (!suspend)
+      output->task.suspend = false;
+
+   if (output->state.suspended == suspend)
+      return;
+
+   // page flip in flight must complete before the device is given away
+   if (suspend && output->state.pending) {
+      output->task.suspend = true;
+      return;
+   }
+
+   if (output->bsurface.api.suspend)
+      output->bsurface.api.suspend(&output->bsurface, suspend);
+
+   if (!(output->state.suspended = suspend)) {
+      wlc_output_damage_whole(output);
+      wlc_log(WLC_LOG_INFO, "Output (%p) resumed", output);
+   } else {
+      cancel_repaint(output);
+      wlc_log(WLC_LOG_INFO, "Output (%p) suspended", output);
+   }
+
+   struct wlc_output_event ev = { .surface = { .output = output }, .type = WLC_OUTPUT_EVENT_SURFACE };
+   wl_signal_emit(&wlc_system_signals()->output, &ev);
+}
+
 void
 wlc_output_set_sleep_ptr(struct wlc_output *output, bool sleep)
 {
@@ -800,7 +1612,7 @@ wlc_output_set_sleep_ptr(struct wlc_output *output, bool sleep)
       output->bsurface.api.sleep(&output->bsurface, sleep);
 
    if (!(output->state.sleeping = sleep)) {
-      wlc_output_schedule_repaint(output);
+      wlc_output_damage_whole(output);
       wlc_log(WLC_LOG_INFO, "Output (%p) wake up", output);
    } else {
       if (output->bsurface.api.sleep) {
@@ -835,24 +1647,75 @@ wlc_output_set_mask_ptr(struct wlc_output *output, uint32_t mask)
 bool
 wlc_output_set_views_ptr(struct wlc_output *output, const wlc_handle *views, size_t memb)
 {
-   if (!output || !chck_iter_pool_set_c_array(&output->views, views, memb) || !chck_iter_pool_set_c_array(&output->mutable, views, memb))
+   if (!output)
       return false;
 
-   wlc_handle *h;
-   chck_iter_pool_for_each(&output->views, h)
-      attach_view(output, convert_from_wlc_handle(*h, "view"));
+   const wlc_handle handle = convert_to_wlc_handle(output);
+   set_mutable_owner(output, handle, 0);
 
-   wlc_output_schedule_repaint(output);
+   if (!chck_iter_pool_set_c_array(&output->mutable, views, memb)) {
+      set_mutable_owner(output, 0, handle);
+      return false;
+   }
+
+   // views that stay on output are moved back from old stack, so they keep their place in grid
+   struct wl_list old;
+   wl_list_init(&old);
+   wl_list_insert_list(&old, &output->stack);
+   wl_list_init(&output->stack);
+
+   struct wlc_view *v, *n;
+   for (size_t i = 0; i < memb; ++i) {
+      if (!(v = convert_from_wlc_handle(views[i], WLC_TYPE_VIEW)))
+         continue;
+
+      // views may come from other outputs and appear more than once, last position wins
+      if (v->stack.output != handle)
+         unstack_view(v, (v->stack.mutable == handle));
+
+      stack_view(output, v, LINK_ABOVE, NULL);
+      v->stack.mutable = handle;
+      attach_view(output, v);
+   }
+
+   wl_list_for_each_safe(v, n, &old, stack.link)
+      unstack_view(v, true);
+
+   wlc_output_damage_whole(output);
    return true;
 }
 
+static void
+flatten_stack(struct wlc_output *output)
+{
+   assert(output);
+
+   if (!output->state.restacked)
+      return;
+
+   chck_iter_pool_flush(&output->views);
+
+   struct wlc_view *v;
+   wl_list_for_each(v, &output->stack, stack.link) {
+      const wlc_handle h = convert_to_wlc_handle(v);
+      if (!chck_iter_pool_push_back(&output->views, &h))
+         return;
+   }
+
+   output->state.restacked = false;
+}
+
 const wlc_handle*
 wlc_output_get_views_ptr(struct wlc_output *output, size_t *out_memb)
 {
    if (out_memb)
       *out_memb = 0;
 
-   return (output ? chck_iter_pool_to_c_array(&output->views, out_memb) : NULL);
+   if (!output)
+      return NULL;
+
+   flatten_stack(output);
+   return chck_iter_pool_to_c_array(&output->views, out_memb);
 }
 
 wlc_handle*
@@ -883,51 +1746,57 @@ get(struct wlc_output *output, size_t offset)
 WLC_API const struct wlc_size*
 wlc_output_get_resolution(wlc_handle output)
 {
-   return get(convert_from_wlc_handle(output, "output"), offsetof(struct wlc_output, resolution));
+   return get(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), offsetof(struct wlc_output, resolution));
 }
 
 WLC_API const struct wlc_size*
 wlc_output_get_virtual_resolution(wlc_handle output)
 {
-   return get(convert_from_wlc_handle(output, "output"), offsetof(struct wlc_output, virtual));
+   return get(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), offsetof(struct wlc_output, virtual));
 }
 
 WLC_API void
 wlc_output_set_resolution(wlc_handle output, const struct wlc_size *resolution, uint32_t scale)
 {
-   wlc_output_set_resolution_ptr(convert_from_wlc_handle(output, "output"), resolution, scale);
+   wlc_output_set_resolution_ptr(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), resolution, scale);
+}
+
+WLC_API const struct wlc_frame_stats*
+wlc_output_get_frame_stats(wlc_handle output)
+{
+   return get(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), offsetof(struct wlc_output, stats.frame));
 }
 
 WLC_API uint32_t
 wlc_output_get_scale(wlc_handle output)
 {
-   void *ptr = get(convert_from_wlc_handle(output, "output"), offsetof(struct wlc_output, scale));
+   void *ptr = get(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), offsetof(struct wlc_output, scale));
    return (ptr ? *(uint32_t*)ptr : 1);
 }
 
 WLC_API bool
 wlc_output_get_sleep(wlc_handle output)
 {
-   void *ptr = get(convert_from_wlc_handle(output, "output"), offsetof(struct wlc_output, state.sleeping));
+   void *ptr = get(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), offsetof(struct wlc_output, state.sleeping));
    return (ptr ? *(bool*)ptr : false);
 }
 
 WLC_API void
 wlc_output_set_sleep(wlc_handle output, bool sleep)
 {
-   wlc_output_set_sleep_ptr(convert_from_wlc_handle(output, "output"), sleep);
+   wlc_output_set_sleep_ptr(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), sleep);
 }
 
 WLC_API void
 wlc_output_set_gamma(wlc_handle output, uint16_t size, uint16_t *r, uint16_t *g, uint16_t *b)
 {
-   wlc_output_set_gamma_ptr(convert_from_wlc_handle(output, "output"), size, r, g, b);
+   wlc_output_set_gamma_ptr(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), size, r, g, b);
 }
 
 WLC_API uint16_t
 wlc_output_get_gamma_size(wlc_handle output)
 {
-   struct wlc_output *_output = convert_from_wlc_handle(output, "output");
+   struct wlc_output *_output = convert_from_wlc_handle(output, WLC_TYPE_OUTPUT);
 
    if (!_output || !_output->bsurface.api.get_gamma_size)
       return 0;
@@ -938,44 +1807,44 @@ wlc_output_get_gamma_size(wlc_handle output)
 WLC_API uint32_t
 wlc_output_get_mask(wlc_handle output)
 {
-   void *ptr = get(convert_from_wlc_handle(output, "output"), offsetof(struct wlc_output, active.mask));
+   void *ptr = get(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), offsetof(struct wlc_output, active.mask));
    return (ptr ? *(uint32_t*)ptr : 0);
 }
 
 WLC_API void
 wlc_output_set_mask(wlc_handle output, uint32_t mask)
 {
-   wlc_output_set_mask_ptr(convert_from_wlc_handle(output, "output"), mask);
+   wlc_output_set_mask_ptr(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), mask);
 }
 
 WLC_API const wlc_handle*
 wlc_output_get_views(wlc_handle output, size_t *out_memb)
 {
-   return wlc_output_get_views_ptr(convert_from_wlc_handle(output, "output"), out_memb);
+   return wlc_output_get_views_ptr(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), out_memb);
 }
 
 WLC_API wlc_handle*
 wlc_output_get_mutable_views(wlc_handle output, size_t *out_memb)
 {
-   return wlc_output_get_mutable_views_ptr(convert_from_wlc_handle(output, "output"), out_memb);
+   return wlc_output_get_mutable_views_ptr(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), out_memb);
 }
 
 WLC_API bool
 wlc_output_set_views(wlc_handle output, const wlc_handle *views, size_t memb)
 {
-   return wlc_output_set_views_ptr(convert_from_wlc_handle(output, "output"), views, memb);
+   return wlc_output_set_views_ptr(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT), views, memb);
 }
 
 WLC_API void
 wlc_output_focus(wlc_handle output)
 {
-   wlc_output_focus_ptr(convert_from_wlc_handle(output, "output"));
+   wlc_output_focus_ptr(convert_from_wlc_handle(output, WLC_TYPE_OUTPUT));
 }
 
 WLC_API const char*
 wlc_output_get_name(wlc_handle output)
 {
-   struct wlc_output *o = convert_from_wlc_handle(output, "output");
+   struct wlc_output *o = convert_from_wlc_handle(output, WLC_TYPE_OUTPUT);
    return (o ? o->information.name.data : NULL);
 }
 
@@ -1002,19 +1871,33 @@ wlc_output_release(struct wlc_output *output)
    if (!output)
       return;
 
-   if (output->timer.idle)
-      wl_event_source_remove(output->timer.idle);
+   if (output->timer.repaint) {
+      wl_event_source_remove(output->timer.repaint);
+      close(output->timer.fd);
+   }
 
    wlc_output_set_information(output, NULL);
    wlc_output_set_backend_surface(output, NULL);
+   struct wlc_view *v, *n;
+   wl_list_for_each_safe(v, n, &output->stack, stack.link)
+      unstack_view(v, true);
+
+   set_mutable_owner(output, convert_to_wlc_handle(output), 0);
+   wlc_view_grid_release(&output->grid);
+
    chck_iter_pool_release(&output->surfaces);
    chck_iter_pool_release(&output->views);
    chck_iter_pool_release(&output->mutable);
    chck_iter_pool_release(&output->visible);
    chck_iter_pool_release(&output->callbacks);
 
-   free(output->blit);
-   output->blit = NULL;
+   discard_feedbacks(output);
+   chck_iter_pool_release(&output->feedbacks);
+
+   pixman_region32_fini(&output->damage.current);
+   pixman_region32_fini(&output->damage.pending);
+   for (uint32_t i = 0; i < WLC_OUTPUT_DAMAGE_HISTORY; ++i)
+      pixman_region32_fini(&output->damage.previous[i]);
 
    if (output->wl.output)
       wl_global_destroy(output->wl.output);
@@ -1027,24 +1910,36 @@ wlc_output(struct wlc_output *output)
 {
    assert(output);
 
-   if (!(output->timer.idle = wl_event_loop_add_timer(wlc_event_loop(), cb_idle_timer, (void*)convert_to_wlc_handle(output))))
+   wl_list_init(&output->stack);
+   pixman_region32_init(&output->damage.current);
+   pixman_region32_init(&output->damage.pending);
+   for (uint32_t i = 0; i < WLC_OUTPUT_DAMAGE_HISTORY; ++i)
+      pixman_region32_init(&output->damage.previous[i]);
+
+   if ((output->timer.fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) < 0)
       goto fail;
 
+   if (!(output->timer.repaint = wl_event_loop_add_fd(wlc_event_loop(), output->timer.fd, WL_EVENT_READABLE, cb_repaint_timer, (void*)convert_to_wlc_handle(output)))) {
+      close(output->timer.fd);
+      goto fail;
+   }
+
    if (!(output->wl.output = wl_global_create(wlc_display(), &wl_output_interface, 2, output, wl_output_bind)))
       goto fail;
 
-   if (!wlc_source(&output->resources, "output", NULL, NULL, 32, sizeof(struct wlc_resource)))
+   if (!wlc_source(&output->resources, WLC_TYPE_OUTPUT, NULL, NULL, 32, sizeof(struct wlc_resource)))
       goto fail;
 
    if (!chck_iter_pool(&output->surfaces, 32, 0, sizeof(wlc_resource)) ||
        !chck_iter_pool(&output->views, 4, 0, sizeof(wlc_handle)) ||
        !chck_iter_pool(&output->mutable, 4, 0, sizeof(wlc_handle)) ||
        !chck_iter_pool(&output->callbacks, 32, 0, sizeof(wlc_resource)) ||
-       !chck_iter_pool(&output->visible, 32, 0, sizeof(struct wlc_view*)))
+       !chck_iter_pool(&output->feedbacks, 4, 0, sizeof(wlc_resource)) ||
+       !chck_iter_pool(&output->visible, 32, 0, sizeof(struct wlc_view*)) ||
+       !wlc_view_grid(&output->grid))
       goto fail;
 
    output->active.mode = UINT_MAX;
-   output->state.ims = 41;
    output->scale = 1;
 
    wlc_output_set_sleep_ptr(output, false);
@@ -1064,15 +1959,36 @@ wlc_output_render_surface(struct wlc_output *output, struct wlc_surface *surface
    if (surface->output != convert_to_wlc_resource(output) && !wlc_surface_attach_to_output(surface, output, wlc_surface_get_buffer(surface)))
       return;
 
+   // may have been attached just now
+   upload_surface(output, surface);
+
    if (!surface->commit.attached)
       return;
 
+   if (!wlc_geometry_equals(&surface->painted, geometry)) {
+      // we are already rendering, so this goes to pending damage and gets repaired on next frame
+      wlc_output_damage(output, &surface->painted);
+      wlc_output_damage(output, geometry);
+      surface->painted = *geometry;
+   }
+
    wlc_render_surface_paint(&output->render, &output->context, surface, geometry);
+   wlc_output_take_frame_callbacks(output, surface, callbacks);
+}
+
+void
+wlc_output_take_frame_callbacks(struct wlc_output *output, struct wlc_surface *surface, struct chck_iter_pool *callbacks)
+{
+   assert(output && surface && callbacks);
 
    wlc_resource *r;
    chck_iter_pool_for_each(&surface->commit.frame_cbs, r)
       chck_iter_pool_push_back(callbacks, r);
    chck_iter_pool_flush(&surface->commit.frame_cbs);
+
+   chck_iter_pool_for_each(&surface->commit.feedbacks, r)
+      chck_iter_pool_push_back(&output->feedbacks, r);
+   chck_iter_pool_flush(&surface->commit.feedbacks);
 }
 
 struct wlc_output*
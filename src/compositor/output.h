@@ -3,12 +3,14 @@
 
 #include <stdint.h>
 #include <wayland-util.h>
+#include <pixman.h>
 #include <chck/string/string.h>
 #include <chck/pool/pool.h>
 #include "platform/backend/backend.h"
 #include "platform/context/context.h"
 #include "platform/render/render.h"
 #include "resources/resources.h"
+#include "compositor/view-grid.h"
 #include "internal.h"
 
 struct wl_global;
@@ -16,6 +18,12 @@ struct wlc_surface;
 struct wlc_buffer;
 struct timespec;
 
+// How many frames of damage history we keep for repairing older back buffers
+#define WLC_OUTPUT_DAMAGE_HISTORY 4
+
+// How many repaint durations we keep for predicting the repaint deadline
+#define WLC_OUTPUT_RENDER_HISTORY 8
+
 enum output_link {
    LINK_BELOW,
    LINK_ABOVE,
@@ -47,22 +55,53 @@ struct wlc_output {
    struct wlc_context context;
    struct wlc_render render;
 
+   // Views from bottom to top, linked through wlc_view.stack so restacking doesn't move memory.
+   // Views pool is flattened from it only when the API asks and state.restacked is set.
+   struct wl_list stack;
+
+   // Finds topmost view under pointer and touch without walking the stack
+   struct wlc_view_grid grid;
+
    // XXX: maybe we can use source later and provide move semantics (for views)?
    struct chck_iter_pool surfaces, views, mutable;
-   struct chck_iter_pool callbacks, visible;
+   struct chck_iter_pool callbacks, feedbacks, visible;
+
+   // Damage in virtual resolution coordinates
+   // Current is accumulated until next repaint, previous holds damage of the last frames
+   struct {
+      pixman_region32_t current;
+      pixman_region32_t pending; // added while rendering, becomes current once the frame is pushed to history
+      pixman_region32_t previous[WLC_OUTPUT_DAMAGE_HISTORY];
+      uint32_t index;
+   } damage;
 
-   // Pixel blit buffer size of current resolution
-   // Used to do visibility checks
-   bool *blit;
+   // Views shown on backend overlay planes in the last frame
+   wlc_handle overlays[WLC_BACKEND_MAX_OVERLAYS];
 
    // Scale of the output
    // Affects virtual resolution by dividing with the scale
    uint32_t scale;
 
    struct {
-      struct wl_event_source *idle;
+      struct wl_event_source *repaint;
+      int fd; // timerfd armed with absolute CLOCK_MONOTONIC deadlines
    } timer;
 
+   // Repaint scheduling, times are CLOCK_MONOTONIC nanoseconds
+   struct {
+      uint64_t last_flip; // when the last frame hit the screen
+      uint64_t render[WLC_OUTPUT_RENDER_HISTORY]; // how long recent repaints took
+      uint32_t index;
+   } timing;
+
+   // Exposed with wlc_output_get_frame_stats
+   struct {
+      struct wlc_frame_stats frame;
+      uint8_t window[WLC_FRAME_STATS_WINDOW]; // histogram bucket of recent repaints
+      uint64_t swapped; // when the last repaint handed frame to backend
+      uint64_t target; // vblank the scheduled repaint aims for, 0 if not predicted
+   } stats;
+
    struct {
       struct wl_global *output;
    } wl;
@@ -72,13 +111,15 @@ struct wlc_output {
       struct wlc_backend_surface bsurface;
       bool terminate;
       bool sleep;
+      bool suspend;
    } task;
 
    struct {
-      float ims;
-      uint32_t frame_time;
       bool pending, scheduled, activity, sleeping;
+      bool suspended; // session is inactive, context and textures are kept for resume
       bool background_visible;
+      bool scanout; // last frame was a client buffer flipped directly by backend
+      bool restacked; // views pool is out of date with stack
       bool created;
    } state;
 
@@ -92,14 +133,20 @@ WLC_NONULL bool wlc_output_information(struct wlc_output_information *info);
 void wlc_output_information_release(struct wlc_output_information *info);
 WLC_NONULL bool wlc_output_information_add_mode(struct wlc_output_information *info, struct wlc_output_mode *mode);
 
-WLC_NONULLV(2) void wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts);
+WLC_NONULLV(2) void wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts, uint64_t seq, uint32_t flags);
+void wlc_output_discard_frame(struct wlc_output *output);
 void wlc_output_schedule_repaint(struct wlc_output *output);
+WLC_NONULLV(2) void wlc_output_damage(struct wlc_output *output, const struct wlc_geometry *geometry);
+void wlc_output_damage_whole(struct wlc_output *output);
+bool wlc_output_set_cursor(struct wlc_output *output, const uint8_t *argb8888, uint32_t stride, const struct wlc_size *size, uint32_t scale);
+WLC_NONULLV(2) bool wlc_output_move_cursor(struct wlc_output *output, const struct wlc_point *pos);
 WLC_NONULLV(2) bool wlc_output_surface_attach(struct wlc_output *output, struct wlc_surface *surface, struct wlc_buffer *buffer);
 WLC_NONULLV(2) void wlc_output_surface_destroy(struct wlc_output *output, struct wlc_surface *surface);
 bool wlc_output_set_backend_surface(struct wlc_output *output, struct wlc_backend_surface *surface);
 void wlc_output_set_information(struct wlc_output *output, struct wlc_output_information *info);
 WLC_NONULLV(2) void wlc_output_unlink_view(struct wlc_output *output, struct wlc_view *view);
 WLC_NONULLV(2) void wlc_output_link_view(struct wlc_output *output, struct wlc_view *view, enum output_link link, struct wlc_view *other);
+void wlc_output_suspend(struct wlc_output *output, bool suspend);
 void wlc_output_terminate(struct wlc_output *output);
 void wlc_output_release(struct wlc_output *output);
 WLC_NONULL bool wlc_output(struct wlc_output *output);
@@ -114,6 +161,8 @@ bool wlc_output_set_views_ptr(struct wlc_output *output, const wlc_handle *views
 const wlc_handle* wlc_output_get_views_ptr(struct wlc_output *output, size_t *out_memb);
 wlc_handle* wlc_output_get_mutable_views_ptr(struct wlc_output *output, size_t *out_memb);
 
+WLC_NONULL void wlc_output_take_frame_callbacks(struct wlc_output *output, struct wlc_surface *surface, struct chck_iter_pool *callbacks);
+
 /** for wlc-render.h */
 WLC_NONULL void wlc_output_render_surface(struct wlc_output *output, struct wlc_surface *surface, const struct wlc_geometry *geometry, struct chck_iter_pool *callbacks);
 struct wlc_output* wlc_get_rendering_output(void);
@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <wayland-server.h>
+#include "wayland-presentation-time-server-protocol.h"
+#include "internal.h"
+#include "macros.h"
+#include "presentation.h"
+#include "compositor/output.h"
+#include "resources/types/surface.h"
+
+void
+wlc_presentation_feedback_presented(wlc_resource feedback, struct wlc_output *output, const struct timespec *ts, uint32_t refresh, uint64_t seq, uint32_t flags)
+{
+   assert(output && ts);
+
+   struct wl_resource *resource;
+   if (!(resource = wl_resource_from_wlc_resource(feedback, WLC_TYPE_PRESENTATION_FEEDBACK)))
+      return;
+
+   struct wl_client *client = wl_resource_get_client(resource);
+
+   wlc_resource *r;
+   wlc_slab_for_each(&output->resources.pool, r) {
+      struct wl_resource *wr;
+      if ((wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_OUTPUT)) && wl_resource_get_client(wr) == client)
+         wp_presentation_feedback_send_sync_output(resource, wr);
+   }
+
+   const uint64_t sec = ts->tv_sec;
+   wp_presentation_feedback_send_presented(resource, sec >> 32, sec & 0xffffffff, ts->tv_nsec, refresh, seq >> 32, seq & 0xffffffff, flags);
+   wlc_resource_release(feedback);
+}
+
+void
+wlc_presentation_feedback_discarded(wlc_resource feedback)
+{
+   struct wl_resource *resource;
+   if ((resource = wl_resource_from_wlc_resource(feedback, WLC_TYPE_PRESENTATION_FEEDBACK)))
+      wp_presentation_feedback_send_discarded(resource);
+
+   wlc_resource_release(feedback);
+}
+
+static void
+wp_presentation_feedback(struct wl_client *client, struct wl_resource *resource, struct wl_resource *surface_resource, uint32_t id)
+{
+   struct wlc_surface *surface;
+   struct wlc_presentation *presentation;
+   if (!(presentation = wl_resource_get_user_data(resource)) || !(surface = convert_from_wl_resource(surface_resource, WLC_TYPE_SURFACE)))
+      return;
+
+   wlc_resource r;
+   if (!(r = wlc_resource_create(&presentation->feedbacks, client, &wp_presentation_feedback_interface, wl_resource_get_version(resource), 1, id)))
+      return;
+
+   wlc_resource_implement(r, NULL, NULL);
+
+   if (!chck_iter_pool_push_back(&surface->pending.feedbacks, &r))
+      wlc_presentation_feedback_discarded(r);
+}
+
+static const struct wp_presentation_interface wp_presentation_implementation = {
+   .destroy = wlc_cb_resource_destructor,
+   .feedback = wp_presentation_feedback,
+};
+
+static void
+wp_presentation_bind(struct wl_client *client, void *data, unsigned int version, unsigned int id)
+{
+   struct wl_resource *resource;
+   if (!(resource = wl_resource_create_checked(client, &wp_presentation_interface, version, 1, id)))
+      return;
+
+   wl_resource_set_implementation(resource, &wp_presentation_implementation, data, NULL);
+
+   // timestamps from backends are all in this clock domain
+   wp_presentation_send_clock_id(resource, CLOCK_MONOTONIC);
+}
+
+void
+wlc_presentation_release(struct wlc_presentation *presentation)
+{
+   if (!presentation)
+      return;
+
+   if (presentation->wl.presentation)
+      wl_global_destroy(presentation->wl.presentation);
+
+   wlc_source_release(&presentation->feedbacks);
+   memset(presentation, 0, sizeof(struct wlc_presentation));
+}
+
+bool
+wlc_presentation(struct wlc_presentation *presentation)
+{
+   assert(presentation);
+   memset(presentation, 0, sizeof(struct wlc_presentation));
+
+   if (!(presentation->wl.presentation = wl_global_create(wlc_display(), &wp_presentation_interface, 1, presentation, wp_presentation_bind)))
+      goto presentation_interface_fail;
+
+   if (!wlc_source(&presentation->feedbacks, WLC_TYPE_PRESENTATION_FEEDBACK, NULL, NULL, 32, sizeof(struct wlc_resource)))
+      goto fail;
+
+   return true;
+
+presentation_interface_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to bind presentation interface");
+fail:
+   wlc_presentation_release(presentation);
+   return false;
+}
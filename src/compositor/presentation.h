@@ -0,0 +1,35 @@
+#ifndef _WLC_PRESENTATION_H_
+#define _WLC_PRESENTATION_H_
+
+#include <stdint.h>
+#include "resources/resources.h"
+
+struct timespec;
+struct wlc_output;
+
+// How the frame reached the screen, values match wp_presentation_feedback.kind
+enum wlc_presentation_flags {
+   WLC_PRESENTATION_VSYNC = 0x1,
+   WLC_PRESENTATION_HW_CLOCK = 0x2,
+   WLC_PRESENTATION_HW_COMPLETION = 0x4,
+   WLC_PRESENTATION_ZERO_COPY = 0x8,
+};
+
+struct wlc_presentation {
+   struct wlc_source feedbacks;
+
+   struct {
+      struct wl_global *presentation;
+   } wl;
+};
+
+/** Send presented event and destroy the feedback. Refresh is in nanoseconds, 0 if unknown. */
+WLC_NONULLV(2,3) void wlc_presentation_feedback_presented(wlc_resource feedback, struct wlc_output *output, const struct timespec *ts, uint32_t refresh, uint64_t seq, uint32_t flags);
+
+/** Send discarded event and destroy the feedback, content update never reached the screen. */
+void wlc_presentation_feedback_discarded(wlc_resource feedback);
+
+void wlc_presentation_release(struct wlc_presentation *presentation);
+WLC_NONULL bool wlc_presentation(struct wlc_presentation *presentation);
+
+#endif /* _WLC_PRESENTATION_H_ */
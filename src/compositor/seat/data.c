@@ -73,7 +73,7 @@ static struct wl_data_offer_interface wl_data_offer_implementation = {
 static void
 data_source_client_send(struct wlc_data_source *data_source, const char *type, int fd)
 {
-   struct wl_resource *res = convert_to_wl_resource(data_source, "data-source");
+   struct wl_resource *res = convert_to_wl_resource(data_source, WLC_TYPE_DATA_SOURCE);
    wl_data_source_send_send(res, type, fd);
    close(fd);
 }
@@ -81,13 +81,13 @@ data_source_client_send(struct wlc_data_source *data_source, const char *type, i
 static void
 data_source_client_accept(struct wlc_data_source *data_source, const char *type)
 {
-   wl_data_source_send_target(convert_to_wl_resource(data_source, "data-source"), type);
+   wl_data_source_send_target(convert_to_wl_resource(data_source, WLC_TYPE_DATA_SOURCE), type);
 }
 
 static void
 data_source_client_cancel(struct wlc_data_source *data_source)
 {
-   struct wl_resource *res = convert_to_wl_resource(data_source, "data-source");
+   struct wl_resource *res = convert_to_wl_resource(data_source, WLC_TYPE_DATA_SOURCE);
    if (res)
       wl_data_source_send_cancelled(res);
 }
@@ -95,7 +95,7 @@ data_source_client_cancel(struct wlc_data_source *data_source)
 static void
 data_source_client_dnd_finished(struct wlc_data_source *data_source)
 {
-   struct wl_resource *res = convert_to_wl_resource(data_source, "data-source");
+   struct wl_resource *res = convert_to_wl_resource(data_source, WLC_TYPE_DATA_SOURCE);
    wl_data_source_send_dnd_finished(res);
 }
 
@@ -112,7 +112,7 @@ wl_cb_data_source_offer(struct wl_client *client, struct wl_resource *resource,
    (void)client;
 
    struct wlc_data_source *source;
-   if (!(source = convert_from_wl_resource(resource, "data-source")))
+   if (!(source = convert_from_wl_resource(resource, WLC_TYPE_DATA_SOURCE)))
       return;
 
    struct chck_string *destination;
@@ -126,7 +126,7 @@ static void
 wl_cb_data_source_destroy(struct wl_client *client, struct wl_resource *resource)
 {
    struct wlc_data_device_manager *manager = wl_resource_get_user_data(resource);
-   struct wlc_data_source *source = convert_from_wl_resource(resource, "data-source");
+   struct wlc_data_source *source = convert_from_wl_resource(resource, WLC_TYPE_DATA_SOURCE);
    if (source && manager->source == source)
       wlc_data_device_manager_set_source(manager, NULL);
    wlc_cb_resource_destructor(client, resource);
@@ -138,7 +138,7 @@ wl_cb_data_source_set_actions(struct wl_client *client, struct wl_resource *reso
    (void)client;
 
    struct wlc_data_source *source;
-   if (!(source = convert_from_wl_resource(resource, "data-source")))
+   if (!(source = convert_from_wl_resource(resource, WLC_TYPE_DATA_SOURCE)))
       return;
 
    source->src_dnd_actions = dnd_actions;
@@ -161,7 +161,7 @@ wl_cb_manager_create_data_source(struct wl_client *client, struct wl_resource *r
    if (!(r = wlc_resource_create(&manager->sources, client, &wl_data_source_interface, wl_resource_get_version(resource), 3, id)))
       return;
 
-   struct wlc_data_source *source = convert_from_wlc_resource(r, "data-source");
+   struct wlc_data_source *source = convert_from_wlc_resource(r, WLC_TYPE_DATA_SOURCE);
    source->impl = &data_source_client_impl;
    wlc_resource_implement(r, &wl_data_source_implementation, manager);
 }
@@ -182,7 +182,7 @@ wl_cb_data_device_set_selection(struct wl_client *client, struct wl_resource *re
    if (!(manager = wl_resource_get_user_data(resource)))
       return;
 
-   struct wlc_data_source *source = (struct wlc_data_source*) convert_from_wl_resource(source_resource, "data-source");
+   struct wlc_data_source *source = (struct wlc_data_source*) convert_from_wl_resource(source_resource, WLC_TYPE_DATA_SOURCE);
    if (!source || source == manager->source)
       return;
 
@@ -242,16 +242,16 @@ wlc_data_device_manager_offer(struct wlc_data_device_manager *manager, struct wl
 
    if (offer) {
       wlc_resource_implement(offer, &wl_data_offer_implementation, (void*)manager->source);
-      wl_data_device_send_data_offer(resource, wl_resource_from_wlc_resource(offer, "data-offer"));
+      wl_data_device_send_data_offer(resource, wl_resource_from_wlc_resource(offer, WLC_TYPE_DATA_OFFER));
 
       if (offer && source) {
          struct chck_string *type;
          chck_iter_pool_for_each(&source->types, type)
-            wl_data_offer_send_offer(wl_resource_from_wlc_resource(offer, "data-offer"), type->data);
+            wl_data_offer_send_offer(wl_resource_from_wlc_resource(offer, WLC_TYPE_DATA_OFFER), type->data);
       }
    }
 
-   wl_data_device_send_selection(resource, wl_resource_from_wlc_resource(offer, "data-offer"));
+   wl_data_device_send_selection(resource, wl_resource_from_wlc_resource(offer, WLC_TYPE_DATA_OFFER));
 }
 
 void
@@ -283,9 +283,9 @@ wlc_data_device_manager(struct wlc_data_device_manager *manager, struct wlc_seat
    if (!(manager->wl.manager = wl_global_create(wlc_display(), &wl_data_device_manager_interface, 3, manager, wl_data_device_manager_bind)))
       goto manager_interface_fail;
 
-   if (!wlc_source(&manager->sources, "data-source", wlc_data_source, wlc_data_source_release, 32, sizeof(struct wlc_data_source)) ||
-       !wlc_source(&manager->devices, "data-device", NULL, NULL, 32, sizeof(struct wlc_resource)) ||
-       !wlc_source(&manager->offers, "data-offer", NULL, NULL, 32, sizeof(struct wlc_resource)))
+   if (!wlc_source(&manager->sources, WLC_TYPE_DATA_SOURCE, wlc_data_source, wlc_data_source_release, 32, sizeof(struct wlc_data_source)) ||
+       !wlc_source(&manager->devices, WLC_TYPE_DATA_DEVICE, NULL, NULL, 32, sizeof(struct wlc_resource)) ||
+       !wlc_source(&manager->offers, WLC_TYPE_DATA_OFFER, NULL, NULL, 32, sizeof(struct wlc_resource)))
       goto fail;
 
    return true;
@@ -306,7 +306,7 @@ void wlc_data_device_manager_set_source(struct wlc_data_device_manager *manager,
    wl_signal_emit(&wlc_system_signals()->selection, source);
 
    if (manager->seat->keyboard.focused.view) {
-      struct wlc_view *focused = convert_from_wlc_handle(manager->seat->keyboard.focused.view, "view");
+      struct wlc_view *focused = convert_from_wlc_handle(manager->seat->keyboard.focused.view, WLC_TYPE_VIEW);
       struct wl_client *client = wlc_view_get_client_ptr(focused);
       assert(client);
 
@@ -7,6 +7,8 @@
 #include "keyboard.h"
 #include "keymap.h"
 #include "compositor/view.h"
+#include "xwayland/xwayland.h"
+#include <chck/math/math.h>
 #include <chck/unicode/unicode.h>
 
 static bool
@@ -48,7 +50,7 @@ send_release_for_keys(struct chck_iter_pool *resources, struct chck_iter_pool *k
       wlc_resource *r;
       chck_iter_pool_for_each(resources, r) {
          struct wl_resource *wr;
-         if (!(wr = wl_resource_from_wlc_resource(*r, "keyboard")))
+         if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_KEYBOARD)))
             continue;
 
          uint32_t serial = wl_display_next_serial(wlc_display());
@@ -103,12 +105,23 @@ cb_repeat(void *data)
    return 1;
 }
 
+static uint32_t
+repeat_interval(const struct wlc_keyboard *keyboard)
+{
+   assert(keyboard);
+   return (keyboard->repeat.rate > 0 ? chck_maxu32(1000 / keyboard->repeat.rate, 1) : 0);
+}
+
 static void
 begin_repeat(struct wlc_keyboard *keyboard, bool focused)
 {
+   // Delayed send on focus is not repeating, so it happens even if rate is 0.
+   if (!focused && keyboard->repeat.rate == 0)
+      return;
+
    keyboard->state.repeat = true;
    keyboard->state.focused = focused;
-   const uint32_t delay = (keyboard->state.repeating ? keyboard->repeat.rate : keyboard->repeat.delay);
+   const uint32_t delay = (keyboard->state.repeating && keyboard->repeat.rate > 0 ? repeat_interval(keyboard) : keyboard->repeat.delay);
    wl_event_source_timer_update(keyboard->timer.repeat, delay);
    wlc_dlog(WLC_DBG_KEYBOARD, "begin wlc key repeat (%d : %d)", focused, keyboard->state.repeating);
 }
@@ -124,13 +137,98 @@ reset_repeat(struct wlc_keyboard *keyboard)
    wlc_dlog(WLC_DBG_KEYBOARD, "canceled wlc key repeat");
 }
 
+static bool
+repeats_for_client(struct wl_resource *wr)
+{
+   assert(wr);
+
+   // Xwayland repeats by itself with the X server's autorepeat settings
+   return (wl_resource_get_version(wr) < WL_KEYBOARD_REPEAT_INFO_SINCE_VERSION && wl_resource_get_client(wr) != wlc_xwayland_get_client());
+}
+
+static bool
+needs_emulation(struct wlc_keyboard *keyboard)
+{
+   assert(keyboard);
+
+   wlc_resource *r;
+   chck_iter_pool_for_each(&keyboard->focused.resources, r) {
+      struct wl_resource *wr;
+      if ((wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_KEYBOARD)) && repeats_for_client(wr))
+         return true;
+   }
+
+   return false;
+}
+
+static int
+cb_emulate(void *data)
+{
+   struct wlc_keyboard *keyboard;
+   except((keyboard = data));
+
+   if (!keyboard->emulate.active)
+      return 0;
+
+   // Only clients that got no repeat_info see the repeats, others repeat by themselves.
+   // The press is sent directly, so it does not go through the input path and interface.
+   wlc_resource *r;
+   uint32_t sent = 0;
+   const uint32_t time = wlc_get_time(NULL);
+   chck_iter_pool_for_each(&keyboard->focused.resources, r) {
+      struct wl_resource *wr;
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_KEYBOARD)) || !repeats_for_client(wr))
+         continue;
+
+      uint32_t serial = wl_display_next_serial(wlc_display());
+      wl_keyboard_send_key(wr, serial, time, keyboard->emulate.key, WL_KEYBOARD_KEY_STATE_PRESSED);
+      ++sent;
+   }
+
+   // Legacy resources went away while key was held, no need to keep waking up.
+   if (sent == 0) {
+      keyboard->emulate.active = false;
+      return 0;
+   }
+
+   wl_event_source_timer_update(keyboard->timer.emulate, repeat_interval(keyboard));
+   return 1;
+}
+
+static void
+begin_emulation(struct wlc_keyboard *keyboard, uint32_t key)
+{
+   assert(keyboard);
+
+   if (keyboard->repeat.rate == 0 || !keyboard->keymap || !xkb_keymap_key_repeats(keyboard->keymap->keymap, key + 8) || !needs_emulation(keyboard))
+      return;
+
+   keyboard->emulate.key = key;
+   keyboard->emulate.active = true;
+   wl_event_source_timer_update(keyboard->timer.emulate, keyboard->repeat.delay);
+   wlc_dlog(WLC_DBG_KEYBOARD, "begin client key repeat emulation: %u", key);
+}
+
+static void
+end_emulation(struct wlc_keyboard *keyboard)
+{
+   assert(keyboard);
+
+   if (!keyboard->emulate.active)
+      return;
+
+   wl_event_source_timer_update(keyboard->timer.emulate, 0);
+   keyboard->emulate.active = false;
+   wlc_dlog(WLC_DBG_KEYBOARD, "end client key repeat emulation");
+}
+
 static void
 defocus(struct wlc_keyboard *keyboard, struct wlc_view *new_focus)
 {
    assert(keyboard);
 
    struct wlc_view *view;
-   if (!(view = convert_from_wlc_handle(keyboard->focused.view, "view")))
+   if (!(view = convert_from_wlc_handle(keyboard->focused.view, WLC_TYPE_VIEW)))
       goto out;
 
    // Xwayland does own key repeating.
@@ -139,7 +237,7 @@ defocus(struct wlc_keyboard *keyboard, struct wlc_view *new_focus)
    send_release_for_keys(&keyboard->focused.resources, &keyboard->keys);
 
    struct wl_resource *surface;
-   if (!(surface = wl_resource_from_wlc_resource(view->surface, "surface")))
+   if (!(surface = wl_resource_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
       goto out;
 
    if (is_x11_view(view) && (!new_focus || !is_x11_view(new_focus)))
@@ -148,7 +246,7 @@ defocus(struct wlc_keyboard *keyboard, struct wlc_view *new_focus)
    wlc_resource *r;
    chck_iter_pool_for_each(&keyboard->focused.resources, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "keyboard")))
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_KEYBOARD)))
          continue;
 
       uint32_t serial = wl_display_next_serial(wlc_display());
@@ -163,7 +261,7 @@ defocus(struct wlc_keyboard *keyboard, struct wlc_view *new_focus)
 
       {
          struct wl_resource *surface;
-         if (new_focus && (surface = wl_resource_from_wlc_resource(new_focus->surface, "surface")))
+         if (new_focus && (surface = wl_resource_from_wlc_resource(new_focus->surface, WLC_TYPE_SURFACE)))
             new_client = wl_resource_get_client(surface);
       }
 
@@ -182,14 +280,14 @@ focus_view(struct wlc_keyboard *keyboard, struct wlc_view *view)
    assert(keyboard);
 
    struct wl_resource *surface;
-   if (!view || !(surface = wl_resource_from_wlc_resource(view->surface, "surface")))
+   if (!view || !(surface = wl_resource_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
       return;
 
    wlc_resource *r;
    struct wl_client *client = wl_resource_get_client(surface);
-   chck_pool_for_each(&keyboard->resources.pool, r) {
+   wlc_slab_for_each(&keyboard->resources.pool, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "keyboard")) || wl_resource_get_client(wr) != client)
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_KEYBOARD)) || wl_resource_get_client(wr) != client)
          continue;
 
       if (!chck_iter_pool_push_back(&keyboard->focused.resources, r))
@@ -328,7 +426,7 @@ wlc_keyboard_update_modifiers(struct wlc_keyboard *keyboard, struct libinput_dev
    struct wlc_resource *r;
    chck_iter_pool_for_each(&keyboard->focused.resources, r) {
       struct wl_resource *resource;
-      if (!(resource = convert_to_wl_resource(r, "keyboard")))
+      if (!(resource = convert_to_wl_resource(r, WLC_TYPE_KEYBOARD)))
          continue;
 
       uint32_t serial = wl_display_next_serial(wlc_display());
@@ -371,6 +469,10 @@ wlc_keyboard_update(struct wlc_keyboard *keyboard, uint32_t key, enum wl_keyboar
    if (ret)
       reset_repeat(keyboard);
 
+   // Release may be consumed by interface, so emulation is stopped here rather than in wlc_keyboard_key.
+   if (state == WL_KEYBOARD_KEY_STATE_RELEASED && keyboard->emulate.active && keyboard->emulate.key == key)
+      end_emulation(keyboard);
+
    return ret;
 }
 
@@ -382,12 +484,15 @@ wlc_keyboard_key(struct wlc_keyboard *keyboard, uint32_t time, uint32_t key, enu
    wlc_resource *r;
    chck_iter_pool_for_each(&keyboard->focused.resources, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "keyboard")))
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_KEYBOARD)))
          continue;
 
       uint32_t serial = wl_display_next_serial(wlc_display());
       wl_keyboard_send_key(wr, serial, time, key, state);
    }
+
+   if (state == WL_KEYBOARD_KEY_STATE_PRESSED)
+      begin_emulation(keyboard, key);
 }
 
 void
@@ -403,6 +508,7 @@ wlc_keyboard_focus(struct wlc_keyboard *keyboard, struct wlc_view *view)
    if (!keyboard->state.repeating)
       reset_repeat(keyboard);
 
+   end_emulation(keyboard);
    defocus(keyboard, view);
    focus_view(keyboard, view);
 }
@@ -447,6 +553,9 @@ wlc_keyboard_release(struct wlc_keyboard *keyboard)
    if (keyboard->timer.repeat)
       wl_event_source_remove(keyboard->timer.repeat);
 
+   if (keyboard->timer.emulate)
+      wl_event_source_remove(keyboard->timer.emulate);
+
    chck_iter_pool_release(&keyboard->keys);
    chck_iter_pool_release(&keyboard->focused.resources);
    wlc_source_release(&keyboard->resources);
@@ -466,17 +575,18 @@ wlc_keyboard(struct wlc_keyboard *keyboard, struct wlc_keymap *keymap)
        !chck_iter_pool(&keyboard->focused.resources, 4, 0, sizeof(wlc_resource)))
       goto fail;
 
-   if (!wlc_source(&keyboard->resources, "keyboard", NULL, NULL, 32, sizeof(struct wlc_resource)))
+   if (!wlc_source(&keyboard->resources, WLC_TYPE_KEYBOARD, NULL, NULL, 32, sizeof(struct wlc_resource)))
       goto fail;
 
-   if (!(keyboard->timer.repeat = wl_event_loop_add_timer(wlc_event_loop(), cb_repeat, keyboard)))
+   if (!(keyboard->timer.repeat = wl_event_loop_add_timer(wlc_event_loop(), cb_repeat, keyboard)) ||
+       !(keyboard->timer.emulate = wl_event_loop_add_timer(wlc_event_loop(), cb_emulate, keyboard)))
       goto fail;
 
    if (!chck_cstr_to_u32(getenv("WLC_REPEAT_DELAY"), &keyboard->repeat.delay))
       keyboard->repeat.delay = 660;
 
    if (!chck_cstr_to_u32(getenv("WLC_REPEAT_RATE"), &keyboard->repeat.rate))
-      keyboard->repeat.rate = 25;
+      keyboard->repeat.rate = 40;
 
    return true;
 
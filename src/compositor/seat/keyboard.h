@@ -23,7 +23,8 @@ struct wlc_keyboard {
    struct chck_iter_pool keys;
 
    struct {
-      struct wl_event_source *repeat;
+      struct wl_event_source *repeat; // interface bindings and delayed keys on focus
+      struct wl_event_source *emulate; // clients bound before wl_keyboard.repeat_info
    } timer;
 
    struct {
@@ -42,9 +43,16 @@ struct wlc_keyboard {
    struct wlc_modifiers modifiers;
 
    struct {
-      uint32_t delay, rate;
+      uint32_t delay; // milliseconds before first repeat
+      uint32_t rate; // repeats per second, 0 disables repeating
    } repeat;
 
+   // key repeated to focused clients that do not repeat by themselves
+   struct {
+      uint32_t key;
+      bool active;
+   } emulate;
+
    struct {
       struct xkb_state *xkb, *sym;
       bool repeat, repeating, focused;
@@ -12,6 +12,7 @@
 #include "compositor/view.h"
 #include "compositor/output.h"
 #include "resources/types/surface.h"
+#include "resources/types/buffer.h"
 
 static struct wl_client*
 focused_client(struct wlc_pointer *pointer)
@@ -21,7 +22,7 @@ focused_client(struct wlc_pointer *pointer)
    wlc_resource *r;
    struct wl_resource *wr = NULL;
    chck_iter_pool_for_each(&pointer->focused.resources, r) {
-      if ((wr = wl_resource_from_wlc_resource(*r, "pointer")))
+      if ((wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_POINTER)))
          break;
    }
 
@@ -41,7 +42,7 @@ wl_cb_pointer_set_cursor(struct wl_client *client, struct wl_resource *resource,
    if (focused_client(pointer) != client)
       return;
 
-   struct wlc_surface *surface = convert_from_wl_resource(surface_resource, "surface");
+   struct wlc_surface *surface = convert_from_wl_resource(surface_resource, WLC_TYPE_SURFACE);
    wlc_pointer_set_surface(pointer, surface, &(struct wlc_point){ hotspot_x, hotspot_y });
 }
 
@@ -51,7 +52,7 @@ active_output(struct wlc_pointer *pointer)
    struct wlc_seat *seat;
    struct wlc_compositor *compositor;
    except((seat = wl_container_of(pointer, seat, pointer)) && (compositor = wl_container_of(seat, compositor, seat)));
-   return convert_from_wlc_handle(compositor->active.output, "output");
+   return convert_from_wlc_handle(compositor->active.output, WLC_TYPE_OUTPUT);
 }
 
 static bool
@@ -88,7 +89,7 @@ find_surface_at_position_recursive(const struct wlc_geometry *point, struct wlc_
    wlc_resource *sub;
    chck_iter_pool_for_each(&parent->subsurface_list, sub) {
       struct wlc_surface *subsurface;
-      if (!(subsurface = convert_from_wlc_resource(*sub, "surface")))
+      if (!(subsurface = convert_from_wlc_resource(*sub, WLC_TYPE_SURFACE)))
          continue;
 
       int32_t dx = subsurface->commit.subsurface_position.x * parent->coordinate_transform.w;
@@ -116,6 +117,38 @@ find_surface_at_position_recursive(const struct wlc_geometry *point, struct wlc_
    }
 }
 
+struct surface_hit {
+   struct wlc_geometry point;
+   struct wlc_focused_surface *out;
+   uint32_t mask;
+};
+
+static bool
+hit_view(struct wlc_view *view, void *data)
+{
+   struct surface_hit *hit = data;
+   assert(view && hit);
+
+   struct wlc_surface *surface;
+   if (!view_visible(view, hit->mask) || !(surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
+      return false;
+
+   struct wlc_geometry b, v;
+   wlc_view_get_bounds(view, &b, &v);
+
+   hit->out->offset = b.origin;
+   find_surface_at_position_recursive(&hit->point, surface, hit->out);
+
+   if (hit->out->id) {
+      return true;
+   } else if (wlc_geometry_contains(&v, &hit->point)) {
+      hit->out->id = view->surface;
+      return true;
+   }
+
+   return false;
+}
+
 static bool
 surface_under_pointer(struct wlc_pointer *pointer, struct wlc_output *output, struct wlc_focused_surface *out)
 {
@@ -126,35 +159,155 @@ surface_under_pointer(struct wlc_pointer *pointer, struct wlc_output *output, st
 
    out->id = 0;
 
-   const struct wlc_geometry point = {
-      .origin = { .x = pointer->pos.x, .y = pointer->pos.y },
-      .size = { .w = 1, .h = 1 }
+   struct surface_hit hit = {
+      .point = {
+         .origin = { .x = pointer->pos.x, .y = pointer->pos.y },
+         .size = { .w = 1, .h = 1 }
+      },
+      .out = out,
+      .mask = output->active.mask,
    };
 
-   wlc_handle *h;
-   chck_iter_pool_for_each_reverse(&output->views, h) {
-      struct wlc_view *view;
-      if (!(view = convert_from_wlc_handle(*h, "view")) || !view_visible(view, output->active.mask))
-         continue;
+   return wlc_view_grid_pick(&output->grid, &hit.point.origin, hit_view, &hit) != NULL;
+}
 
-      struct wlc_geometry b, v;
-      wlc_view_get_bounds(view, &b, &v);
+static void
+cursor_geometry(struct wlc_pointer *pointer, struct wlc_output *output, struct wlc_geometry *out_geometry)
+{
+   assert(pointer && output && out_geometry);
 
-      struct wlc_surface *surface;
-      if ((surface = convert_from_wlc_resource(view->surface, "surface"))) {
-         out->offset = b.origin;
-         find_surface_at_position_recursive(&point, surface, out);
+   const struct wlc_point pos = {
+      chck_clamp(pointer->pos.x, 0, output->resolution.w),
+      chck_clamp(pointer->pos.y, 0, output->resolution.h)
+   };
 
-         if (out->id) {
-            return true;
-         } else if (wlc_geometry_contains(&v, &point)) {
-            out->id = view->surface;
-            return true;
-         }
+   struct wlc_surface *surface;
+   if ((surface = convert_from_wlc_resource(pointer->surface, WLC_TYPE_SURFACE))) {
+      *out_geometry = (struct wlc_geometry){ .origin = { pos.x - pointer->tip.x, pos.y - pointer->tip.y }, .size = surface->size };
+   } else {
+      // Size of the default cursor drawn by renderer
+      *out_geometry = (struct wlc_geometry){ .origin = pos, .size = { 14, 14 } };
+   }
+}
+
+static bool
+pointer_visible(struct wlc_pointer *pointer, struct wlc_output *output)
+{
+   assert(output);
+
+   if (!pointer || output != active_output(pointer))
+      return false;
+
+   if (convert_from_wlc_resource(pointer->surface, WLC_TYPE_SURFACE))
+      return true;
+
+   // focused->x11.id workarounds bug <https://github.com/Cloudef/wlc/issues/21>
+   struct wlc_view *view = convert_from_wlc_handle(pointer->focused.view, WLC_TYPE_VIEW);
+   return (!view || is_x11_view(view));
+}
+
+static void
+hide_hw_cursor(struct wlc_pointer *pointer)
+{
+   assert(pointer);
+
+   if (!pointer->hw.output)
+      return;
+
+   wlc_output_set_cursor(convert_from_wlc_handle(pointer->hw.output, WLC_TYPE_OUTPUT), NULL, 0, NULL, 1);
+   pointer->hw.output = 0;
+}
+
+static bool
+hw_cursor_paint(struct wlc_pointer *pointer, struct wlc_output *output, struct wlc_surface *surface, const struct wlc_geometry *g)
+{
+   assert(pointer && output && surface && g);
+
+   // Only shm cursors can be copied to the cursor plane, rest is composited
+   struct wlc_buffer *buffer;
+   struct wl_resource *wl_buffer;
+   struct wl_shm_buffer *shm_buffer;
+   if (!(buffer = wlc_surface_get_buffer(surface)) || !(wl_buffer = convert_to_wl_resource(buffer, WLC_TYPE_BUFFER)) ||
+       !(shm_buffer = wl_shm_buffer_get(wl_buffer)) || wl_shm_buffer_get_format(shm_buffer) != WL_SHM_FORMAT_ARGB8888)
+      return false;
+
+   // Plane already holds this image
+   if (pointer->hw.output == convert_to_wlc_handle(output) && !pointer->hw.dirty && wlc_output_move_cursor(output, &g->origin))
+      return true;
+
+   if (pointer->hw.output != convert_to_wlc_handle(output))
+      hide_hw_cursor(pointer);
+
+   const struct wlc_size size = { wl_shm_buffer_get_width(shm_buffer), wl_shm_buffer_get_height(shm_buffer) };
+   wl_shm_buffer_begin_access(shm_buffer);
+   const bool set = wlc_output_set_cursor(output, wl_shm_buffer_get_data(shm_buffer), wl_shm_buffer_get_stride(shm_buffer), &size, surface->commit.scale);
+   wl_shm_buffer_end_access(shm_buffer);
+
+   if (!set || !wlc_output_move_cursor(output, &g->origin)) {
+      wlc_output_set_cursor(output, NULL, 0, NULL, 1);
+      pointer->hw.output = 0;
+      return false;
+   }
+
+   pointer->hw.output = convert_to_wlc_handle(output);
+   pointer->hw.dirty = false;
+   return true;
+}
+
+static void
+update_hw_cursor(struct wlc_pointer *pointer)
+{
+   assert(pointer);
+
+   pointer->hw.dirty = true;
+
+   // Composited cursor picks up the new image on repaint
+   struct wlc_output *output = active_output(pointer);
+   if (!pointer->hw.output || !output || pointer->hw.output != convert_to_wlc_handle(output))
+      return;
+
+   // Upload now, repaint may not reach the pointer paint at all while scanning out
+   struct wlc_surface *surface;
+   struct wlc_geometry g;
+   if ((surface = convert_from_wlc_resource(pointer->surface, WLC_TYPE_SURFACE)) && pointer_visible(pointer, output)) {
+      cursor_geometry(pointer, output, &g);
+      if (hw_cursor_paint(pointer, output, surface, &g)) {
+         wlc_output_take_frame_callbacks(output, surface, &output->callbacks);
+         wlc_output_schedule_repaint(output);
+         return;
       }
    }
 
-   return false;
+   hide_hw_cursor(pointer);
+}
+
+static void
+damage_cursor(struct wlc_pointer *pointer)
+{
+   assert(pointer);
+
+   struct wlc_output *output = active_output(pointer);
+
+   // Hardware cursor only needs to be moved, nothing gets repainted
+   if (pointer->hw.output && output && pointer->hw.output == convert_to_wlc_handle(output) &&
+       convert_from_wlc_resource(pointer->surface, WLC_TYPE_SURFACE) && pointer_visible(pointer, output)) {
+      struct wlc_geometry g;
+      cursor_geometry(pointer, output, &g);
+      if (wlc_output_move_cursor(output, &g.origin))
+         return;
+   }
+
+   hide_hw_cursor(pointer);
+   wlc_output_damage(convert_from_wlc_handle(pointer->painted.output, WLC_TYPE_OUTPUT), &pointer->painted.geometry);
+
+   if (!output) {
+      pointer->painted.output = 0;
+      return;
+   }
+
+   cursor_geometry(pointer, output, &pointer->painted.geometry);
+   pointer->painted.output = convert_to_wlc_handle(output);
+   wlc_output_damage(output, &pointer->painted.geometry);
 }
 
 static void
@@ -162,27 +315,34 @@ pointer_paint(struct wlc_pointer *pointer, struct wlc_output *output)
 {
    assert(output);
 
-   if (!pointer || output != active_output(pointer))
+   if (!pointer_visible(pointer, output)) {
+      if (pointer && pointer->hw.output == convert_to_wlc_handle(output))
+         hide_hw_cursor(pointer);
       return;
+   }
 
-   const struct wlc_point pos = {
-      chck_clamp(pointer->pos.x, 0, output->resolution.w),
-      chck_clamp(pointer->pos.y, 0, output->resolution.h)
-   };
+   struct wlc_geometry g;
+   cursor_geometry(pointer, output, &g);
 
-   struct wlc_view *view = convert_from_wlc_handle(pointer->focused.view, "view");
    struct wlc_surface *surface;
+   if ((surface = convert_from_wlc_resource(pointer->surface, WLC_TYPE_SURFACE))) {
+      const bool attached = (surface->output == convert_to_wlc_handle(output) || wlc_surface_attach_to_output(surface, output, wlc_surface_get_buffer(surface)));
 
-   if ((surface = convert_from_wlc_resource(pointer->surface, "surface"))) {
-      if (surface->output != convert_to_wlc_handle(output) && !wlc_surface_attach_to_output(surface, output, wlc_surface_get_buffer(surface))) {
+      if (attached && hw_cursor_paint(pointer, output, surface, &g)) {
+         // Surface is shown by hardware, it still wants its frame callbacks
+         wlc_output_take_frame_callbacks(output, surface, &output->callbacks);
+         return;
+      }
+
+      if (!attached) {
          // Fallback
-         wlc_render_pointer_paint(&output->render, &output->context, &pos);
+         wlc_render_pointer_paint(&output->render, &output->context, &(struct wlc_point){ g.origin.x + pointer->tip.x, g.origin.y + pointer->tip.y });
       } else {
-         wlc_output_render_surface(output, surface, &(struct wlc_geometry){ .origin = { pos.x - pointer->tip.x, pos.y - pointer->tip.y }, surface->size }, &output->callbacks);
+         wlc_output_render_surface(output, surface, &g, &output->callbacks);
       }
-   } else if (!view || is_x11_view(view)) { // focused->x11.id workarounds bug <https://github.com/Cloudef/wlc/issues/21>
+   } else {
       // Show default cursor when no focus and no surface.
-      wlc_render_pointer_paint(&output->render, &output->context, &pos);
+      wlc_render_pointer_paint(&output->render, &output->context, &g.origin);
    }
 }
 
@@ -198,29 +358,90 @@ render_event(struct wl_listener *listener, void *data)
          pointer_paint(pointer, ev->output);
          break;
 
+      case WLC_RENDER_EVENT_POINTER_QUERY:
+         // Hardware cursor doesn't need composition
+         ev->pointer_visible = ev->pointer_visible || (pointer_visible(pointer, ev->output) && pointer->hw.output != convert_to_wlc_handle(ev->output));
+         break;
+
       default: break;
    }
 }
 
+static void
+surface_event(struct wl_listener *listener, void *data)
+{
+   struct wlc_pointer *pointer;
+   except(pointer = wl_container_of(listener, pointer, listener.surface));
+
+   struct wlc_surface_event *ev = data;
+   switch (ev->type) {
+      case WLC_SURFACE_EVENT_ATTACHED:
+         if (convert_to_wlc_resource(ev->surface) == pointer->surface)
+            update_hw_cursor(pointer);
+         break;
+
+      default: break;
+   }
+}
+
+static void
+send_frame(struct chck_iter_pool *resources)
+{
+   assert(resources);
+
+   wlc_resource *r;
+   chck_iter_pool_for_each(resources, r) {
+      struct wl_resource *wr;
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_POINTER)) || wl_resource_get_version(wr) < WL_POINTER_FRAME_SINCE_VERSION)
+         continue;
+
+      wl_pointer_send_frame(wr);
+   }
+}
+
+static void
+cb_frame(void *data)
+{
+   struct wlc_pointer *pointer = data;
+   pointer->frame = NULL;
+   send_frame(&pointer->focused.resources);
+}
+
+static void
+queue_frame(struct wlc_pointer *pointer)
+{
+   assert(pointer);
+
+   if (pointer->frame)
+      return;
+
+   // idle sources run after all sources of the current dispatch, so everything sent until then is one frame
+   if (!(pointer->frame = wl_event_loop_add_idle(wlc_event_loop(), cb_frame, pointer)))
+      send_frame(&pointer->focused.resources);
+}
+
 static void
 defocus(struct wlc_pointer *pointer)
 {
    assert(pointer);
 
    struct wl_resource *surface;
-   if (!(surface = wl_resource_from_wlc_resource(pointer->focused.surface.id, "surface")))
+   if (!(surface = wl_resource_from_wlc_resource(pointer->focused.surface.id, WLC_TYPE_SURFACE)))
       goto out;
 
    wlc_resource *r;
    chck_iter_pool_for_each(&pointer->focused.resources, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "pointer")))
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_POINTER)))
          continue;
 
       uint32_t serial = wl_display_next_serial(wlc_display());
       wl_pointer_send_leave(wr, serial, surface);
    }
 
+   // these resources won't be focused when the queued frame goes out
+   send_frame(&pointer->focused.resources);
+
 out:
    chck_iter_pool_flush(&pointer->focused.resources);
    pointer->focused.surface.id = 0;
@@ -236,14 +457,14 @@ focus_view(struct wlc_pointer *pointer, struct wlc_surface *surf, wlc_handle old
         wlc_pointer_set_surface(pointer, NULL, &wlc_point_zero);
 
    struct wl_resource *surface;
-   if (!surf || !(surface = convert_to_wl_resource(surf, "surface")))
+   if (!surf || !(surface = convert_to_wl_resource(surf, WLC_TYPE_SURFACE)))
       return;
 
    struct wl_client *client = wl_resource_get_client(surface);
    wlc_resource *r;
-   chck_pool_for_each(&pointer->resources.pool, r) {
+   wlc_slab_for_each(&pointer->resources.pool, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "pointer")) || wl_resource_get_client(wr) != client)
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_POINTER)) || wl_resource_get_client(wr) != client)
          continue;
 
       if (!chck_iter_pool_push_back(&pointer->focused.resources, r))
@@ -253,6 +474,8 @@ focus_view(struct wlc_pointer *pointer, struct wlc_surface *surf, wlc_handle old
       wl_pointer_send_enter(wr, serial, surface, wl_fixed_from_double(pos->x), wl_fixed_from_double(pos->y));
    }
 
+   queue_frame(pointer);
+
    pointer->focused.surface.id = convert_to_wlc_resource(surf);
    pointer->focused.view = surf->parent_view;
 }
@@ -300,11 +523,11 @@ wlc_pointer_button(struct wlc_pointer *pointer, uint32_t time, uint32_t button,
    // Special handling for popups
    if (seat->keyboard.focused.view != pointer->focused.view) {
       struct wlc_view *v;
-      if ((v = convert_from_wlc_handle(seat->keyboard.focused.view, "view")) && !is_x11_view(v) && (v->type & WLC_BIT_POPUP)) {
+      if ((v = convert_from_wlc_handle(seat->keyboard.focused.view, WLC_TYPE_VIEW)) && !is_x11_view(v) && (v->type & WLC_BIT_POPUP)) {
          struct wl_client *client = NULL;
 
          struct wl_resource *surface;
-         if ((surface = wl_resource_from_wlc_resource(v->surface, "surface")))
+         if ((surface = wl_resource_from_wlc_resource(v->surface, WLC_TYPE_SURFACE)))
             client = wl_resource_get_client(surface);
 
          if (focused_client(pointer) != client) {
@@ -314,18 +537,20 @@ wlc_pointer_button(struct wlc_pointer *pointer, uint32_t time, uint32_t button,
       }
    }
 
-   if (!is_inside_view_input_region(pointer, convert_from_wlc_handle(pointer->focused.view, "view")))
+   if (!is_inside_view_input_region(pointer, convert_from_wlc_handle(pointer->focused.view, WLC_TYPE_VIEW)))
       return;
 
    wlc_resource *r;
    chck_iter_pool_for_each(&pointer->focused.resources, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "pointer")))
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_POINTER)))
          continue;
 
       uint32_t serial = wl_display_next_serial(wlc_display());
       wl_pointer_send_button(wr, serial, time, button, state);
    }
+
+   queue_frame(pointer);
 }
 
 void
@@ -333,13 +558,13 @@ wlc_pointer_scroll(struct wlc_pointer *pointer, uint32_t time, uint8_t axis_bits
 {
    assert(pointer);
 
-   if (!is_inside_view_input_region(pointer, convert_from_wlc_handle(pointer->focused.view, "view")))
+   if (!is_inside_view_input_region(pointer, convert_from_wlc_handle(pointer->focused.view, WLC_TYPE_VIEW)))
       return;
 
    wlc_resource *r;
    chck_iter_pool_for_each(&pointer->focused.resources, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "pointer")))
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_POINTER)))
          continue;
 
       if (axis_bits & WLC_SCROLL_AXIS_VERTICAL)
@@ -347,6 +572,8 @@ wlc_pointer_scroll(struct wlc_pointer *pointer, uint32_t time, uint8_t axis_bits
       if (axis_bits & WLC_SCROLL_AXIS_HORIZONTAL)
          wl_pointer_send_axis(wr, time, WL_POINTER_AXIS_HORIZONTAL_SCROLL, wl_fixed_from_double(amount[1]));
    }
+
+   queue_frame(pointer);
 }
 
 void
@@ -362,24 +589,26 @@ wlc_pointer_motion(struct wlc_pointer *pointer, uint32_t time, bool pass)
    pointer->focused.surface.offset = focused.offset;
 
    if (pass)
-      wlc_pointer_focus(pointer, convert_from_wlc_resource(focused.id, "surface"), &d);
+      wlc_pointer_focus(pointer, convert_from_wlc_resource(focused.id, WLC_TYPE_SURFACE), &d);
 
-   wlc_output_schedule_repaint(output);
+   damage_cursor(pointer);
 
    if (!focused.id || !pass)
       return;
 
-   if (!is_inside_view_input_region(pointer, convert_from_wlc_handle(pointer->focused.view, "view")))
+   if (!is_inside_view_input_region(pointer, convert_from_wlc_handle(pointer->focused.view, WLC_TYPE_VIEW)))
       return;
 
    wlc_resource *r;
    chck_iter_pool_for_each(&pointer->focused.resources, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "pointer")))
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_POINTER)))
          continue;
 
       wl_pointer_send_motion(wr, time, wl_fixed_from_double(d.x), wl_fixed_from_double(d.y));
    }
+
+   queue_frame(pointer);
 }
 
 void
@@ -387,8 +616,10 @@ wlc_pointer_set_surface(struct wlc_pointer *pointer, struct wlc_surface *surface
 {
    assert(pointer);
    memcpy(&pointer->tip, tip, sizeof(pointer->tip));
-   wlc_surface_invalidate(convert_from_wlc_resource(pointer->surface, "surface"));
+   wlc_surface_invalidate(convert_from_wlc_resource(pointer->surface, WLC_TYPE_SURFACE));
    pointer->surface = convert_to_wlc_resource(surface);
+   update_hw_cursor(pointer);
+   damage_cursor(pointer);
 }
 
 void
@@ -400,6 +631,14 @@ wlc_pointer_release(struct wlc_pointer *pointer)
    if (pointer->listener.render.notify)
       wl_list_remove(&pointer->listener.render.link);
 
+   if (pointer->listener.surface.notify)
+      wl_list_remove(&pointer->listener.surface.link);
+
+   hide_hw_cursor(pointer);
+
+   if (pointer->frame)
+      wl_event_source_remove(pointer->frame);
+
    chck_iter_pool_release(&pointer->focused.resources);
    wlc_source_release(&pointer->resources);
    memset(pointer, 0, sizeof(struct wlc_pointer));
@@ -412,11 +651,13 @@ wlc_pointer(struct wlc_pointer *pointer)
    memset(pointer, 0, sizeof(struct wlc_pointer));
    pointer->listener.render.notify = render_event;
    wl_signal_add(&wlc_system_signals()->render, &pointer->listener.render);
+   pointer->listener.surface.notify = surface_event;
+   wl_signal_add(&wlc_system_signals()->surface, &pointer->listener.surface);
 
    if (!chck_iter_pool(&pointer->focused.resources, 4, 0, sizeof(wlc_resource)))
       goto fail;
 
-   if (!wlc_source(&pointer->resources, "pointer", NULL, NULL, 32, sizeof(struct wlc_resource)))
+   if (!wlc_source(&pointer->resources, WLC_TYPE_POINTER, NULL, NULL, 32, sizeof(struct wlc_resource)))
       goto fail;
 
    return true;
@@ -46,8 +46,31 @@ struct wlc_pointer {
       wlc_handle view;
    } focused;
 
+   // Last damaged cursor area, repaired when the cursor moves
+   struct {
+      struct wlc_geometry geometry;
+      wlc_handle output;
+   } painted;
+
+   // Output whose hardware cursor plane shows the cursor surface,
+   // dirty when the plane still holds an older image of it
+   struct {
+      wlc_handle output;
+      bool dirty;
+   } hw;
+
+   // Relative motion of the event being handled, summed over coalesced device events
+   struct {
+      double dx, dy;
+      double dx_unaccel, dy_unaccel;
+   } delta;
+
+   // Idle source that ends the wl_pointer.frame after everything dispatched so far
+   struct wl_event_source *frame;
+
    struct {
       struct wl_listener render;
+      struct wl_listener surface;
    } listener;
 };
 
@@ -17,6 +17,7 @@
 #include "compositor/view.h"
 #include "resources/types/surface.h"
 #include "resources/resources.h"
+#include "trace.h"
 
 static void
 wl_cb_seat_get_pointer(struct wl_client *client, struct wl_resource *resource, uint32_t id)
@@ -26,7 +27,7 @@ wl_cb_seat_get_pointer(struct wl_client *client, struct wl_resource *resource, u
       return;
 
    wlc_resource r;
-   if (!(r = wlc_resource_create(&seat->pointer.resources, client, &wl_pointer_interface, wl_resource_get_version(resource), 4, id)))
+   if (!(r = wlc_resource_create(&seat->pointer.resources, client, &wl_pointer_interface, wl_resource_get_version(resource), 5, id)))
       return;
 
    wlc_resource_implement(r, wlc_pointer_implementation(), &seat->pointer);
@@ -43,19 +44,20 @@ wl_cb_seat_get_keyboard(struct wl_client *client, struct wl_resource *resource,
    if (!(seat = wl_resource_get_user_data(resource)))
       return;
 
+   // wl_seat 5 only adds wl_pointer.frame, keyboard and touch stay at the version we implement
    wlc_resource r;
-   if (!(r = wlc_resource_create(&seat->keyboard.resources, client, &wl_keyboard_interface, wl_resource_get_version(resource), 4, id)))
+   if (!(r = wlc_resource_create(&seat->keyboard.resources, client, &wl_keyboard_interface, chck_minu32(wl_resource_get_version(resource), 4), 4, id)))
       return;
 
    wlc_resource_implement(r, &wl_keyboard_implementation, &seat->keyboard);
 
-   struct wl_resource *wr = wl_resource_from_wlc_resource(r, "keyboard");
+   struct wl_resource *wr = wl_resource_from_wlc_resource(r, WLC_TYPE_KEYBOARD);
    if (wl_resource_get_version(wr) >= WL_KEYBOARD_REPEAT_INFO_SINCE_VERSION)
       wl_keyboard_send_repeat_info(wr, seat->keyboard.repeat.rate, seat->keyboard.repeat.delay);
 
    wl_keyboard_send_keymap(wr, seat->keymap.format, seat->keymap.fd, seat->keymap.size);
 
-   struct wlc_view *focused = convert_from_wlc_handle(seat->keyboard.focused.view, "view");
+   struct wlc_view *focused = convert_from_wlc_handle(seat->keyboard.focused.view, WLC_TYPE_VIEW);
    if (focused && wlc_view_get_client_ptr(focused) == client) {
       // We refocus the client here so it gets input correctly.
       // This way we avoid the ugly keyboard.init public interface hack.
@@ -76,7 +78,7 @@ wl_cb_seat_get_touch(struct wl_client *client, struct wl_resource *resource, uin
       return;
 
    wlc_resource r;
-   if (!(r = wlc_resource_create(&seat->touch.resources, client, &wl_touch_interface, wl_resource_get_version(resource), 4, id)))
+   if (!(r = wlc_resource_create(&seat->touch.resources, client, &wl_touch_interface, chck_minu32(wl_resource_get_version(resource), 4), 4, id)))
       return;
 
    wlc_resource_implement(r, &wl_touch_implementation, &seat->touch);
@@ -92,7 +94,7 @@ static void
 wl_seat_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id)
 {
    struct wl_resource *resource;
-   if (!(resource = wl_resource_create_checked(client, &wl_seat_interface, version, 4, id)))
+   if (!(resource = wl_resource_create_checked(client, &wl_seat_interface, version, 5, id)))
       return;
 
    wl_resource_set_implementation(resource, &wl_seat_implementation, data, NULL);
@@ -110,6 +112,8 @@ wl_seat_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id
 static void
 seat_handle_key(struct wlc_seat *seat, const struct wlc_input_event *ev)
 {
+   wlc_trace(WLC_TRACE_KEY, 0, ev->key.code, ev->key.state);
+
    if (!wlc_keyboard_update(&seat->keyboard, ev->key.code, ev->key.state))
       return;
 
@@ -144,7 +148,7 @@ input_event(struct wl_listener *listener, void *data)
    except((seat = wl_container_of(listener, seat, listener.input)) && (compositor = wl_container_of(seat, compositor, seat)));
 
    struct wlc_input_event *ev = data;
-   struct wlc_output *output = convert_from_wlc_handle(compositor->active.output, "output");
+   struct wlc_output *output = convert_from_wlc_handle(compositor->active.output, WLC_TYPE_OUTPUT);
 
    const struct wlc_size resolution = (output ? output->virtual : wlc_size_zero);
 
@@ -156,6 +160,12 @@ input_event(struct wl_listener *listener, void *data)
             chck_clamp(seat->pointer.pos.y + ev->motion.dy, 0, resolution.h),
          };
 
+         wlc_trace(WLC_TRACE_POINTER_MOTION, 0, pos.x, pos.y);
+         seat->pointer.delta.dx = ev->motion.dx;
+         seat->pointer.delta.dy = ev->motion.dy;
+         seat->pointer.delta.dx_unaccel = ev->motion.dx_unaccel;
+         seat->pointer.delta.dy_unaccel = ev->motion.dy_unaccel;
+
          bool handled = false;
          if (wlc_interface()->pointer.motion_v2) {
             handled = wlc_interface()->pointer.motion_v2(seat->pointer.focused.view, ev->time, pos.x, pos.y);
@@ -173,6 +183,9 @@ input_event(struct wl_listener *listener, void *data)
             ev->motion_abs.y(ev->motion_abs.internal, resolution.h)
          };
 
+         wlc_trace(WLC_TRACE_POINTER_MOTION, 0, pos.x, pos.y);
+         memset(&seat->pointer.delta, 0, sizeof(seat->pointer.delta));
+
          bool handled = false;
          if (wlc_interface()->pointer.motion_v2) {
             handled = wlc_interface()->pointer.motion_v2(seat->pointer.focused.view, ev->time, pos.x, pos.y);
@@ -337,7 +350,7 @@ wlc_seat(struct wlc_seat *seat)
        !wlc_touch(&seat->touch))
       goto fail;
 
-   if (!(seat->wl.seat = wl_global_create(wlc_display(), &wl_seat_interface, 4, seat, wl_seat_bind)))
+   if (!(seat->wl.seat = wl_global_create(wlc_display(), &wl_seat_interface, 5, seat, wl_seat_bind)))
       goto shell_interface_fail;
 
    return seat;
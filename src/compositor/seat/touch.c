@@ -14,7 +14,7 @@ active_output(struct wlc_touch *touch)
    struct wlc_seat *seat;
    struct wlc_compositor *compositor;
    except((seat = wl_container_of(touch, seat, touch)) && (compositor = wl_container_of(seat, compositor, seat)));
-   return convert_from_wlc_handle(compositor->active.output, "output");
+   return convert_from_wlc_handle(compositor->active.output, WLC_TYPE_OUTPUT);
 }
 
 static bool
@@ -26,6 +26,26 @@ view_visible(struct wlc_view *view, uint32_t mask)
    return (view->mask & mask);
 }
 
+struct view_hit {
+   const struct wlc_point *pos;
+   uint32_t mask;
+};
+
+static bool
+hit_view(struct wlc_view *view, void *data)
+{
+   struct view_hit *hit = data;
+   assert(view && hit);
+
+   if (!view_visible(view, hit->mask))
+      return false;
+
+   struct wlc_geometry b;
+   wlc_view_get_bounds(view, &b, NULL);
+   return (hit->pos->x >= b.origin.x && hit->pos->x <= b.origin.x + (int32_t)b.size.w &&
+           hit->pos->y >= b.origin.y && hit->pos->y <= b.origin.y + (int32_t)b.size.h);
+}
+
 wlc_handle
 view_under_touch(struct wlc_touch *touch, const struct wlc_point *pos)
 {
@@ -37,23 +57,10 @@ view_under_touch(struct wlc_touch *touch, const struct wlc_point *pos)
       return 0;
    }
 
-   wlc_handle *h;
-   chck_iter_pool_for_each_reverse(&output->views, h) {
-      struct wlc_view *view;
-      if (!(view = convert_from_wlc_handle(*h, "view")) || !view_visible(view, output->active.mask))
-         continue;
-
-      struct wlc_geometry b;
-      wlc_view_get_bounds(view, &b, NULL);
-      if (pos->x >= b.origin.x && pos->x <= b.origin.x + (int32_t)b.size.w &&
-          pos->y >= b.origin.y && pos->y <= b.origin.y + (int32_t)b.size.h) {
-         touch->focus = *h;
-         return touch->focus;
-      }
-   }
-
-   touch->focus = 0;
-   return 0;
+   struct view_hit hit = { .pos = pos, .mask = output->active.mask };
+   struct wlc_view *view = wlc_view_grid_pick(&output->grid, pos, hit_view, &hit);
+   touch->focus = convert_to_wlc_handle(view);
+   return touch->focus;
 }
 
 void
@@ -61,19 +68,19 @@ wlc_touch_touch(struct wlc_touch *touch, uint32_t time, enum wlc_touch_type type
 {
    assert(touch);
 
-   struct wlc_view *focused = convert_from_wlc_handle(touch->focus, "view");
+   struct wlc_view *focused = convert_from_wlc_handle(touch->focus, WLC_TYPE_VIEW);
    if (focused == NULL)
       return;
 
    struct wl_client *client;
    struct wl_resource *surface;
-   if (!(surface = wl_resource_from_wlc_resource(focused->surface, "surface")) || !(client = wl_resource_get_client(surface)))
+   if (!(surface = wl_resource_from_wlc_resource(focused->surface, WLC_TYPE_SURFACE)) || !(client = wl_resource_get_client(surface)))
       return;
 
    wlc_resource *r;
-   chck_pool_for_each(&touch->resources.pool, r) {
+   wlc_slab_for_each(&touch->resources.pool, r) {
       struct wl_resource *wr;
-      if (!(wr = wl_resource_from_wlc_resource(*r, "touch")) || wl_resource_get_client(wr) != client)
+      if (!(wr = wl_resource_from_wlc_resource(*r, WLC_TYPE_TOUCH)) || wl_resource_get_client(wr) != client)
          continue;
 
       switch (type) {
@@ -121,5 +128,5 @@ wlc_touch(struct wlc_touch *touch)
 {
    assert(touch);
    memset(touch, 0, sizeof(struct wlc_touch));
-   return wlc_source(&touch->resources, "touch", NULL, NULL, 32, sizeof(struct wlc_resource));
+   return wlc_source(&touch->resources, WLC_TYPE_TOUCH, NULL, NULL, 32, sizeof(struct wlc_resource));
 }
@@ -20,7 +20,7 @@ wlc_view_from_surface(wlc_resource surface, struct wl_client *client, const stru
    assert(_g_custom_shell);
 
    struct wlc_surface *s;
-   if (!(s = convert_from_wlc_resource(surface, "surface")))
+   if (!(s = convert_from_wlc_resource(surface, WLC_TYPE_SURFACE)))
       return 0;
 
    wlc_resource r = 0;
@@ -54,7 +54,7 @@ wlc_custom_shell(struct wlc_custom_shell *custom_shell)
    assert(custom_shell);
    *custom_shell = (struct wlc_custom_shell){0};
 
-   if (!wlc_source(&custom_shell->surfaces, "custom-surface", NULL, NULL, 32, sizeof(struct wlc_resource)))
+   if (!wlc_source(&custom_shell->surfaces, WLC_TYPE_CUSTOM_SURFACE, NULL, NULL, 32, sizeof(struct wlc_resource)))
       goto fail;
 
    _g_custom_shell = custom_shell;
@@ -18,7 +18,7 @@ struct xdg_surface {
 static struct wlc_surface*
 xdg_surface_get_surface(struct xdg_surface *xdg_surface)
 {
-   return (xdg_surface ? convert_from_wlc_resource(xdg_surface->surface, "surface") : NULL);
+   return (xdg_surface ? convert_from_wlc_resource(xdg_surface->surface, WLC_TYPE_SURFACE) : NULL);
 }
 
 static void
@@ -38,16 +38,16 @@ xdg_cb_surface_get_popup(struct wl_client *client, struct wl_resource *resource,
 {
    struct wlc_xdg_shell *xdg_shell;
    struct wlc_surface *surface, *psurface;
-   if (!(xdg_shell = wl_resource_get_user_data(resource)) || !(surface = xdg_surface_get_surface(convert_from_wl_resource(resource, "xdg-surface"))) || !(psurface = xdg_surface_get_surface(convert_from_wl_resource(parent, "xdg-surface"))))
+   if (!(xdg_shell = wl_resource_get_user_data(resource)) || !(surface = xdg_surface_get_surface(convert_from_wl_resource(resource, WLC_TYPE_XDG_SURFACE))) || !(psurface = xdg_surface_get_surface(convert_from_wl_resource(parent, WLC_TYPE_XDG_SURFACE))))
       return;
-   if (!wl_resource_get_user_data(parent) || !convert_from_wlc_handle((wlc_handle)wl_resource_get_user_data(parent), "view"))
+   if (!wl_resource_get_user_data(parent) || !convert_from_wlc_handle((wlc_handle)wl_resource_get_user_data(parent), WLC_TYPE_VIEW))
       return;
 
    wlc_resource r;
    if (!(r = wlc_resource_create(&xdg_shell->popups, client, &zxdg_popup_v6_interface, wl_resource_get_version(resource), 1, id)))
       return;
 
-   struct wlc_xdg_popup *xdg_popup = convert_from_wlc_resource(r, "xdg-popup");
+   struct wlc_xdg_popup *xdg_popup = convert_from_wlc_resource(r, WLC_TYPE_XDG_POPUP);
    assert(xdg_popup);
    
    struct wlc_xdg_positioner *positioner;
@@ -74,7 +74,7 @@ xdg_cb_surface_get_toplevel(struct wl_client *client, struct wl_resource *resour
 {
    struct wlc_surface *surface;
    struct wlc_xdg_shell *xdg_shell;
-   if (!(xdg_shell = wl_resource_get_user_data(resource)) || !(surface = xdg_surface_get_surface(convert_from_wl_resource(resource, "xdg-surface"))))
+   if (!(xdg_shell = wl_resource_get_user_data(resource)) || !(surface = xdg_surface_get_surface(convert_from_wl_resource(resource, WLC_TYPE_XDG_SURFACE))))
       return;
 
    wlc_resource r;
@@ -108,7 +108,7 @@ xdg_cb_surface_set_window_geometry(struct wl_client *client, struct wl_resource
    (void)client;
 
    struct wlc_view *view;
-   if (!(view = convert_from_wlc_handle((wlc_handle)wl_resource_get_user_data(resource), "view")))
+   if (!(view = convert_from_wlc_handle((wlc_handle)wl_resource_get_user_data(resource), WLC_TYPE_VIEW)))
       return;
 
    view->surface_pending.visible = (struct wlc_geometry){ { x, y }, { width, height } };
@@ -128,14 +128,14 @@ xdg_cb_shell_get_surface(struct wl_client *client, struct wl_resource *resource,
 {
    struct wlc_surface *surface;
    struct wlc_xdg_shell *xdg_shell;
-   if (!(xdg_shell = wl_resource_get_user_data(resource)) || !(surface = convert_from_wl_resource(surface_resource, "surface")))
+   if (!(xdg_shell = wl_resource_get_user_data(resource)) || !(surface = convert_from_wl_resource(surface_resource, WLC_TYPE_SURFACE)))
       return;
 
    wlc_resource r;
    if (!(r = wlc_resource_create(&xdg_shell->surfaces, client, &zxdg_surface_v6_interface, wl_resource_get_version(resource), 1, id)))
       return;
 
-   struct xdg_surface *xdg_surface = convert_from_wlc_resource(r, "xdg-surface");
+   struct xdg_surface *xdg_surface = convert_from_wlc_resource(r, WLC_TYPE_XDG_SURFACE);
    assert(xdg_surface);
    xdg_surface->surface = wlc_resource_from_wl_resource(surface_resource);
 
@@ -153,9 +153,9 @@ xdg_cb_create_positioner(struct wl_client *client, struct wl_resource *resource,
    if (!(r = wlc_resource_create(&xdg_shell->positioners, client, &zxdg_positioner_v6_interface, wl_resource_get_version(resource), 1, id)))
       return;
    
-   struct wlc_xdg_positioner *positioner = convert_from_wlc_resource(r, "xdg-positioner");
+   struct wlc_xdg_positioner *positioner = convert_from_wlc_resource(r, WLC_TYPE_XDG_POSITIONER);
    wlc_resource_implement(r, wlc_xdg_positioner_implementation(), NULL);
-   wl_resource_set_user_data(wl_resource_from_wlc_resource(r, "xdg-positioner"), (void*)positioner);
+   wl_resource_set_user_data(wl_resource_from_wlc_resource(r, WLC_TYPE_XDG_POSITIONER), (void*)positioner);
 }
 
 static void
@@ -213,10 +213,10 @@ wlc_xdg_shell(struct wlc_xdg_shell *xdg_shell)
    if (!(xdg_shell->wl.xdg_shell = wl_global_create(wlc_display(), &zxdg_shell_v6_interface, 1, xdg_shell, xdg_shell_bind)))
       goto xdg_shell_interface_fail;
 
-   if (!wlc_source(&xdg_shell->surfaces, "xdg-surface", NULL, NULL, 32, sizeof(struct xdg_surface)) ||
-       !wlc_source(&xdg_shell->toplevels, "xdg-toplevel", NULL, NULL, 32, sizeof(struct wlc_resource)) ||
-       !wlc_source(&xdg_shell->popups, "xdg-popup", NULL, NULL, 32, sizeof(struct wlc_xdg_popup)) ||
-       !wlc_source(&xdg_shell->positioners, "xdg-positioner", NULL, NULL, 32, sizeof(struct wlc_xdg_positioner)))
+   if (!wlc_source(&xdg_shell->surfaces, WLC_TYPE_XDG_SURFACE, NULL, NULL, 32, sizeof(struct xdg_surface)) ||
+       !wlc_source(&xdg_shell->toplevels, WLC_TYPE_XDG_TOPLEVEL, NULL, NULL, 32, sizeof(struct wlc_resource)) ||
+       !wlc_source(&xdg_shell->popups, WLC_TYPE_XDG_POPUP, NULL, NULL, 32, sizeof(struct wlc_xdg_popup)) ||
+       !wlc_source(&xdg_shell->positioners, WLC_TYPE_XDG_POSITIONER, NULL, NULL, 32, sizeof(struct wlc_xdg_positioner)))
       goto fail;
 
    return xdg_shell;
@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <wayland-server.h>
+#include <chck/math/math.h>
+#include "internal.h"
+#include "macros.h"
+#include "view-grid.h"
+#include "view.h"
+#include "output.h"
+#include "resources/types/surface.h"
+
+static void
+extend_by_subsurfaces(struct wlc_surface *parent, const struct wlc_point *offset, pixman_box32_t *extent)
+{
+   assert(parent && offset && extent);
+
+   // same placement as the pointer uses when looking for surface at position
+   wlc_resource *sub;
+   chck_iter_pool_for_each(&parent->subsurface_list, sub) {
+      struct wlc_surface *subsurface;
+      if (!(subsurface = convert_from_wlc_resource(*sub, WLC_TYPE_SURFACE)))
+         continue;
+
+      const struct wlc_point o = {
+         offset->x + (int32_t)(subsurface->commit.subsurface_position.x * parent->coordinate_transform.w),
+         offset->y + (int32_t)(subsurface->commit.subsurface_position.y * parent->coordinate_transform.h),
+      };
+
+      extent->x1 = chck_min32(extent->x1, o.x);
+      extent->y1 = chck_min32(extent->y1, o.y);
+      extent->x2 = chck_max32(extent->x2, o.x + (int32_t)subsurface->size.w);
+      extent->y2 = chck_max32(extent->y2, o.y + (int32_t)subsurface->size.h);
+      extend_by_subsurfaces(subsurface, &o, extent);
+   }
+}
+
+static void
+remove_from_cells(struct wlc_view_grid *grid, struct wlc_view *view)
+{
+   assert(grid && view);
+
+   for (int32_t y = view->grid.y1; y < view->grid.y2; ++y) {
+      for (int32_t x = view->grid.x1; x < view->grid.x2; ++x) {
+         struct chck_iter_pool *cell = &grid->cells[y * grid->w + x];
+
+         struct wlc_view **v;
+         chck_iter_pool_for_each(cell, v) {
+            if (*v != view)
+               continue;
+
+            chck_iter_pool_remove(cell, _I - 1);
+            break;
+         }
+      }
+   }
+
+   view->grid.x1 = view->grid.y1 = view->grid.x2 = view->grid.y2 = 0;
+}
+
+static void
+place_view(struct wlc_view_grid *grid, struct wlc_view *view)
+{
+   assert(grid && view);
+
+   remove_from_cells(grid, view);
+
+   struct wlc_geometry b;
+   wlc_view_get_bounds(view, &b, NULL);
+
+   // touch tests bounds with inclusive edges, so extent is one pixel larger
+   pixman_box32_t extent = { b.origin.x, b.origin.y, b.origin.x + (int32_t)b.size.w + 1, b.origin.y + (int32_t)b.size.h + 1 };
+
+   struct wlc_surface *surface;
+   if ((surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
+      extend_by_subsurfaces(surface, &b.origin, &extent);
+
+   view->grid.extent = extent;
+
+   // extents outside the output end up in border cells, so points outside still find them
+   view->grid.x1 = chck_clamp32(extent.x1 / WLC_VIEW_GRID_CELL, 0, grid->w - 1);
+   view->grid.y1 = chck_clamp32(extent.y1 / WLC_VIEW_GRID_CELL, 0, grid->h - 1);
+   view->grid.x2 = chck_clamp32((extent.x2 - 1) / WLC_VIEW_GRID_CELL, 0, grid->w - 1) + 1;
+   view->grid.y2 = chck_clamp32((extent.y2 - 1) / WLC_VIEW_GRID_CELL, 0, grid->h - 1) + 1;
+
+   for (int32_t y = view->grid.y1; y < view->grid.y2; ++y) {
+      for (int32_t x = view->grid.x1; x < view->grid.x2; ++x) {
+         if (!chck_iter_pool_push_back(&grid->cells[y * grid->w + x], &view))
+            wlc_log(WLC_LOG_WARN, "Failed to add view %" PRIuWLC " to grid cell %d,%d", convert_to_wlc_handle(view), x, y);
+      }
+   }
+}
+
+static void
+flush_dirty(struct wlc_view_grid *grid)
+{
+   assert(grid);
+
+   while (!wl_list_empty(&grid->dirty)) {
+      struct wlc_view *view;
+      except((view = wl_container_of(grid->dirty.next, view, grid.dirty)));
+      wl_list_remove(&view->grid.dirty);
+      wl_list_init(&view->grid.dirty);
+      place_view(grid, view);
+   }
+}
+
+void
+wlc_view_grid_remove(struct wlc_view_grid *grid, struct wlc_view *view)
+{
+   wl_list_remove(&view->grid.dirty);
+   wl_list_init(&view->grid.dirty);
+   remove_from_cells(grid, view);
+}
+
+void
+wlc_view_grid_invalidate(struct wlc_view *view)
+{
+   struct wlc_output *output;
+   if (!view || !(output = convert_from_wlc_handle(view->stack.output, WLC_TYPE_OUTPUT)))
+      return;
+
+   if (wl_list_empty(&view->grid.dirty))
+      wl_list_insert(&output->grid.dirty, &view->grid.dirty);
+}
+
+struct wlc_view*
+wlc_view_grid_pick(struct wlc_view_grid *grid, const struct wlc_point *pos, bool (*hit)(struct wlc_view *view, void *data), void *data)
+{
+   flush_dirty(grid);
+
+   const int32_t x = chck_clamp32(pos->x / WLC_VIEW_GRID_CELL, 0, grid->w - 1);
+   const int32_t y = chck_clamp32(pos->y / WLC_VIEW_GRID_CELL, 0, grid->h - 1);
+   struct chck_iter_pool *cell = &grid->cells[y * grid->w + x];
+
+   // cells are few views deep, so select the next highest candidate each round instead of sorting
+   uint64_t below = UINT64_MAX;
+   for (;;) {
+      struct wlc_view **v, *best = NULL;
+      chck_iter_pool_for_each(cell, v) {
+         const pixman_box32_t *e = &(*v)->grid.extent;
+         if ((*v)->stack.order >= below || (best && (*v)->stack.order <= best->stack.order))
+            continue;
+
+         if (pos->x >= e->x1 && pos->x < e->x2 && pos->y >= e->y1 && pos->y < e->y2)
+            best = *v;
+      }
+
+      if (!best || hit(best, data))
+         return best;
+
+      below = best->stack.order;
+   }
+}
+
+bool
+wlc_view_grid_resize(struct wlc_view_grid *grid, const struct wlc_size *size, struct wl_list *stack)
+{
+   const int32_t w = chck_max32((size->w + WLC_VIEW_GRID_CELL - 1) / WLC_VIEW_GRID_CELL, 1);
+   const int32_t h = chck_max32((size->h + WLC_VIEW_GRID_CELL - 1) / WLC_VIEW_GRID_CELL, 1);
+
+   if (grid->cells && grid->w == w && grid->h == h)
+      return true;
+
+   struct chck_iter_pool *cells;
+   if (!(cells = calloc(w * h, sizeof(struct chck_iter_pool))))
+      return false;
+
+   for (int32_t i = 0; i < w * h; ++i) {
+      if (!chck_iter_pool(&cells[i], 4, 0, sizeof(struct wlc_view*)))
+         goto fail;
+   }
+
+   for (int32_t i = 0; i < grid->w * grid->h; ++i)
+      chck_iter_pool_release(&grid->cells[i]);
+
+   free(grid->cells);
+   grid->cells = cells;
+   grid->w = w;
+   grid->h = h;
+
+   if (!stack)
+      return true;
+
+   // old cell ranges point to released cells, everything gets placed again
+   struct wlc_view *v;
+   wl_list_for_each(v, stack, stack.link) {
+      v->grid.x1 = v->grid.y1 = v->grid.x2 = v->grid.y2 = 0;
+      wl_list_remove(&v->grid.dirty);
+      wl_list_insert(&grid->dirty, &v->grid.dirty);
+   }
+
+   return true;
+
+fail:
+   for (int32_t i = 0; i < w * h; ++i)
+      chck_iter_pool_release(&cells[i]);
+   free(cells);
+   return false;
+}
+
+void
+wlc_view_grid_release(struct wlc_view_grid *grid)
+{
+   if (!grid)
+      return;
+
+   for (int32_t i = 0; i < grid->w * grid->h; ++i)
+      chck_iter_pool_release(&grid->cells[i]);
+
+   free(grid->cells);
+   grid->cells = NULL;
+   grid->w = grid->h = 0;
+}
+
+bool
+wlc_view_grid(struct wlc_view_grid *grid)
+{
+   wl_list_init(&grid->dirty);
+   return wlc_view_grid_resize(grid, &(struct wlc_size){ WLC_VIEW_GRID_CELL, WLC_VIEW_GRID_CELL }, NULL);
+}
@@ -0,0 +1,44 @@
+#ifndef _WLC_VIEW_GRID_H_
+#define _WLC_VIEW_GRID_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <wayland-util.h>
+#include <wlc/geometry.h>
+
+struct wlc_view;
+struct chck_iter_pool;
+
+// Side of a grid cell in virtual resolution pixels
+#define WLC_VIEW_GRID_CELL 128
+
+/**
+ * Uniform grid over output for finding topmost view at point.
+ * Each cell holds views whose extent (bounds and subsurfaces) overlaps it.
+ * Views are re-inserted lazily on next pick after they got invalidated.
+ */
+struct wlc_view_grid {
+   struct chck_iter_pool *cells; // struct wlc_view* in each cell
+   struct wl_list dirty; // views whose extent must be recomputed before next pick
+   int32_t w, h; // cells in each direction
+};
+
+/** Remove view from grid, must be done before view leaves the stack of output. */
+WLC_NONULL void wlc_view_grid_remove(struct wlc_view_grid *grid, struct wlc_view *view);
+
+/** View's geometry or surface tree changed, update it in grid of the output it is stacked on. */
+void wlc_view_grid_invalidate(struct wlc_view *view);
+
+/**
+ * Topmost view whose extent contains pos and which passes hit test.
+ * Candidates are tested from top to bottom, so hit may do the exact test.
+ */
+WLC_NONULLV(1,2,3) struct wlc_view* wlc_view_grid_pick(struct wlc_view_grid *grid, const struct wlc_point *pos, bool (*hit)(struct wlc_view *view, void *data), void *data);
+
+/** Cover area of size, views of stack are invalidated if cells change. */
+WLC_NONULLV(1,2) bool wlc_view_grid_resize(struct wlc_view_grid *grid, const struct wlc_size *size, struct wl_list *stack);
+
+void wlc_view_grid_release(struct wlc_view_grid *grid);
+WLC_NONULL bool wlc_view_grid(struct wlc_view_grid *grid);
+
+#endif /* _WLC_VIEW_GRID_H_ */
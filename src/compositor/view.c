@@ -9,6 +9,7 @@
 #include "macros.h"
 #include "visibility.h"
 #include "output.h"
+#include "view-grid.h"
 #include "resources/types/xdg-toplevel.h"
 #include "resources/types/xdg-popup.h"
 #include "resources/types/xdg-positioner.h"
@@ -35,7 +36,7 @@ surface_tree_update_coordinate_transform(struct wlc_surface *surface, const stru
 
    wlc_resource *s;
    chck_iter_pool_for_each(&surface->subsurface_list, s)
-      surface_update_coordinate_transform(convert_from_wlc_resource(*s, "surface"), area);
+      surface_update_coordinate_transform(convert_from_wlc_resource(*s, WLC_TYPE_SURFACE), area);
 }
 
 static void
@@ -44,24 +45,24 @@ configure_view(struct wlc_view *view, uint32_t edges, const struct wlc_geometry
    assert(view && g);
 
    struct wl_resource *r;
-   if (view->xdg_toplevel && (r = wl_resource_from_wlc_resource(view->xdg_toplevel, "xdg-toplevel"))) {
+   if (view->xdg_toplevel && (r = wl_resource_from_wlc_resource(view->xdg_toplevel, WLC_TYPE_XDG_TOPLEVEL))) {
       struct wl_array states = { .size = view->wl_state.items.used, .alloc = view->wl_state.items.allocated, .data = view->wl_state.items.buffer };
       zxdg_toplevel_v6_send_configure(r, g->size.w, g->size.h, &states);
-   } else if (view->xdg_popup && (r = wl_resource_from_wlc_resource(view->xdg_popup, "xdg-popup"))) {
-      struct wlc_xdg_popup *xdg_popup = convert_from_wlc_resource(view->xdg_popup, "xdg-popup");
+   } else if (view->xdg_popup && (r = wl_resource_from_wlc_resource(view->xdg_popup, WLC_TYPE_XDG_POPUP))) {
+      struct wlc_xdg_popup *xdg_popup = convert_from_wlc_resource(view->xdg_popup, WLC_TYPE_XDG_POPUP);
       struct wlc_size size = g->size;
       
       if (xdg_popup->xdg_positioner && (xdg_popup->xdg_positioner->flags & WLC_XDG_POSITIONER_HAS_SIZE))
          size = xdg_popup->xdg_positioner->size;
       
       zxdg_popup_v6_send_configure(r, g->origin.x, g->origin.y, size.w, size.h);
-   } else if (view->shell_surface && (r = wl_resource_from_wlc_resource(view->shell_surface, "shell-surface"))) {
+   } else if (view->shell_surface && (r = wl_resource_from_wlc_resource(view->shell_surface, WLC_TYPE_SHELL_SURFACE))) {
       wl_shell_surface_send_configure(r, edges, g->size.w, g->size.h);
    } else if (is_x11_view(view)) {
       wlc_x11_window_configure(&view->x11, g);
    }
 
-   if (view->xdg_surface && (r = wl_resource_from_wlc_resource(view->xdg_surface, "xdg-surface")))
+   if (view->xdg_surface && (r = wl_resource_from_wlc_resource(view->xdg_surface, WLC_TYPE_XDG_SURFACE)))
       zxdg_surface_v6_send_configure(r, wl_display_next_serial(wlc_display()));
 }
 
@@ -109,13 +110,13 @@ wlc_view_commit_state(struct wlc_view *view, struct wlc_view_state *pending, str
    assert(view && pending && out);
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wlc_resource(view->surface, "surface")))
+   if (!(surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
       return;
 
    // FIXME: handle ping
 #if 0
       struct wl_resource *r;
-      if (view->shell_surface && (r = wl_resource_from_wlc_resource(view->shell_surface, "shell-surface")))
+      if (view->shell_surface && (r = wl_resource_from_wlc_resource(view->shell_surface, WLC_TYPE_SHELL_SURFACE)))
          wl_shell_surface_send_ping(r, wl_display_next_serial(wlc_display()));
 
       wlc_dlog(WLC_DBG_COMMIT, "=> ping view %" PRIuWLC, convert_to_wlc_handle(view));
@@ -166,6 +167,7 @@ wlc_view_commit_state(struct wlc_view *view, struct wlc_view_state *pending, str
    struct wlc_geometry geom, visible;
    wlc_view_get_bounds(view, &geom, &visible);
    surface_tree_update_coordinate_transform(surface, &visible);
+   wlc_view_grid_invalidate(view);
 
    wlc_dlog(WLC_DBG_COMMIT, "=> commit view %" PRIuWLC, convert_to_wlc_handle(view));
 }
@@ -187,6 +189,7 @@ wlc_view_ack_surface_attach(struct wlc_view *view, struct wlc_surface *surface)
    }
 
    view->surface_commit = view->surface_pending;
+   wlc_view_grid_invalidate(view);
 }
 
 void
@@ -196,7 +199,7 @@ wlc_view_get_bounds(struct wlc_view *view, struct wlc_geometry *out_bounds, stru
    memcpy(out_bounds, &view->commit.geometry, sizeof(struct wlc_geometry));
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wlc_resource(view->surface, "surface")))
+   if (!(surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
       return;
 
    if (view->xdg_toplevel && !wlc_size_equals(&view->surface_commit.visible.size, &wlc_size_zero)) {
@@ -259,7 +262,17 @@ wlc_view_get_opaque(struct wlc_view *view, struct wlc_geometry *out_opaque)
 
    struct wlc_geometry b, v;
    wlc_view_get_bounds(view, &b, &v);
-   return wlc_surface_get_opaque(convert_from_wlc_resource(view->surface, "surface"), &v.origin, out_opaque);
+   return wlc_surface_get_opaque(convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE), &v.origin, out_opaque);
+}
+
+void
+wlc_view_get_opaque_region(struct wlc_view *view, pixman_region32_t *out_opaque)
+{
+   assert(view && out_opaque);
+
+   struct wlc_geometry b, v;
+   wlc_view_get_bounds(view, &b, &v);
+   wlc_surface_get_opaque_region(convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE), &v.origin, out_opaque);
 }
 
 void
@@ -274,7 +287,7 @@ wlc_view_get_input(struct wlc_view *view, struct wlc_geometry *out_input)
       return;
    }
 
-   wlc_surface_get_input(convert_from_wlc_resource(view->surface, "surface"), &v.origin, out_input);
+   wlc_surface_get_input(convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE), &v.origin, out_input);
 }
 
 bool
@@ -327,7 +340,7 @@ wlc_view_set_surface(struct wlc_view *view, struct wlc_surface *surface)
 
    wlc_handle old = view->surface;
    view->surface = convert_to_wlc_resource(surface);
-   wlc_surface_attach_to_view(convert_from_wlc_resource(old, "surface"), NULL);
+   wlc_surface_attach_to_view(convert_from_wlc_resource(old, WLC_TYPE_SURFACE), NULL);
    wlc_surface_attach_to_view(surface, view);
 
    if (surface && surface->commit.attached) {
@@ -342,7 +355,7 @@ wlc_view_set_surface(struct wlc_view *view, struct wlc_surface *surface)
 struct wl_client*
 wlc_view_get_client_ptr(struct wlc_view *view)
 {
-   struct wl_resource *r = (view ? wl_resource_from_wlc_resource(view->surface, "surface") : NULL);
+   struct wl_resource *r = (view ? wl_resource_from_wlc_resource(view->surface, WLC_TYPE_SURFACE) : NULL);
    return (r ? wl_resource_get_client(r) : NULL);
 }
 
@@ -350,10 +363,10 @@ struct wlc_output*
 wlc_view_get_output_ptr(struct wlc_view *view)
 {
    struct wlc_surface *surface;
-   if (!view || !(surface = convert_from_wlc_resource(view->surface, "surface")))
+   if (!view || !(surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
       return NULL;
 
-   return convert_from_wlc_handle(surface->output, "output");
+   return convert_from_wlc_handle(surface->output, WLC_TYPE_OUTPUT);
 }
 
 void
@@ -494,13 +507,13 @@ wlc_view_close_ptr(struct wlc_view *view)
       return;
 
    struct wl_resource *r;
-   if (view->xdg_toplevel && (r = wl_resource_from_wlc_resource(view->xdg_toplevel, "xdg-toplevel"))) {
+   if (view->xdg_toplevel && (r = wl_resource_from_wlc_resource(view->xdg_toplevel, WLC_TYPE_XDG_TOPLEVEL))) {
       zxdg_toplevel_v6_send_close(r);
    } else if (is_x11_view(view)) {
       wlc_x11_window_close(&view->x11);
-   } else if (view->xdg_popup && (r = wl_resource_from_wlc_resource(view->xdg_popup, "xdg-popup"))) {
+   } else if (view->xdg_popup && (r = wl_resource_from_wlc_resource(view->xdg_popup, WLC_TYPE_XDG_POPUP))) {
       zxdg_popup_v6_send_popup_done(r);
-   } else if (view->shell_surface && (r = wl_resource_from_wlc_resource(view->shell_surface, "shell-surface"))) {
+   } else if (view->shell_surface && (r = wl_resource_from_wlc_resource(view->shell_surface, WLC_TYPE_SHELL_SURFACE))) {
       if (view->type & WLC_BIT_POPUP) {
          wl_shell_surface_send_popup_done(r);
       } else {
@@ -558,9 +571,9 @@ get_cstr(struct wlc_view *view, size_t offset)
 static struct wlc_xdg_positioner*
 get_xdg_positioner_for_handle(wlc_handle view)
 {
-   struct wlc_view *v = convert_from_wlc_handle(view, "view");
-   if ( (v) && (v->xdg_popup) && wl_resource_from_wlc_resource(v->xdg_popup, "xdg-popup") ) {
-      struct wlc_xdg_popup *popup = convert_from_wlc_resource(v->xdg_popup, "xdg-popup");
+   struct wlc_view *v = convert_from_wlc_handle(view, WLC_TYPE_VIEW);
+   if ( (v) && (v->xdg_popup) && wl_resource_from_wlc_resource(v->xdg_popup, WLC_TYPE_XDG_POPUP) ) {
+      struct wlc_xdg_popup *popup = convert_from_wlc_resource(v->xdg_popup, WLC_TYPE_XDG_POPUP);
       // xdg_positioner object is complete only if it has size and anchor rectangle set
       if ((popup->xdg_positioner) && (popup->xdg_positioner->flags & (WLC_XDG_POSITIONER_HAS_SIZE | WLC_XDG_POSITIONER_HAS_ANCHOR_RECT)))
         return popup->xdg_positioner;
@@ -571,68 +584,68 @@ get_xdg_positioner_for_handle(wlc_handle view)
 WLC_API void
 wlc_view_focus(wlc_handle view)
 {
-   wlc_view_focus_ptr(convert_from_wlc_handle(view, "view"));
+   wlc_view_focus_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW));
 }
 
 WLC_API void
 wlc_view_close(wlc_handle view)
 {
-   wlc_view_close_ptr(convert_from_wlc_handle(view, "view"));
+   wlc_view_close_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW));
 }
 
 WLC_API wlc_handle
 wlc_view_get_output(wlc_handle view)
 {
-   return convert_to_wlc_handle(wlc_view_get_output_ptr(convert_from_wlc_handle(view, "view")));
+   return convert_to_wlc_handle(wlc_view_get_output_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW)));
 }
 
 WLC_API void
 wlc_view_set_output(wlc_handle view, wlc_handle output)
 {
-   wlc_view_set_output_ptr(convert_from_wlc_handle(view, "view"), convert_from_wlc_handle(output, "output"));
+   wlc_view_set_output_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), convert_from_wlc_handle(output, WLC_TYPE_OUTPUT));
 }
 
 WLC_API void
 wlc_view_send_to_back(wlc_handle view)
 {
-   wlc_view_send_to(convert_from_wlc_handle(view, "view"), LINK_BELOW);
+   wlc_view_send_to(convert_from_wlc_handle(view, WLC_TYPE_VIEW), LINK_BELOW);
 }
 
 WLC_API void
 wlc_view_send_below(wlc_handle view, wlc_handle other)
 {
-   wlc_view_send_to_other(convert_from_wlc_handle(view, "view"), LINK_BELOW, convert_from_wlc_handle(other, "view"));
+   wlc_view_send_to_other(convert_from_wlc_handle(view, WLC_TYPE_VIEW), LINK_BELOW, convert_from_wlc_handle(other, WLC_TYPE_VIEW));
 }
 
 WLC_API void
 wlc_view_bring_above(wlc_handle view, wlc_handle other)
 {
-   wlc_view_send_to_other(convert_from_wlc_handle(view, "view"), LINK_ABOVE, convert_from_wlc_handle(other, "view"));
+   wlc_view_send_to_other(convert_from_wlc_handle(view, WLC_TYPE_VIEW), LINK_ABOVE, convert_from_wlc_handle(other, WLC_TYPE_VIEW));
 }
 
 WLC_API void
 wlc_view_bring_to_front(wlc_handle view)
 {
-   wlc_view_send_to(convert_from_wlc_handle(view, "view"), LINK_ABOVE);
+   wlc_view_send_to(convert_from_wlc_handle(view, WLC_TYPE_VIEW), LINK_ABOVE);
 }
 
 WLC_API uint32_t
 wlc_view_get_mask(wlc_handle view)
 {
-   void *ptr = get(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, mask));
+   void *ptr = get(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, mask));
    return (ptr ? *(uint32_t*)ptr : 0);
 }
 
 WLC_API void
 wlc_view_set_mask(wlc_handle view, uint32_t mask)
 {
-   wlc_view_set_mask_ptr(convert_from_wlc_handle(view, "view"), mask);
+   wlc_view_set_mask_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), mask);
 }
 
 WLC_API const struct wlc_geometry*
 wlc_view_get_geometry(wlc_handle view)
 {
-   return get(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, pending.geometry));
+   return get(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, pending.geometry));
 }
 
 WLC_API const struct wlc_size*
@@ -695,7 +708,7 @@ wlc_view_get_visible_geometry(wlc_handle view, struct wlc_geometry *out_geometry
    assert(out_geometry);
 
    struct wlc_view *v;
-   if (!(v = convert_from_wlc_handle(view, "view")))
+   if (!(v = convert_from_wlc_handle(view, WLC_TYPE_VIEW)))
       return;
 
    wlc_view_get_bounds(v, out_geometry, NULL);
@@ -704,77 +717,77 @@ wlc_view_get_visible_geometry(wlc_handle view, struct wlc_geometry *out_geometry
 WLC_API void
 wlc_view_set_geometry(wlc_handle view, uint32_t edges, const struct wlc_geometry *geometry)
 {
-   wlc_view_set_geometry_ptr(convert_from_wlc_handle(view, "view"), edges, geometry);
+   wlc_view_set_geometry_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), edges, geometry);
 }
 
 WLC_API uint32_t
 wlc_view_get_type(wlc_handle view)
 {
-   void *ptr = get(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, type));
+   void *ptr = get(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, type));
    return (ptr ? *(uint32_t*)ptr : 0);
 }
 
 WLC_API void
 wlc_view_set_type(wlc_handle view, enum wlc_view_type_bit type, bool toggle)
 {
-   wlc_view_set_type_ptr(convert_from_wlc_handle(view, "view"), type, toggle);
+   wlc_view_set_type_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), type, toggle);
 }
 
 WLC_API uint32_t
 wlc_view_get_state(wlc_handle view)
 {
-   void *ptr = get(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, pending.state));
+   void *ptr = get(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, pending.state));
    return (ptr ? *(uint32_t*)ptr : 0);
 }
 
 WLC_API void
 wlc_view_set_state(wlc_handle view, enum wlc_view_state_bit state, bool toggle)
 {
-   wlc_view_set_state_ptr(convert_from_wlc_handle(view, "view"), state, toggle);
+   wlc_view_set_state_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), state, toggle);
 }
 
 WLC_API wlc_handle
 wlc_view_get_parent(wlc_handle view)
 {
-   void *ptr = get(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, parent));
+   void *ptr = get(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, parent));
    return (ptr ? *(wlc_handle*)ptr : 0);
 }
 
 WLC_API void
 wlc_view_set_parent(wlc_handle view, wlc_handle parent)
 {
-   wlc_view_set_parent_ptr(convert_from_wlc_handle(view, "view"), convert_from_wlc_handle(parent, "view"));
+   wlc_view_set_parent_ptr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), convert_from_wlc_handle(parent, WLC_TYPE_VIEW));
 }
 
 WLC_API const char*
 wlc_view_get_title(wlc_handle view)
 {
-   return get_cstr(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, data.title));
+   return get_cstr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, data.title));
 }
 
 WLC_API const char*
 wlc_view_get_instance(wlc_handle view)
 {
-   return get_cstr(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, data._instance));
+   return get_cstr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, data._instance));
 }
 
 WLC_API const char*
 wlc_view_get_class(wlc_handle view)
 {
-   return get_cstr(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, data._class));
+   return get_cstr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, data._class));
 }
 
 WLC_API const char*
 wlc_view_get_app_id(wlc_handle view)
 {
-   return get_cstr(convert_from_wlc_handle(view, "view"), offsetof(struct wlc_view, data.app_id));
+   return get_cstr(convert_from_wlc_handle(view, WLC_TYPE_VIEW), offsetof(struct wlc_view, data.app_id));
 }
 
 WLC_API pid_t
 wlc_view_get_pid(wlc_handle handle)
 {
    struct wlc_view *view;
-   if(!(view = convert_from_wlc_handle(handle, "view")))
+   if(!(view = convert_from_wlc_handle(handle, WLC_TYPE_VIEW)))
       return 0;
 
    if (is_x11_view(view)) {
@@ -790,7 +803,7 @@ WLC_API bool
 wlc_view_is_minimized(wlc_handle handle)
 {
    struct wlc_view *view;
-   if(!(view = convert_from_wlc_handle(handle, "view")))
+   if(!(view = convert_from_wlc_handle(handle, WLC_TYPE_VIEW)))
       return false;
       
    return wlc_view_is_minimized_ptr(view);
@@ -814,7 +827,7 @@ wlc_view_release(struct wlc_view *view)
    chck_string_release(&view->data._class);
    chck_string_release(&view->data.app_id);
 
-   wlc_surface_attach_to_view(convert_from_wlc_resource(view->surface, "surface"), NULL);
+   wlc_surface_attach_to_view(convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE), NULL);
    chck_iter_pool_release(&view->wl_state);
 }
 
@@ -823,5 +836,7 @@ wlc_view(struct wlc_view *view)
 {
    assert(view);
    assert(!view->state.created);
+   wl_list_init(&view->stack.link);
+   wl_list_init(&view->grid.dirty);
    return chck_iter_pool(&view->wl_state, 8, 0, sizeof(uint32_t));
 }
@@ -5,6 +5,7 @@
 #include <sys/types.h>
 #include <wlc/geometry.h>
 #include <wayland-util.h>
+#include <pixman.h>
 #include <chck/pool/pool.h>
 #include <chck/string/string.h>
 #include "xwayland/xwm.h"
@@ -55,6 +56,21 @@ struct wlc_view {
       bool minimized;
    } data;
 
+   // Place in stack of output, owners are zero when not linked
+   struct {
+      struct wl_list link;
+      wlc_handle output; // output whose stack the link is in
+      wlc_handle mutable; // output whose mutable views contain this view
+      uint64_t order; // grows from bottom to top of stack, spaced so most inserts don't renumber
+   } stack;
+
+   // Place in view grid of the stack's output
+   struct {
+      struct wl_list dirty; // in dirty list of grid while extent is out of date
+      pixman_box32_t extent; // bounds and subsurfaces, exclusive max edges
+      int32_t x1, y1, x2, y2; // cells the view is in, exclusive max
+   } grid;
+
    uint32_t type;
    uint32_t mask;
 
@@ -76,6 +92,7 @@ WLC_NONULL void wlc_view_commit_state(struct wlc_view *view, struct wlc_view_sta
 WLC_NONULL void wlc_view_ack_surface_attach(struct wlc_view *view, struct wlc_surface *surface);
 WLC_NONULLV(1,2) void wlc_view_get_bounds(struct wlc_view *view, struct wlc_geometry *out_bounds, struct wlc_geometry *out_visible);
 WLC_NONULL bool wlc_view_get_opaque(struct wlc_view *view, struct wlc_geometry *out_opaque);
+WLC_NONULL void wlc_view_get_opaque_region(struct wlc_view *view, pixman_region32_t *out_opaque);
 WLC_NONULL void wlc_view_get_input(struct wlc_view *view, struct wlc_geometry *out_input);
 WLC_NONULL bool wlc_view_request_geometry(struct wlc_view *view, const struct wlc_geometry *r);
 bool wlc_view_request_state(struct wlc_view *view, enum wlc_view_state_bit state, bool toggle);
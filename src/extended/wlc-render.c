@@ -15,7 +15,7 @@ wlc_surface_render(wlc_resource surface, const struct wlc_geometry *geometry)
    if (!(o = wlc_get_rendering_output()))
       return;
 
-   wlc_output_render_surface(o, convert_from_wlc_resource(surface, "surface"), geometry, &o->callbacks);
+   wlc_output_render_surface(o, convert_from_wlc_resource(surface, WLC_TYPE_SURFACE), geometry, &o->callbacks);
 }
 
 WLC_API void
@@ -46,17 +46,18 @@ WLC_API void
 wlc_output_schedule_render(wlc_handle output)
 {
    struct wlc_output *o;
-   if (!(o = convert_from_wlc_handle(output, "output")))
+   if (!(o = convert_from_wlc_handle(output, WLC_TYPE_OUTPUT)))
       return;
 
-   wlc_output_schedule_repaint(o);
+   // we can't know what the hooks are going to draw
+   wlc_output_damage_whole(o);
 }
 
 WLC_API enum wlc_renderer
 wlc_output_get_renderer(wlc_handle output)
 {
    struct wlc_output *o;
-   if (!(o = convert_from_wlc_handle(output, "output")))
+   if (!(o = convert_from_wlc_handle(output, WLC_TYPE_OUTPUT)))
       return WLC_NO_RENDERER;
 
    return o->render.api.renderer_type;
@@ -66,7 +67,7 @@ WLC_API bool
 wlc_surface_get_textures(wlc_resource surface, uint32_t out_textures[], enum wlc_surface_format *out_format)
 {
    struct wlc_surface *surf;
-   if (!(surf = convert_from_wlc_resource(surface, "surface")))
+   if (!(surf = convert_from_wlc_resource(surface, WLC_TYPE_SURFACE)))
       return false;
 
    memcpy(out_textures, surf->textures, 3 * sizeof(surf->textures[0]));
@@ -85,7 +86,7 @@ surface_flush_frame_callbacks_recursive(struct wlc_surface *surface, struct wlc_
    wlc_resource *sub;
    struct wlc_surface *subsurface;
    chck_iter_pool_for_each(&surface->subsurface_list, sub)
-      if ((subsurface = convert_from_wlc_resource(*sub, "surface")))
+      if ((subsurface = convert_from_wlc_resource(*sub, WLC_TYPE_SURFACE)))
          surface_flush_frame_callbacks_recursive(subsurface, output);
 }
 
@@ -94,14 +95,14 @@ wlc_surface_flush_frame_callbacks(wlc_resource surface)
 {
    struct wlc_surface *surf;
    struct wlc_output *output;
-   if (!(surf = convert_from_wlc_resource(surface, "surface")) ||
-         !(output = convert_from_wlc_handle(surf->output, "output"))) {
+   if (!(surf = convert_from_wlc_resource(surface, WLC_TYPE_SURFACE)) ||
+         !(output = convert_from_wlc_handle(surf->output, WLC_TYPE_OUTPUT))) {
       return;
    }
 
    surface_flush_frame_callbacks_recursive(surf, output);
 
    struct wlc_view *v;
-   if ((v = convert_from_wlc_handle(surf->parent_view, "view")))
+   if ((v = convert_from_wlc_handle(surf->parent_view, WLC_TYPE_VIEW)))
       wlc_view_commit_state(v, &v->pending, &v->commit);
 }
@@ -180,6 +180,7 @@ struct wlc_focus_event {
 enum wlc_surface_event_type {
    WLC_SURFACE_EVENT_CREATED,
    WLC_SURFACE_EVENT_DESTROYED,
+   WLC_SURFACE_EVENT_ATTACHED,
    WLC_SURFACE_EVENT_REQUEST_VIEW_ATTACH,
    WLC_SURFACE_EVENT_REQUEST_VIEW_POPUP,
 };
@@ -188,6 +189,7 @@ struct wlc_surface_event {
    union {
       // WLC_INPUT_EVENT_CREATED (no data)
       // WLC_INPUT_EVENT_DESTROYED (no data)
+      // WLC_SURFACE_EVENT_ATTACHED (no data, new buffer was committed)
 
       // WLC_SURFACE_EVENT_REQUEST_VIEW_ATTACH
       struct wlc_surface_event_request_view_attach {
@@ -226,6 +228,8 @@ struct wlc_input_event {
       // WLC_INPUT_EVENT_MOTION (relative)
       struct wlc_input_event_motion {
          double dx, dy;
+         double dx_unaccel, dy_unaccel; // zero if backend doesn't know
+         uint32_t count; // device events summed into this one
       } motion;
 
       // WLC_INPUT_EVENT_MOTION_ABSOLUTE
@@ -297,7 +301,7 @@ struct wlc_output_event {
       // No data, compositor just tells backend to update outputs.
 
       // WLC_OUTPUT_EVENT_SURFACE
-      // Used for TTY switching mainly, outputs send this even whenever their backend surface is set.
+      // Used for TTY switching mainly, outputs send this even whenever their backend surface is set, suspended or resumed.
       struct wlc_output_event_surface {
          struct wlc_output *output;
       } surface;
@@ -308,11 +312,13 @@ struct wlc_output_event {
 
 enum wlc_render_event_type {
    WLC_RENDER_EVENT_POINTER,
+   WLC_RENDER_EVENT_POINTER_QUERY,
 };
 
 struct wlc_render_event {
    struct wlc_output *output;
    enum wlc_render_event_type type;
+   bool pointer_visible; // set by listeners for WLC_RENDER_EVENT_POINTER_QUERY
 };
 
 struct wlc_system_signals {
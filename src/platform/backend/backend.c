@@ -4,6 +4,7 @@
 #include "internal.h"
 #include "backend.h"
 #include "drm.h"
+#include "headless.h"
 
 #ifdef ENABLE_WAYLAND_BACKEND
 #  include "wayland.h"
@@ -43,7 +44,7 @@ wlc_backend_surface_release(struct wlc_backend_surface *surface)
 }
 
 uint32_t
-wlc_backend_update_outputs(struct wlc_backend *backend, struct chck_pool *outputs)
+wlc_backend_update_outputs(struct wlc_backend *backend, struct wlc_slab *outputs)
 {
    assert(backend);
 
@@ -72,6 +73,7 @@ wlc_backend(struct wlc_backend *backend)
    memset(backend, 0, sizeof(struct wlc_backend));
 
    bool (*init[])(struct wlc_backend*) = {
+      wlc_headless,
 #ifdef ENABLE_WAYLAND_BACKEND
       wlc_wayland,
 #endif
@@ -83,6 +85,7 @@ wlc_backend(struct wlc_backend *backend)
    };
 
    enum wlc_backend_type types[] = {
+      WLC_BACKEND_HEADLESS,
 #ifdef ENABLE_WAYLAND_BACKEND
       WLC_BACKEND_WAYLAND,
 #endif
@@ -5,7 +5,11 @@
 #include <stdbool.h>
 #include "EGL/egl.h"
 
-struct chck_pool;
+struct wlc_slab;
+struct wlc_buffer;
+
+// Most overlay planes a backend surface may offer for views
+#define WLC_BACKEND_MAX_OVERLAYS 4
 
 struct wlc_backend_surface {
    void *internal;
@@ -15,11 +19,22 @@ struct wlc_backend_surface {
    EGLint display_type;
    int drm_fd;
    bool use_egldevice;
+   bool use_pbuffer; // no native window, render offscreen
 
    struct {
       WLC_NONULL void (*terminate)(struct wlc_backend_surface *surface);
       WLC_NONULL void (*sleep)(struct wlc_backend_surface *surface, bool sleep);
+      // Optional, session loses or regains the device. Everything is kept, but hardware state may be changed by others meanwhile.
+      WLC_NONULL void (*suspend)(struct wlc_backend_surface *surface, bool suspend);
       WLC_NONULL bool (*page_flip)(struct wlc_backend_surface *surface);
+      // Optional, flips client buffer directly without composition. Returns false if buffer can't be scanned out.
+      WLC_NONULL bool (*scanout)(struct wlc_backend_surface *surface, struct wlc_buffer *buffer);
+      // Optional hardware cursor, position and size are in mode pixels. NULL pixels hides the cursor.
+      WLC_NONULLV(1) bool (*set_cursor)(struct wlc_backend_surface *surface, const uint8_t *argb8888, uint32_t stride, const struct wlc_size *size);
+      WLC_NONULL bool (*move_cursor)(struct wlc_backend_surface *surface, const struct wlc_point *pos);
+      // Optional, shows client buffer on an overlay plane with next page flip, geometry in mode pixels.
+      // Returns false if the assignment does not pass a test commit, buffer must be composited then.
+      WLC_NONULL bool (*assign_overlay)(struct wlc_backend_surface *surface, struct wlc_buffer *buffer, const struct wlc_geometry *geometry);
       WLC_NONULL void (*set_gamma)(struct wlc_backend_surface *bsurface, uint16_t size, uint16_t *r, uint16_t *g, uint16_t *b);
       WLC_NONULL uint16_t (*get_gamma_size)(struct wlc_backend_surface *bsurface);
    } api;
@@ -29,7 +44,7 @@ struct wlc_backend {
    enum wlc_backend_type type;
 
    struct {
-      WLC_NONULL uint32_t (*update_outputs)(struct chck_pool *outputs);
+      WLC_NONULL uint32_t (*update_outputs)(struct wlc_slab *outputs);
       void (*terminate)(void);
    } api;
 };
@@ -37,7 +52,7 @@ struct wlc_backend {
 WLC_NONULL bool wlc_backend_surface(struct wlc_backend_surface *surface, void (*destructor)(struct wlc_backend_surface*), size_t internal_size);
 void wlc_backend_surface_release(struct wlc_backend_surface *surface);
 
-WLC_NONULL uint32_t wlc_backend_update_outputs(struct wlc_backend *backend, struct chck_pool *outputs);
+WLC_NONULL uint32_t wlc_backend_update_outputs(struct wlc_backend *backend, struct wlc_slab *outputs);
 void wlc_backend_release(struct wlc_backend *backend);
 WLC_NONULL bool wlc_backend(struct wlc_backend *backend);
 
@@ -19,6 +19,7 @@
 #include "compositor/compositor.h"
 #include "compositor/output.h"
 #include "platform/context/egl.h"
+#include "resources/types/buffer.h"
 #include "session/fd.h"
 
 // FIXME: Contains global state (event_source && fd)
@@ -32,6 +33,29 @@ struct drm_output_information {
    drmModeModeInfo mode;
    struct wlc_output_information info;
    uint32_t width, height;
+   uint32_t crtc_index;
+};
+
+struct drm_plane {
+   uint32_t id;
+   uint32_t possible_crtcs;
+   uint64_t type; // DRM_PLANE_TYPE_*
+
+   struct {
+      uint32_t fb_id, crtc_id;
+      uint32_t src_x, src_y, src_w, src_h;
+      uint32_t crtc_x, crtc_y, crtc_w, crtc_h;
+   } props;
+
+   bool used;
+};
+
+struct drm_fb {
+   struct gbm_bo *bo;
+   uint32_t fd;
+   uint32_t stride;
+   struct wlc_size size;
+   wlc_resource buffer; // client buffer, when scanned out directly
 };
 
 struct drm_surface {
@@ -40,12 +64,41 @@ struct drm_surface {
    drmModeConnector *connector;
    drmModeEncoder *encoder;
    drmModeCrtc *crtc;
-
-   struct drm_fb {
-      struct gbm_bo *bo;
-      uint32_t fd;
-      uint32_t stride;
-   } fb[NUM_FBS];
+   uint32_t crtc_index;
+
+   struct drm_fb fb[NUM_FBS];
+
+   // Atomic modesetting state, unused with legacy drm api
+   struct {
+      struct drm_plane *primary;
+
+      struct drm_overlay {
+         struct drm_plane *plane;
+         struct drm_fb fb[NUM_FBS];
+         struct wlc_geometry geometry;
+         bool assigned;
+      } overlay[WLC_BACKEND_MAX_OVERLAYS];
+
+      struct {
+         uint32_t mode_id, active, connector_crtc_id;
+      } props;
+
+      uint32_t overlays;
+      uint32_t mode_blob;
+      bool enabled, queued;
+   } atomic;
+
+   struct {
+      struct gbm_bo *bo[2];
+      uint32_t *pixels;
+      uint32_t width, height;
+      struct wlc_point pos;
+      uint8_t index;
+      bool visible;
+   } cursor;
+
+   // Holds a frame that failed to commit until the next vblank would have passed
+   struct wl_event_source *backoff;
 
    uint32_t stride;
    uint8_t index;
@@ -57,8 +110,113 @@ static struct {
    void *device;
    int fd;
    struct wl_event_source *event_source;
+   struct wlc_slab *outputs;
+
+   struct {
+      struct chck_iter_pool planes;
+
+      // Flips of all outputs during one dispatch go out in single commit
+      drmModeAtomicReq *req;
+      struct wl_event_source *idle;
+      uint32_t flags;
+      bool enabled;
+   } atomic;
 } drm;
 
+static void restore_cursor(struct drm_surface *dsurface);
+
+static uint32_t
+get_property(uint32_t object, uint32_t type, const char *name, uint64_t *out_value)
+{
+   assert(name);
+
+   drmModeObjectProperties *props;
+   if (!(props = drmModeObjectGetProperties(drm.fd, object, type)))
+      return 0;
+
+   uint32_t id = 0;
+   for (uint32_t i = 0; i < props->count_props && !id; ++i) {
+      drmModePropertyRes *prop;
+      if (!(prop = drmModeGetProperty(drm.fd, props->props[i])))
+         continue;
+
+      if (chck_cstreq(prop->name, name)) {
+         id = prop->prop_id;
+
+         if (out_value)
+            *out_value = props->prop_values[i];
+      }
+
+      drmModeFreeProperty(prop);
+   }
+
+   drmModeFreeObjectProperties(props);
+   return id;
+}
+
+static bool
+query_planes(void)
+{
+   drmModePlaneRes *resources;
+   if (!(resources = drmModeGetPlaneResources(drm.fd)))
+      return false;
+
+   for (uint32_t i = 0; i < resources->count_planes; ++i) {
+      drmModePlane *p;
+      if (!(p = drmModeGetPlane(drm.fd, resources->planes[i])))
+         continue;
+
+      struct drm_plane plane = { .id = p->plane_id, .possible_crtcs = p->possible_crtcs, .type = DRM_PLANE_TYPE_OVERLAY };
+      drmModeFreePlane(p);
+
+      const struct {
+         const char *name;
+         uint32_t *id;
+      } map[] = {
+         { "FB_ID", &plane.props.fb_id },
+         { "CRTC_ID", &plane.props.crtc_id },
+         { "SRC_X", &plane.props.src_x },
+         { "SRC_Y", &plane.props.src_y },
+         { "SRC_W", &plane.props.src_w },
+         { "SRC_H", &plane.props.src_h },
+         { "CRTC_X", &plane.props.crtc_x },
+         { "CRTC_Y", &plane.props.crtc_y },
+         { "CRTC_W", &plane.props.crtc_w },
+         { "CRTC_H", &plane.props.crtc_h },
+      };
+
+      bool valid = get_property(plane.id, DRM_MODE_OBJECT_PLANE, "type", &plane.type);
+      for (uint32_t m = 0; m < LENGTH(map) && valid; ++m)
+         valid = (*map[m].id = get_property(plane.id, DRM_MODE_OBJECT_PLANE, map[m].name, NULL));
+
+      if (!valid) {
+         wlc_log(WLC_LOG_WARN, "Plane %u is missing properties", plane.id);
+         continue;
+      }
+
+      chck_iter_pool_push_back(&drm.atomic.planes, &plane);
+   }
+
+   wlc_log(WLC_LOG_INFO, "Found %zu planes", drm.atomic.planes.items.count);
+   drmModeFreePlaneResources(resources);
+   return (drm.atomic.planes.items.count > 0);
+}
+
+static struct drm_plane*
+claim_plane(uint32_t crtc_index, uint64_t type)
+{
+   struct drm_plane *p;
+   chck_iter_pool_for_each(&drm.atomic.planes, p) {
+      if (p->used || p->type != type || !(p->possible_crtcs & (1 << crtc_index)))
+         continue;
+
+      p->used = true;
+      return p;
+   }
+
+   return NULL;
+}
+
 static void
 release_fb(struct gbm_surface *surface, struct drm_fb *fb)
 {
@@ -67,34 +225,77 @@ release_fb(struct gbm_surface *surface, struct drm_fb *fb)
    if (fb->fd > 0)
       drmModeRmFB(drm.fd, fb->fd);
 
-   if (surface && fb->bo)
+   if (fb->buffer) {
+      // bo was imported from client buffer, client may reuse it now
+      if (fb->bo)
+         gbm_bo_destroy(fb->bo);
+
+      wlc_buffer_dispose(convert_from_wlc_resource(fb->buffer, WLC_TYPE_BUFFER));
+   } else if (surface && fb->bo) {
       gbm_surface_release_buffer(surface, fb->bo);
+   }
 
    fb->bo = NULL;
    fb->fd = 0;
+   fb->buffer = 0;
+   fb->size = (struct wlc_size){ 0, 0 };
+}
+
+static struct wlc_output*
+output_for_crtc(uint32_t crtc_id)
+{
+   if (!drm.outputs)
+      return NULL;
+
+   struct wlc_output *o;
+   wlc_slab_for_each(drm.outputs, o) {
+      struct drm_surface *dsurface = o->bsurface.internal;
+      if (dsurface && dsurface->crtc->crtc_id == crtc_id)
+         return o;
+   }
+
+   return NULL;
 }
 
 static void
-page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data)
+flip_done(struct wlc_output *output, const struct timespec *ts, uint64_t seq)
 {
-   assert(data);
-   (void)fd, (void)frame;
-   struct wlc_backend_surface *bsurface = data;
-   struct drm_surface *dsurface = bsurface->internal;
+   assert(output && ts);
+   struct drm_surface *dsurface = output->bsurface.internal;
 
    if (!drm.use_egldevice) {
+      // buffers that were on screen until now can be reused
       uint8_t next = (dsurface->index + 1) % NUM_FBS;
       release_fb(dsurface->gbm_surface, &dsurface->fb[next]);
+
+      for (uint32_t i = 0; i < dsurface->atomic.overlays; ++i)
+         release_fb(NULL, &dsurface->atomic.overlay[i].fb[next]);
+
       dsurface->index = next;
    }
 
+   wlc_output_finish_frame(output, ts, seq, WLC_PRESENTATION_VSYNC | WLC_PRESENTATION_HW_CLOCK | WLC_PRESENTATION_HW_COMPLETION);
+   dsurface->flipping = false;
+}
+
+static void
+page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsigned int usec, unsigned int crtc_id, void *data)
+{
+   (void)fd;
+
+   // legacy flips pass the surface, atomic commits may contain many crtcs
+   struct wlc_output *o = NULL;
+   if (data) {
+      struct wlc_backend_surface *bsurface = data;
+      o = wl_container_of(bsurface, o, bsurface);
+   } else if (!(o = output_for_crtc(crtc_id))) {
+      return;
+   }
+
    struct timespec ts;
    ts.tv_sec = sec;
    ts.tv_nsec = usec * 1000;
-
-   struct wlc_output *o;
-   wlc_output_finish_frame(wl_container_of(bsurface, o, bsurface), &ts);
-   dsurface->flipping = false;
+   flip_done(o, &ts, frame);
 }
 
 static int
@@ -104,11 +305,308 @@ drm_event(int fd, uint32_t mask, void *data)
    drmEventContext evctx;
    memset(&evctx, 0, sizeof(evctx));
    evctx.version = DRM_EVENT_CONTEXT_VERSION;
-   evctx.page_flip_handler = page_flip_handler;
+   evctx.page_flip_handler2 = page_flip_handler;
    drmHandleEvent(fd, &evctx);
    return 0;
 }
 
+static void
+add_plane(drmModeAtomicReq *req, const struct drm_plane *plane, uint32_t crtc_id, const struct drm_fb *fb, const struct wlc_geometry *geometry)
+{
+   assert(req && plane);
+
+   if (!fb || !fb->fd) {
+      drmModeAtomicAddProperty(req, plane->id, plane->props.fb_id, 0);
+      drmModeAtomicAddProperty(req, plane->id, plane->props.crtc_id, 0);
+      return;
+   }
+
+   assert(geometry);
+
+   // source coordinates are 16.16 fixed point
+   drmModeAtomicAddProperty(req, plane->id, plane->props.fb_id, fb->fd);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.crtc_id, crtc_id);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.src_x, 0);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.src_y, 0);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.src_w, (uint64_t)fb->size.w << 16);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.src_h, (uint64_t)fb->size.h << 16);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.crtc_x, geometry->origin.x);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.crtc_y, geometry->origin.y);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.crtc_w, geometry->size.w);
+   drmModeAtomicAddProperty(req, plane->id, plane->props.crtc_h, geometry->size.h);
+}
+
+static bool
+add_surface_state(drmModeAtomicReq *req, struct wlc_backend_surface *bsurface, const struct drm_fb *primary, uint32_t *flags)
+{
+   assert(req && bsurface && primary && flags);
+   struct drm_surface *dsurface = bsurface->internal;
+
+   struct wlc_output *o;
+   except((o = wl_container_of(bsurface, o, bsurface)));
+   const drmModeModeInfo *mode = &dsurface->connector->modes[o->active.mode];
+
+   // crtc is not driven by us yet (first frame, or woke up from sleep)
+   if (!dsurface->stride) {
+      if (dsurface->atomic.mode_blob)
+         drmModeDestroyPropertyBlob(drm.fd, dsurface->atomic.mode_blob);
+
+      dsurface->atomic.mode_blob = 0;
+      if (drmModeCreatePropertyBlob(drm.fd, mode, sizeof(*mode), &dsurface->atomic.mode_blob))
+         return false;
+
+      drmModeAtomicAddProperty(req, dsurface->crtc->crtc_id, dsurface->atomic.props.mode_id, dsurface->atomic.mode_blob);
+      drmModeAtomicAddProperty(req, dsurface->crtc->crtc_id, dsurface->atomic.props.active, 1);
+      drmModeAtomicAddProperty(req, dsurface->connector->connector_id, dsurface->atomic.props.connector_crtc_id, dsurface->crtc->crtc_id);
+      *flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+   }
+
+   const struct wlc_geometry screen = { { 0, 0 }, { mode->hdisplay, mode->vdisplay } };
+   add_plane(req, dsurface->atomic.primary, dsurface->crtc->crtc_id, primary, &screen);
+
+   for (uint32_t i = 0; i < dsurface->atomic.overlays; ++i) {
+      struct drm_overlay *overlay = &dsurface->atomic.overlay[i];
+      add_plane(req, overlay->plane, dsurface->crtc->crtc_id, (overlay->assigned ? &overlay->fb[dsurface->index] : NULL), &overlay->geometry);
+   }
+
+   return true;
+}
+
+static uint32_t
+mode_refresh(const drmModeModeInfo *mode)
+{
+   assert(mode);
+
+   // vrefresh is rounded to whole Hz, timings give the exact rate in mHz
+   if (!mode->htotal || !mode->vtotal)
+      return mode->vrefresh * 1000;
+
+   // clock is in kHz
+   const uint64_t pixels = (uint64_t)mode->htotal * mode->vtotal;
+   uint64_t refresh = (mode->clock * 1000000ull + pixels / 2) / pixels;
+
+   if (mode->flags & DRM_MODE_FLAG_INTERLACE)
+      refresh *= 2;
+
+   if (mode->flags & DRM_MODE_FLAG_DBLSCAN)
+      refresh /= 2;
+
+   if (mode->vscan > 1)
+      refresh /= mode->vscan;
+
+   return refresh;
+}
+
+static int
+cb_backoff(void *data)
+{
+   struct wlc_backend_surface *bsurface = data;
+   struct drm_surface *dsurface = bsurface->internal;
+
+   struct wlc_output *o;
+   except((o = wl_container_of(bsurface, o, bsurface)));
+
+   wlc_output_discard_frame(o);
+   dsurface->flipping = false;
+   return 0;
+}
+
+static void
+discard_atomic(struct wlc_output *output)
+{
+   assert(output);
+   struct drm_surface *dsurface = output->bsurface.internal;
+
+   release_fb(dsurface->gbm_surface, &dsurface->fb[dsurface->index]);
+   for (uint32_t i = 0; i < dsurface->atomic.overlays; ++i)
+      release_fb(NULL, &dsurface->atomic.overlay[i].fb[dsurface->index]);
+
+   // Finishing the frame right away would have clients redraw and fail again in a loop,
+   // so the frame takes as long as a flip would have.
+   const drmModeModeInfo *mode = &dsurface->connector->modes[output->active.mode];
+   const uint32_t refresh = mode_refresh(mode);
+   const int32_t interval = (refresh > 0 && refresh <= 1000000 ? 1000000 / refresh : 16);
+
+   if (!dsurface->backoff && !(dsurface->backoff = wl_event_loop_add_timer(wlc_event_loop(), cb_backoff, &output->bsurface))) {
+      cb_backoff(&output->bsurface);
+      return;
+   }
+
+   wl_event_source_timer_update(dsurface->backoff, interval);
+}
+
+static bool
+commit_without_overlays(uint32_t flags)
+{
+   drmModeAtomicReq *req;
+   if (!(req = drmModeAtomicAlloc()))
+      return false;
+
+   // Overlay assignments were cleared when queued, so rebuilt state only has the primary planes.
+   // Surfaces that were on overlays are missing from this frame and get composited on the next one.
+   bool valid = true;
+   struct wlc_output *o;
+   wlc_slab_for_each(drm.outputs, o) {
+      struct drm_surface *dsurface;
+      if (!(dsurface = o->bsurface.internal) || !dsurface->atomic.queued)
+         continue;
+
+      bool overlays = false;
+      for (uint32_t i = 0; i < dsurface->atomic.overlays; ++i) {
+         overlays = overlays || dsurface->atomic.overlay[i].fb[dsurface->index].fd;
+         release_fb(NULL, &dsurface->atomic.overlay[i].fb[dsurface->index]);
+      }
+
+      if (overlays)
+         wlc_output_damage_whole(o);
+
+      valid = valid && add_surface_state(req, &o->bsurface, &dsurface->fb[dsurface->index], &flags);
+   }
+
+   const bool committed = (valid && !drmModeAtomicCommit(drm.fd, req, flags, NULL));
+   drmModeAtomicFree(req);
+   return committed;
+}
+
+static void
+commit_atomic(void *data)
+{
+   (void)data;
+
+   drmModeAtomicReq *req = drm.atomic.req;
+   const uint32_t flags = DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_NONBLOCK | drm.atomic.flags;
+   drm.atomic.req = NULL;
+   drm.atomic.idle = NULL;
+   drm.atomic.flags = 0;
+
+   if (!req || !drm.outputs)
+      return;
+
+   bool committed = !drmModeAtomicCommit(drm.fd, req, flags, NULL);
+   drmModeAtomicFree(req);
+
+   if (!committed) {
+      wlc_log(WLC_LOG_WARN, "Atomic commit failed, retrying without overlay planes: %m");
+
+      if (!(committed = commit_without_overlays(flags)))
+         wlc_log(WLC_LOG_WARN, "Atomic commit failed: %m");
+   }
+
+   struct wlc_output *o;
+   wlc_slab_for_each(drm.outputs, o) {
+      struct drm_surface *dsurface;
+      if (!(dsurface = o->bsurface.internal) || !dsurface->atomic.queued)
+         continue;
+
+      dsurface->atomic.queued = false;
+
+      if (committed) {
+         // Replace whatever cursor was left on the crtc (fixes gdm issues)
+         if (!dsurface->stride)
+            restore_cursor(dsurface);
+
+         dsurface->stride = dsurface->fb[dsurface->index].stride;
+         continue;
+      }
+
+      // nothing is going to flip, output stays flipping until the backoff ends
+      discard_atomic(o);
+   }
+}
+
+static bool
+queue_atomic(struct wlc_backend_surface *bsurface)
+{
+   assert(bsurface && bsurface->internal);
+   struct drm_surface *dsurface = bsurface->internal;
+   assert(dsurface->atomic.enabled && !dsurface->atomic.queued);
+
+   if (!drm.atomic.req && !(drm.atomic.req = drmModeAtomicAlloc()))
+      return false;
+
+   const int cursor = drmModeAtomicGetCursor(drm.atomic.req);
+   if (!add_surface_state(drm.atomic.req, bsurface, &dsurface->fb[dsurface->index], &drm.atomic.flags)) {
+      drmModeAtomicSetCursor(drm.atomic.req, cursor);
+      return false;
+   }
+
+   if (!drm.atomic.idle && !(drm.atomic.idle = wl_event_loop_add_idle(wlc_event_loop(), commit_atomic, NULL))) {
+      drmModeAtomicSetCursor(drm.atomic.req, cursor);
+      return false;
+   }
+
+   // assignments were for this frame only
+   for (uint32_t i = 0; i < dsurface->atomic.overlays; ++i)
+      dsurface->atomic.overlay[i].assigned = false;
+
+   dsurface->atomic.queued = true;
+   dsurface->flipping = true;
+   return true;
+}
+
+static bool
+test_atomic(struct wlc_backend_surface *bsurface, const struct drm_fb *primary)
+{
+   assert(bsurface && primary);
+
+   if (!primary->fd)
+      return false;
+
+   drmModeAtomicReq *req;
+   if (!(req = drmModeAtomicAlloc()))
+      return false;
+
+   uint32_t flags = DRM_MODE_ATOMIC_TEST_ONLY;
+   const bool valid = (add_surface_state(req, bsurface, primary, &flags) && !drmModeAtomicCommit(drm.fd, req, flags, NULL));
+   drmModeAtomicFree(req);
+   return valid;
+}
+
+static bool
+setup_atomic(struct drm_surface *dsurface)
+{
+   assert(dsurface);
+
+   if (!(dsurface->atomic.props.mode_id = get_property(dsurface->crtc->crtc_id, DRM_MODE_OBJECT_CRTC, "MODE_ID", NULL)) ||
+       !(dsurface->atomic.props.active = get_property(dsurface->crtc->crtc_id, DRM_MODE_OBJECT_CRTC, "ACTIVE", NULL)) ||
+       !(dsurface->atomic.props.connector_crtc_id = get_property(dsurface->connector->connector_id, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID", NULL)))
+      return false;
+
+   if (!(dsurface->atomic.primary = claim_plane(dsurface->crtc_index, DRM_PLANE_TYPE_PRIMARY)))
+      return false;
+
+   for (dsurface->atomic.overlays = 0; dsurface->atomic.overlays < WLC_BACKEND_MAX_OVERLAYS; ++dsurface->atomic.overlays) {
+      struct drm_overlay *overlay = &dsurface->atomic.overlay[dsurface->atomic.overlays];
+      if (!(overlay->plane = claim_plane(dsurface->crtc_index, DRM_PLANE_TYPE_OVERLAY)))
+         break;
+   }
+
+   wlc_log(WLC_LOG_INFO, "Using atomic modesetting on crtc %u with %u overlay planes", dsurface->crtc->crtc_id, dsurface->atomic.overlays);
+   dsurface->atomic.enabled = true;
+   return true;
+}
+
+static void
+release_atomic(struct drm_surface *dsurface)
+{
+   assert(dsurface);
+
+   if (dsurface->atomic.primary)
+      dsurface->atomic.primary->used = false;
+
+   for (uint32_t i = 0; i < dsurface->atomic.overlays; ++i) {
+      struct drm_overlay *overlay = &dsurface->atomic.overlay[i];
+      for (uint32_t f = 0; f < NUM_FBS; ++f)
+         release_fb(NULL, &overlay->fb[f]);
+      overlay->plane->used = false;
+   }
+
+   if (dsurface->atomic.mode_blob)
+      drmModeDestroyPropertyBlob(drm.fd, dsurface->atomic.mode_blob);
+
+   memset(&dsurface->atomic, 0, sizeof(dsurface->atomic));
+}
+
 static bool
 create_gbm_fb(struct gbm_surface *surface, struct drm_fb *fb)
 {
@@ -129,6 +627,7 @@ create_gbm_fb(struct gbm_surface *surface, struct drm_fb *fb)
       goto failed_to_create_fb;
 
    fb->stride = stride;
+   fb->size = (struct wlc_size){ width, height };
    return true;
 
 no_buffers:
@@ -194,6 +693,110 @@ fail:
    return 0;
 }
 
+static bool
+create_cursor(struct drm_surface *dsurface)
+{
+   assert(dsurface);
+
+   uint64_t width, height;
+   if (drmGetCap(drm.fd, DRM_CAP_CURSOR_WIDTH, &width))
+      width = 64;
+   if (drmGetCap(drm.fd, DRM_CAP_CURSOR_HEIGHT, &height))
+      height = 64;
+
+   if (!(dsurface->cursor.pixels = calloc(width * height, sizeof(uint32_t))))
+      goto fail;
+
+   for (uint32_t i = 0; i < LENGTH(dsurface->cursor.bo); ++i) {
+      if (!(dsurface->cursor.bo[i] = gbm_bo_create(drm.device, width, height, GBM_FORMAT_ARGB8888, GBM_BO_USE_CURSOR | GBM_BO_USE_WRITE)))
+         goto fail;
+   }
+
+   dsurface->cursor.width = width;
+   dsurface->cursor.height = height;
+   return true;
+
+fail:
+   wlc_log(WLC_LOG_WARN, "Failed to create cursor buffers, falling back to software cursor");
+   for (uint32_t i = 0; i < LENGTH(dsurface->cursor.bo); ++i) {
+      if (dsurface->cursor.bo[i])
+         gbm_bo_destroy(dsurface->cursor.bo[i]);
+   }
+   free(dsurface->cursor.pixels);
+   memset(&dsurface->cursor, 0, sizeof(dsurface->cursor));
+   return false;
+}
+
+static void
+restore_cursor(struct drm_surface *dsurface)
+{
+   assert(dsurface);
+
+   if (!dsurface->cursor.visible) {
+      drmModeSetCursor(drm.fd, dsurface->crtc->crtc_id, 0, 0, 0);
+      return;
+   }
+
+   struct gbm_bo *bo = dsurface->cursor.bo[dsurface->cursor.index];
+   drmModeSetCursor(drm.fd, dsurface->crtc->crtc_id, gbm_bo_get_handle(bo).u32, dsurface->cursor.width, dsurface->cursor.height);
+   drmModeMoveCursor(drm.fd, dsurface->crtc->crtc_id, dsurface->cursor.pos.x, dsurface->cursor.pos.y);
+}
+
+static bool
+set_cursor(struct wlc_backend_surface *bsurface, const uint8_t *argb8888, uint32_t stride, const struct wlc_size *size)
+{
+   assert(bsurface && bsurface->internal);
+   struct drm_surface *dsurface = bsurface->internal;
+
+   if (drm.use_egldevice)
+      return false;
+
+   if (!argb8888) {
+      dsurface->cursor.visible = false;
+      return !drmModeSetCursor(drm.fd, dsurface->crtc->crtc_id, 0, 0, 0);
+   }
+
+   if (!dsurface->cursor.bo[0] && !create_cursor(dsurface))
+      return false;
+
+   if (size->w > dsurface->cursor.width || size->h > dsurface->cursor.height)
+      return false;
+
+   // Write to the buffer not being scanned out, so the cursor never tears
+   const uint8_t next = (dsurface->cursor.index + 1) % LENGTH(dsurface->cursor.bo);
+   struct gbm_bo *bo = dsurface->cursor.bo[next];
+
+   memset(dsurface->cursor.pixels, 0, dsurface->cursor.width * dsurface->cursor.height * sizeof(uint32_t));
+   for (uint32_t y = 0; y < size->h; ++y)
+      memcpy(dsurface->cursor.pixels + y * dsurface->cursor.width, argb8888 + y * stride, size->w * sizeof(uint32_t));
+
+   if (gbm_bo_write(bo, dsurface->cursor.pixels, dsurface->cursor.width * dsurface->cursor.height * sizeof(uint32_t)))
+      return false;
+
+   if (drmModeSetCursor(drm.fd, dsurface->crtc->crtc_id, gbm_bo_get_handle(bo).u32, dsurface->cursor.width, dsurface->cursor.height))
+      return false;
+
+   dsurface->cursor.index = next;
+   dsurface->cursor.visible = true;
+   return true;
+}
+
+static bool
+move_cursor(struct wlc_backend_surface *bsurface, const struct wlc_point *pos)
+{
+   assert(bsurface && bsurface->internal && pos);
+   struct drm_surface *dsurface = bsurface->internal;
+
+   if (!dsurface->cursor.visible)
+      return false;
+
+   if (drmModeMoveCursor(drm.fd, dsurface->crtc->crtc_id, pos->x, pos->y))
+      return false;
+
+   dsurface->cursor.pos = *pos;
+   return true;
+}
+
 static bool
 page_flip(struct wlc_backend_surface *bsurface)
 {
@@ -209,11 +812,19 @@ page_flip(struct wlc_backend_surface *bsurface)
    if (!create_gbm_fb(dsurface->gbm_surface, fb))
       return false;
 
+   if (dsurface->atomic.enabled) {
+      if (!queue_atomic(bsurface))
+         goto failed_to_queue;
+
+      return true;
+   }
+
    if (fb->stride != dsurface->stride) {
       if (drmModeSetCrtc(drm.fd, dsurface->crtc->crtc_id, fb->fd, 0, 0, &dsurface->connector->connector_id, 1, &dsurface->connector->modes[o->active.mode]))
          goto set_crtc_fail;
-	  // Remove hardware cursor (fixes gdm issues)
-	  drmModeSetCursor(drm.fd, dsurface->crtc->crtc_id, 0, 0, 0);
+
+      // Replace whatever cursor was left on the crtc (fixes gdm issues)
+      restore_cursor(dsurface);
 
       dsurface->stride = fb->stride;
    }
@@ -224,6 +835,9 @@ page_flip(struct wlc_backend_surface *bsurface)
    dsurface->flipping = true;
    return true;
 
+failed_to_queue:
+   wlc_log(WLC_LOG_WARN, "Failed to queue atomic commit");
+   goto fail;
 set_crtc_fail:
    wlc_log(WLC_LOG_WARN, "Failed to set mode: %m");
    goto fail;
@@ -234,6 +848,127 @@ fail:
    return false;
 }
 
+static bool
+import_buffer(struct drm_fb *fb, struct wlc_buffer *buffer, bool opaque)
+{
+   assert(fb && buffer);
+
+   struct wl_resource *wl_buffer;
+   if (!(wl_buffer = convert_to_wl_resource(buffer, WLC_TYPE_BUFFER)))
+      return false;
+
+   // Fails for shm and other buffers the display engine can't read, which is expected.
+   if (!(fb->bo = gbm_bo_import(drm.device, GBM_BO_IMPORT_WL_BUFFER, wl_buffer, GBM_BO_USE_SCANOUT)))
+      return false;
+
+   fb->buffer = wlc_buffer_use(buffer);
+   fb->size = (struct wlc_size){ gbm_bo_get_width(fb->bo), gbm_bo_get_height(fb->bo) };
+
+   // Alpha can be ignored when caller knows the buffer is opaque
+   uint32_t format = gbm_bo_get_format(fb->bo);
+   if (opaque && format == GBM_FORMAT_ARGB8888)
+      format = GBM_FORMAT_XRGB8888;
+
+   if (format != GBM_FORMAT_XRGB8888 && format != GBM_FORMAT_ARGB8888)
+      goto fail;
+
+   const uint32_t handles[4] = { gbm_bo_get_handle(fb->bo).u32 };
+   const uint32_t pitches[4] = { gbm_bo_get_stride(fb->bo) };
+   const uint32_t offsets[4] = { 0 };
+   if (drmModeAddFB2(drm.fd, fb->size.w, fb->size.h, format, handles, pitches, offsets, &fb->fd, 0))
+      goto failed_to_create_fb;
+
+   fb->stride = pitches[0];
+   return true;
+
+failed_to_create_fb:
+   wlc_dlog(WLC_DBG_RENDER, "Failed to create fb for client buffer: %m");
+fail:
+   release_fb(NULL, fb);
+   return false;
+}
+
+static bool
+scanout(struct wlc_backend_surface *bsurface, struct wlc_buffer *buffer)
+{
+   assert(bsurface && bsurface->internal && buffer);
+   struct drm_surface *dsurface = bsurface->internal;
+   assert(!dsurface->flipping);
+
+   // No gbm device to import with, and crtc must have been set by composited frame first.
+   if (drm.use_egldevice || !dsurface->stride)
+      return false;
+
+   struct wlc_output *o;
+   except((o = wl_container_of(bsurface, o, bsurface)));
+   const drmModeModeInfo *mode = &dsurface->connector->modes[o->active.mode];
+
+   struct drm_fb *fb = &dsurface->fb[dsurface->index];
+   release_fb(dsurface->gbm_surface, fb);
+
+   if (!import_buffer(fb, buffer, true))
+      return false;
+
+   if (fb->size.w != mode->hdisplay || fb->size.h != mode->vdisplay)
+      goto fail;
+
+   if (dsurface->atomic.enabled) {
+      if (!test_atomic(bsurface, fb) || !queue_atomic(bsurface))
+         goto fail;
+
+      return true;
+   }
+
+   if (drmModePageFlip(drm.fd, dsurface->crtc->crtc_id, fb->fd, DRM_MODE_PAGE_FLIP_EVENT, bsurface))
+      goto failed_to_page_flip;
+
+   dsurface->flipping = true;
+   return true;
+
+failed_to_page_flip:
+   wlc_dlog(WLC_DBG_RENDER, "Failed to page flip client buffer: %m");
+fail:
+   release_fb(dsurface->gbm_surface, fb);
+   return false;
+}
+
+static bool
+assign_overlay(struct wlc_backend_surface *bsurface, struct wlc_buffer *buffer, const struct wlc_geometry *geometry)
+{
+   assert(bsurface && bsurface->internal && buffer && geometry);
+   struct drm_surface *dsurface = bsurface->internal;
+
+   if (!dsurface->atomic.enabled || !dsurface->stride || dsurface->flipping)
+      return false;
+
+   struct drm_overlay *overlay = NULL;
+   for (uint32_t i = 0; i < dsurface->atomic.overlays && !overlay; ++i) {
+      if (!dsurface->atomic.overlay[i].assigned)
+         overlay = &dsurface->atomic.overlay[i];
+   }
+
+   if (!overlay)
+      return false;
+
+   struct drm_fb *fb = &overlay->fb[dsurface->index];
+   release_fb(NULL, fb);
+
+   if (!import_buffer(fb, buffer, false))
+      return false;
+
+   overlay->geometry = *geometry;
+   overlay->assigned = true;
+
+   // Driver decides whether format, scaling, position and bandwidth work out
+   if (!test_atomic(bsurface, &dsurface->fb[(dsurface->index + 1) % NUM_FBS])) {
+      overlay->assigned = false;
+      release_fb(NULL, fb);
+      return false;
+   }
+
+   return true;
+}
+
 static void
 surface_sleep(struct wlc_backend_surface *bsurface, bool sleep)
 {
@@ -245,6 +980,17 @@ surface_sleep(struct wlc_backend_surface *bsurface, bool sleep)
    }
 }
 
+static void
+surface_suspend(struct wlc_backend_surface *bsurface, bool suspend)
+{
+   (void)suspend;
+   struct drm_surface *dsurface = bsurface->internal;
+
+   // Another master may have programmed the crtc, so next flip sets the mode and cursor again.
+   // Framebuffers and gbm surface are still ours and get reused.
+   dsurface->stride = 0;
+}
+
 static void
 set_gamma(struct wlc_backend_surface *bsurface, uint16_t size, uint16_t *r, uint16_t *g, uint16_t *b)
 {
@@ -266,6 +1012,18 @@ surface_release(struct wlc_backend_surface *bsurface)
    struct drm_fb *fb = &dsurface->fb[dsurface->index];
    release_fb(dsurface->gbm_surface, fb);
 
+   drmModeSetCursor(drm.fd, dsurface->crtc->crtc_id, 0, 0, 0);
+   for (uint32_t i = 0; i < LENGTH(dsurface->cursor.bo); ++i) {
+      if (dsurface->cursor.bo[i])
+         gbm_bo_destroy(dsurface->cursor.bo[i]);
+   }
+   free(dsurface->cursor.pixels);
+
+   release_atomic(dsurface);
+
+   if (dsurface->backoff)
+      wl_event_source_remove(dsurface->backoff);
+
    drmModeSetCrtc(drm.fd, dsurface->crtc->crtc_id, dsurface->crtc->buffer_id, dsurface->crtc->x, dsurface->crtc->y, &dsurface->connector->connector_id, 1, &dsurface->crtc->mode);
 
    if (dsurface->crtc)
@@ -305,6 +1063,12 @@ add_output(void *device, struct gbm_surface *surface, struct drm_output_informat
    dsurface->crtc = info->crtc;
    dsurface->gbm_surface = surface;
    dsurface->device = device;
+   dsurface->crtc_index = info->crtc_index;
+
+   if (drm.atomic.enabled && !setup_atomic(dsurface)) {
+      wlc_log(WLC_LOG_WARN, "Could not set up atomic modesetting for crtc %u, using legacy api", info->crtc->crtc_id);
+      release_atomic(dsurface);
+   }
 
    bsurface.use_egldevice = drm.use_egldevice;
    bsurface.drm_fd = drm.fd;
@@ -312,7 +1076,12 @@ add_output(void *device, struct gbm_surface *surface, struct drm_output_informat
    bsurface.display_type = (drm.use_egldevice ? EGL_PLATFORM_DEVICE_EXT : EGL_PLATFORM_GBM_KHR);
    bsurface.window = (EGLNativeWindowType)surface;
    bsurface.api.sleep = surface_sleep;
+   bsurface.api.suspend = surface_suspend;
    bsurface.api.page_flip = page_flip;
+   bsurface.api.scanout = scanout;
+   bsurface.api.set_cursor = set_cursor;
+   bsurface.api.move_cursor = move_cursor;
+   bsurface.api.assign_overlay = assign_overlay;
    bsurface.api.set_gamma = set_gamma;
    bsurface.api.get_gamma_size = get_gamma_size;
 
@@ -462,7 +1231,7 @@ query_drm(int fd, struct chck_iter_pool *out_infos)
 
       for (int i = 0; i < connector->count_modes; ++i) {
          struct wlc_output_mode mode = {0};
-         mode.refresh = connector->modes[i].vrefresh * 1000; // mHz
+         mode.refresh = mode_refresh(&connector->modes[i]); // mHz
          mode.width = connector->modes[i].hdisplay;
          mode.height = connector->modes[i].vdisplay;
 
@@ -499,6 +1268,11 @@ query_drm(int fd, struct chck_iter_pool *out_infos)
       info->encoder = encoder;
       info->connector = connector;
 
+      for (int i = 0; i < resources->count_crtcs; ++i) {
+         if (resources->crtcs[i] == crtc->crtc_id)
+            info->crtc_index = i;
+      }
+
       used_crtcs[used_crtcs_num] = crtc->crtc_id;
       used_crtcs_num++;
    }
@@ -519,6 +1293,14 @@ terminate(void)
    if (drm.event_source)
       wl_event_source_remove(drm.event_source);
 
+   if (drm.atomic.idle)
+      wl_event_source_remove(drm.atomic.idle);
+
+   if (drm.atomic.req)
+      drmModeAtomicFree(drm.atomic.req);
+
+   chck_iter_pool_release(&drm.atomic.planes);
+
    if (!drm.use_egldevice && drm.device)
       gbm_device_destroy(drm.device);
 
@@ -530,11 +1312,11 @@ terminate(void)
 }
 
 static bool
-output_exists_for_connector(struct chck_pool *outputs, drmModeConnector *connector)
+output_exists_for_connector(struct wlc_slab *outputs, drmModeConnector *connector)
 {
    assert(outputs && connector);
    struct wlc_output *o;
-   chck_pool_for_each(outputs, o) {
+   wlc_slab_for_each(outputs, o) {
       struct drm_surface *dsurface = o->bsurface.internal;
       if (dsurface && dsurface->connector->connector_id == connector->connector_id)
          return true;
@@ -555,15 +1337,18 @@ info_exists_for_drm_surface(struct chck_iter_pool *infos, struct drm_surface *ds
 }
 
 static uint32_t
-update_outputs(struct chck_pool *outputs)
+update_outputs(struct wlc_slab *outputs)
 {
    struct chck_iter_pool infos;
    if (!chck_iter_pool(&infos, 4, 0, sizeof(struct drm_output_information)) || !query_drm(drm.fd, &infos))
       return 0;
 
+   if (outputs)
+      drm.outputs = outputs;
+
    if (outputs) {
       struct wlc_output *o;
-      chck_pool_for_each(outputs, o) {
+      wlc_slab_for_each(outputs, o) {
          struct drm_surface *dsurface;
          if (!(dsurface = o->bsurface.internal))
             continue;
@@ -646,6 +1431,16 @@ wlc_drm(struct wlc_backend *backend)
          goto egl_device_fail;
    }
 
+   if (!drm.use_egldevice) {
+      bool legacy = false;
+      chck_cstr_to_bool(getenv("WLC_DRM_LEGACY"), &legacy);
+
+      if (!legacy && !drmSetClientCap(drm.fd, DRM_CLIENT_CAP_ATOMIC, 1) && chck_iter_pool(&drm.atomic.planes, 8, 0, sizeof(struct drm_plane)))
+         drm.atomic.enabled = query_planes();
+
+      wlc_log(WLC_LOG_INFO, "Using %s modesetting", (drm.atomic.enabled ? "atomic" : "legacy"));
+   }
+
    if (!(drm.event_source = wl_event_loop_add_fd(wlc_event_loop(), drm.fd, WL_EVENT_READABLE, drm_event, NULL)))
       goto fail;
 
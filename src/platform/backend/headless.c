@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <chck/string/string.h>
+#include <chck/math/math.h>
+#include <wayland-server.h>
+#include <wayland-util.h>
+#include "internal.h"
+#include "macros.h"
+#include "headless.h"
+#include "backend.h"
+#include "compositor/output.h"
+#include "compositor/presentation.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#  define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// FIXME: Contains global state
+
+struct headless_surface {
+   struct wlc_output *output;
+   struct wl_event_source *vblank;
+   uint64_t epoch, next, seq;
+};
+
+static struct {
+   struct wlc_size size;
+   uint32_t refresh; // Hz, 0 finishes frames as soon as they are swapped
+} headless;
+
+static uint64_t
+get_time_ns(void)
+{
+   struct timespec ts;
+   wlc_get_time(&ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+cb_vblank(void *data)
+{
+   struct headless_surface *hsurface = data;
+   assert(hsurface && hsurface->output);
+
+   const struct timespec ts = { .tv_sec = hsurface->next / 1000000000, .tv_nsec = hsurface->next % 1000000000 };
+   wlc_output_finish_frame(hsurface->output, &ts, hsurface->seq, WLC_PRESENTATION_VSYNC);
+   return 1;
+}
+
+static bool
+page_flip(struct wlc_backend_surface *bsurface)
+{
+   assert(bsurface && bsurface->internal);
+   struct headless_surface *hsurface = bsurface->internal;
+   except((hsurface->output = wl_container_of(bsurface, hsurface->output, bsurface)));
+
+   if (!headless.refresh) {
+      struct timespec ts;
+      wlc_get_time(&ts);
+      wlc_output_finish_frame(hsurface->output, &ts, ++hsurface->seq, 0);
+      return true;
+   }
+
+   // Fake vblanks tick at fixed rate from surface creation, frame finishes on the next one
+   const uint64_t now = get_time_ns(), period = 1000000000 / headless.refresh;
+   hsurface->seq = (now - hsurface->epoch) / period + 1;
+   hsurface->next = hsurface->epoch + hsurface->seq * period;
+   wl_event_source_timer_update(hsurface->vblank, chck_maxu32((hsurface->next - now + 999999) / 1000000, 1));
+   return true;
+}
+
+static void
+surface_release(struct wlc_backend_surface *bsurface)
+{
+   struct headless_surface *hsurface = bsurface->internal;
+
+   if (hsurface->vblank)
+      wl_event_source_remove(hsurface->vblank);
+}
+
+static bool
+add_output(struct wlc_output_information *info)
+{
+   struct wlc_backend_surface bsurface;
+   if (!wlc_backend_surface(&bsurface, surface_release, sizeof(struct headless_surface)))
+      return false;
+
+   struct headless_surface *hsurface = bsurface.internal;
+   hsurface->epoch = get_time_ns();
+
+   if (!(hsurface->vblank = wl_event_loop_add_timer(wlc_event_loop(), cb_vblank, hsurface))) {
+      wlc_backend_surface_release(&bsurface);
+      return false;
+   }
+
+   // Nothing native to render to, display just identifies outputs owned by us
+   bsurface.display = (EGLNativeDisplayType)&headless;
+   bsurface.display_type = EGL_PLATFORM_SURFACELESS_MESA;
+   bsurface.use_pbuffer = true;
+   bsurface.api.page_flip = page_flip;
+
+   struct wlc_output_event ev = { .add = { &bsurface, info }, .type = WLC_OUTPUT_EVENT_ADD };
+   wl_signal_emit(&wlc_system_signals()->output, &ev);
+   return true;
+}
+
+static void
+fake_information(struct wlc_output_information *info, uint32_t id)
+{
+   assert(info);
+   wlc_output_information(info);
+   chck_string_set_cstr(&info->make, "wlc", false);
+   chck_string_set_cstr(&info->model, "Headless", false);
+   info->connector = WLC_CONNECTOR_VIRTUAL;
+   info->connector_id = id;
+
+   struct wlc_output_mode mode = {0};
+   mode.refresh = headless.refresh * 1000; // mHz
+   mode.width = headless.size.w;
+   mode.height = headless.size.h;
+   mode.flags = WL_OUTPUT_MODE_CURRENT | WL_OUTPUT_MODE_PREFERRED;
+   wlc_output_information_add_mode(info, &mode);
+}
+
+static uint32_t
+update_outputs(struct wlc_slab *outputs)
+{
+   uint32_t alive = 0;
+   if (outputs) {
+      struct wlc_output *o;
+      wlc_slab_for_each(outputs, o) {
+         if (o->bsurface.display == (EGLNativeDisplayType)&headless)
+            ++alive;
+      }
+   }
+
+   const char *env;
+   uint32_t fakes = 1;
+   if ((env = getenv("WLC_OUTPUTS"))) {
+      chck_cstr_to_u32(env, &fakes);
+      fakes = chck_maxu32(fakes, 1);
+   }
+
+   uint32_t count = 0;
+   for (uint32_t i = alive; i < fakes; ++i) {
+      struct wlc_output_information info;
+      fake_information(&info, 1 + i);
+      count += (add_output(&info) ? 1 : 0);
+   }
+
+   return count;
+}
+
+static void
+terminate(void)
+{
+   memset(&headless, 0, sizeof(headless));
+   wlc_log(WLC_LOG_INFO, "Closed headless");
+}
+
+bool
+wlc_headless(struct wlc_backend *backend)
+{
+   bool enabled = false;
+   if (!chck_cstr_to_bool(getenv("WLC_HEADLESS"), &enabled) || !enabled)
+      return false;
+
+   headless.size = (struct wlc_size){ 1920, 1080 };
+   headless.refresh = 60;
+
+   const char *env;
+   if ((env = getenv("WLC_HEADLESS_SIZE"))) {
+      struct wlc_size size;
+      if (sscanf(env, "%ux%u", &size.w, &size.h) == 2 && size.w > 0 && size.h > 0) {
+         headless.size = size;
+      } else {
+         wlc_log(WLC_LOG_WARN, "Invalid WLC_HEADLESS_SIZE '%s', expected WIDTHxHEIGHT", env);
+      }
+   }
+
+   if ((env = getenv("WLC_HEADLESS_REFRESH")))
+      chck_cstr_to_u32(env, &headless.refresh);
+
+   wlc_log(WLC_LOG_INFO, "Headless outputs %ux%u@%u%s", headless.size.w, headless.size.h, headless.refresh, (headless.refresh ? "" : " (unthrottled)"));
+
+   backend->api.update_outputs = update_outputs;
+   backend->api.terminate = terminate;
+   return true;
+}
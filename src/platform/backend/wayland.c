@@ -54,10 +54,10 @@ xy_event_get_y(void *internal, uint32_t height)
 }
 
 static struct wlc_output *
-output_for_wl_surface(struct chck_pool *outputs, struct wl_surface *surface)
+output_for_wl_surface(struct wlc_slab *outputs, struct wl_surface *surface)
 {
    struct wlc_output *o;
-   chck_pool_for_each(outputs, o) {
+   wlc_slab_for_each(outputs, o) {
       struct wayland_surface *wsurface = o->bsurface.internal;
       if (wsurface->surface == surface)
          return o;
@@ -429,7 +429,7 @@ page_flip(struct wlc_backend_surface *bsurface)
    struct timespec ts;
    wlc_get_time(&ts);
    struct wlc_output *o;
-   wlc_output_finish_frame(wl_container_of(bsurface, o, bsurface), &ts);
+   wlc_output_finish_frame(wl_container_of(bsurface, o, bsurface), &ts, 0, 0);
    return true;
 }
 
@@ -489,7 +489,7 @@ add_output(struct wayland_surface *surface, struct wlc_output_information *info)
 }
 
 static uint32_t
-update_outputs(struct chck_pool *outputs)
+update_outputs(struct wlc_slab *outputs)
 {
    const char *env;
    uint32_t alive = 0;
@@ -498,7 +498,7 @@ update_outputs(struct chck_pool *outputs)
 
    if (outputs) {
       struct wlc_output *o;
-      chck_pool_for_each(outputs, o) {
+      wlc_slab_for_each(outputs, o) {
          if (o->bsurface.window)
             ++alive;
       }
@@ -50,7 +50,7 @@ page_flip(struct wlc_backend_surface *bsurface)
    struct timespec ts;
    wlc_get_time(&ts);
    struct wlc_output *o;
-   wlc_output_finish_frame(wl_container_of(bsurface, o, bsurface), &ts);
+   wlc_output_finish_frame(wl_container_of(bsurface, o, bsurface), &ts, 0, 0);
    return true;
 }
 
@@ -78,10 +78,10 @@ add_output(xcb_window_t window, struct wlc_output_information *info)
 }
 
 static struct wlc_output*
-output_for_window(struct chck_pool *outputs, xcb_window_t window)
+output_for_window(struct wlc_slab *outputs, xcb_window_t window)
 {
    struct wlc_output *o;
-   chck_pool_for_each(outputs, o) {
+   wlc_slab_for_each(outputs, o) {
       if (o->bsurface.window == window)
          return o;
    }
@@ -89,11 +89,11 @@ output_for_window(struct chck_pool *outputs, xcb_window_t window)
 }
 
 static size_t
-outputs_with_window(struct chck_pool *outputs)
+outputs_with_window(struct wlc_slab *outputs)
 {
    size_t count = 0;
    struct wlc_output *o;
-   chck_pool_for_each(outputs, o)
+   wlc_slab_for_each(outputs, o)
       count += (o->bsurface.window ? 1 : 0);
    return count;
 }
@@ -325,12 +325,12 @@ fake_information(struct wlc_output_information *info, uint32_t id)
 }
 
 static uint32_t
-update_outputs(struct chck_pool *outputs)
+update_outputs(struct wlc_slab *outputs)
 {
    uint32_t alive = 0;
    if (outputs) {
       struct wlc_output *o;
-      chck_pool_for_each(outputs, o) {
+      wlc_slab_for_each(outputs, o) {
          if (o->bsurface.window)
             ++alive;
       }
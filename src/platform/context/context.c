@@ -1,9 +1,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <chck/string/string.h>
 #include "internal.h"
 #include "context.h"
 #include "egl.h"
+#include "memory.h"
 
 void*
 wlc_context_get_proc_address(struct wlc_context *context, const char *procname)
@@ -64,6 +66,17 @@ fail:
    return false;
 }
 
+bool
+wlc_context_shares(struct wlc_context *context, struct wlc_context *other)
+{
+   assert(context && other);
+
+   if (!context->context || !other->context || !context->api.shares || context->api.shares != other->api.shares)
+      return false;
+
+   return context->api.shares(context->context, other->context);
+}
+
 bool
 wlc_context_bind_to_wl_display(struct wlc_context *context, struct wl_display *display)
 {
@@ -76,12 +89,23 @@ wlc_context_bind_to_wl_display(struct wlc_context *context, struct wl_display *d
 }
 
 void
-wlc_context_swap(struct wlc_context *context, struct wlc_backend_surface *bsurface)
+wlc_context_swap(struct wlc_context *context, struct wlc_backend_surface *bsurface, const struct wlc_geometry *damage, uint32_t nmemb)
 {
    assert(context);
 
    if (context->api.swap)
-      context->api.swap(context->context, bsurface);
+      context->api.swap(context->context, bsurface, damage, nmemb);
+}
+
+int32_t
+wlc_context_get_buffer_age(struct wlc_context *context)
+{
+   assert(context);
+
+   if (!context->api.buffer_age || !wlc_context_bind(context))
+      return 0;
+
+   return context->api.buffer_age(context->context);
 }
 
 void
@@ -104,10 +128,15 @@ wlc_context(struct wlc_context *context, struct wlc_backend_surface *surface)
 
    void* (*constructor[])(struct wlc_backend_surface*, struct wlc_context_api*) = {
       wlc_egl,
+      wlc_memory,
       NULL
    };
 
-   for (uint32_t i = 0; constructor[i]; ++i) {
+   // Software rendering needs no EGL at all
+   const char *env;
+   const bool software = ((env = getenv("WLC_RENDERER")) && chck_cstreq(env, "pixman"));
+
+   for (uint32_t i = (software ? 1 : 0); constructor[i]; ++i) {
       if ((context->context = constructor[i](surface, &context->api)))
          return true;
    }
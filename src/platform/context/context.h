@@ -1,20 +1,30 @@
 #ifndef _WLC_CONTEXT_H_
 #define _WLC_CONTEXT_H_
 
+#include <stdint.h>
 #include <stdbool.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 
 struct wl_display;
 struct wlc_backend_surface;
+struct wlc_geometry;
 struct ctx;
 
+enum wlc_context_type {
+   WLC_CONTEXT_EGL,
+   WLC_CONTEXT_MEMORY, // no GPU, renderer draws to memory it owns
+};
+
 struct wlc_context_api {
+   enum wlc_context_type context_type;
    WLC_NONULL void (*terminate)(struct ctx *context);
    WLC_NONULL bool (*bind)(struct ctx *context);
    WLC_NONULL bool (*bind_to_wl_display)(struct ctx *context, struct wl_display *display);
-   WLC_NONULL void (*swap)(struct ctx *context, struct wlc_backend_surface *bsurface);
+   WLC_NONULLV(1,2) void (*swap)(struct ctx *context, struct wlc_backend_surface *bsurface, const struct wlc_geometry *damage, uint32_t nmemb);
+   WLC_NONULL int32_t (*buffer_age)(struct ctx *context);
    WLC_NONULL void* (*get_proc_address)(struct ctx *context, const char *procname);
+   WLC_NONULL bool (*shares)(struct ctx *context, struct ctx *other);
 
    // EGL
    WLC_NONULL EGLBoolean (*query_buffer)(struct ctx *context, struct wl_resource *buffer, EGLint attribute, EGLint *value);
@@ -32,8 +42,12 @@ WLC_NONULL EGLBoolean wlc_context_query_buffer(struct wlc_context *context, stru
 WLC_NONULL EGLImageKHR wlc_context_create_image(struct wlc_context *context, EGLenum target, EGLClientBuffer buffer, const EGLint *attrib_list);
 WLC_NONULL EGLBoolean wlc_context_destroy_image(struct wlc_context *context, EGLImageKHR image);
 WLC_NONULL bool wlc_context_bind(struct wlc_context *context);
+
+/** Textures and images created in one context can be used and destroyed in the other. */
+WLC_NONULL bool wlc_context_shares(struct wlc_context *context, struct wlc_context *other);
 WLC_NONULL bool wlc_context_bind_to_wl_display(struct wlc_context *context, struct wl_display *display);
-WLC_NONULL void wlc_context_swap(struct wlc_context *context, struct wlc_backend_surface *bsurface);
+WLC_NONULLV(1,2) void wlc_context_swap(struct wlc_context *context, struct wlc_backend_surface *bsurface, const struct wlc_geometry *damage, uint32_t nmemb);
+WLC_NONULL int32_t wlc_context_get_buffer_age(struct wlc_context *context);
 void wlc_context_release(struct wlc_context *context);
 WLC_NONULL bool wlc_context(struct wlc_context *context, struct wlc_backend_surface *bsurface);
 
@@ -50,6 +50,7 @@ EGLAPI EGLBoolean EGLAPIENTRY eglStreamConsumerAcquireAttribEXT(EGLDisplay dpy,
 #endif
 
 struct ctx {
+   struct wl_list link;
    const char *extensions;
    const char *device_extensions;
    struct wl_display *wl_display;
@@ -59,6 +60,8 @@ struct ctx {
    EGLStreamKHR stream;
    EGLConfig config;
    bool flip_failed;
+   bool buffer_age;
+   bool shared; // in share group of other contexts on the same display
 
    struct {
       // Needed for EGL hw surfaces
@@ -67,7 +70,7 @@ struct ctx {
       PFNEGLQUERYWAYLANDBUFFERWL eglQueryWaylandBufferWL;
       PFNEGLBINDWAYLANDDISPLAYWL eglBindWaylandDisplayWL;
       PFNEGLUNBINDWAYLANDDISPLAYWL eglUnbindWaylandDisplayWL;
-      PFNEGLSWAPBUFFERSWITHDAMAGEEXTPROC eglSwapBuffersWithDamage;
+      PFNEGLSWAPBUFFERSWITHDAMAGEEXTPROC eglSwapBuffersWithDamageEXT;
       // Needed for EGL streams
       PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT;
       PFNEGLGETOUTPUTLAYERSEXTPROC eglGetOutputLayersEXT;
@@ -78,6 +81,9 @@ struct ctx {
    } api;
 };
 
+// Live contexts, new context on the same display shares textures with them
+static struct wl_list contexts = { &contexts, &contexts };
+
 static const char*
 egl_error_string(const EGLint error)
 {
@@ -212,6 +218,7 @@ terminate(struct ctx *context)
 {
    assert(context);
 
+   wl_list_remove(&context->link);
    EGL_CALL(eglMakeCurrent(context->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT));
 
    if (context->surface) {
@@ -262,7 +269,7 @@ get_display(struct ctx *context, EGLint type, void *native, int drm_fd)
 {
    /* In practice any EGL 1.5 implementation would support the EXT extension */
    if (context->api.eglGetPlatformDisplayEXT) {
-      if (has_extension(context, "EGL_EXT_platform_device") && has_device_extension(context, "EGL_EXT_device_drm")) {
+      if (drm_fd >= 0 && has_extension(context, "EGL_EXT_platform_device") && has_device_extension(context, "EGL_EXT_device_drm")) {
          /*
           * Provide the DRM fd when creating the EGLDisplay, so that the
           * EGL implementation can make any necessary DRM calls using the
@@ -319,6 +326,33 @@ create_surface_gbm(EGLDisplay display, EGLConfig config, EGLNativeWindowType win
    return eglCreateWindowSurface(display, config, window, NULL);
 }
 
+static EGLSurface
+create_surface_pbuffer(struct ctx *context, struct wlc_backend_surface *bsurface)
+{
+   struct wlc_output *output;
+   output = wl_container_of(bsurface, output, bsurface);
+
+   EGLint surface_attribs[] = {
+      EGL_WIDTH, output->mode.w,
+      EGL_HEIGHT, output->mode.h,
+      EGL_NONE
+   };
+
+   return eglCreatePbufferSurface(context->display, context->config, surface_attribs);
+}
+
+static EGLSurface
+create_surface(struct ctx *context, struct wlc_backend_surface *bsurface)
+{
+   if (bsurface->use_egldevice)
+      return create_surface_egl_device(context, bsurface);
+
+   if (bsurface->use_pbuffer)
+      return create_surface_pbuffer(context, bsurface);
+
+   return create_surface_gbm(context->display, context->config, bsurface->window);
+}
+
 static struct ctx*
 create_context(struct wlc_backend_surface *bsurface)
 {
@@ -328,6 +362,8 @@ create_context(struct wlc_backend_surface *bsurface)
    if (!(context = calloc(1, sizeof(struct ctx))))
       return NULL;
 
+   wl_list_init(&context->link);
+
    /* Initialize extensions to those of the NULL display, for has_extension */
    context->extensions = EGL_CALL(eglQueryString(NULL, EGL_EXTENSIONS));
    if (has_extension(context, "EGL_EXT_platform_base")) {
@@ -345,7 +381,14 @@ create_context(struct wlc_backend_surface *bsurface)
       context->api.eglStreamConsumerAcquireAttribNV = (void*)eglGetProcAddress("eglStreamConsumerAcquireAttribNV");
    }
 
-   context->display = get_display(context, bsurface->display_type, bsurface->display, bsurface->drm_fd);
+   if (bsurface->use_pbuffer) {
+      // Offscreen surfaces don't have native display, let EGL pick if the platform is not there
+      if (!(context->display = get_display(context, bsurface->display_type, EGL_DEFAULT_DISPLAY, -1)))
+         context->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+   } else {
+      context->display = get_display(context, bsurface->display_type, bsurface->display, bsurface->drm_fd);
+   }
+
    if (!context->display)
       goto egl_fail;
 
@@ -361,7 +404,7 @@ create_context(struct wlc_backend_surface *bsurface)
    } configs[] = {
       {
          (const EGLint[]){
-            EGL_SURFACE_TYPE, bsurface->use_egldevice ? EGL_STREAM_BIT_KHR : EGL_WINDOW_BIT,
+            EGL_SURFACE_TYPE, bsurface->use_egldevice ? EGL_STREAM_BIT_KHR : (bsurface->use_pbuffer ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT),
             EGL_RED_SIZE, 1,
             EGL_GREEN_SIZE, 1,
             EGL_BLUE_SIZE, 1,
@@ -389,7 +432,28 @@ create_context(struct wlc_backend_surface *bsurface)
       EGL_NONE
    };
 
-   if ((context->context = eglCreateContext(context->display, context->config, EGL_NO_CONTEXT, context_attribs)) == EGL_NO_CONTEXT)
+   // Outputs on the same display share one texture namespace,
+   // so surface moving between outputs keeps its textures and EGLImages.
+   EGLContext share = EGL_NO_CONTEXT;
+   {
+      struct ctx *c;
+      wl_list_for_each(c, &contexts, link) {
+         if (c->display != context->display || !c->shared)
+            continue;
+
+         share = c->context;
+         break;
+      }
+   }
+
+   if ((context->context = eglCreateContext(context->display, context->config, share, context_attribs)) != EGL_NO_CONTEXT) {
+      context->shared = true;
+   } else if (share != EGL_NO_CONTEXT) {
+      wlc_log(WLC_LOG_WARN, "Could not create shared EGL context, surfaces are uploaded again when moving between outputs");
+      context->context = eglCreateContext(context->display, context->config, EGL_NO_CONTEXT, context_attribs);
+   }
+
+   if (context->context == EGL_NO_CONTEXT)
       goto egl_fail;
 
    if (bsurface->use_egldevice) {
@@ -404,7 +468,7 @@ create_context(struct wlc_backend_surface *bsurface)
          goto egl_fail;
    }
 
-   context->surface = bsurface->use_egldevice ? create_surface_egl_device(context, bsurface) : create_surface_gbm(context->display, context->config, bsurface->window);
+   context->surface = create_surface(context, bsurface);
    if (context->surface == EGL_NO_SURFACE)
       goto egl_fail;
 
@@ -461,15 +525,15 @@ create_context(struct wlc_backend_surface *bsurface)
       context->api.eglQueryWaylandBufferWL = (void*)eglGetProcAddress("eglQueryWaylandBufferWL");
    }
 
-   if (has_extension(context, "EGL_EXT_swap_buffers_with_damage")) {
-      // FIXME: get hw that supports this feature
-      context->api.eglSwapBuffersWithDamage = (void*)eglGetProcAddress("eglSwapBuffersWithDamage");
-   } else {
-      // FIXME: get hw that supports this feature
-      // wlc_log(WLC_LOG_WARN, "EGL_EXT_swap_buffers_with_damage not supported. Performance could be affected.");
-   }
+   if (has_extension(context, "EGL_EXT_swap_buffers_with_damage"))
+      context->api.eglSwapBuffersWithDamageEXT = (void*)eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+
+   // Without buffer age we can't know what the back buffer contains, and every frame is repainted fully.
+   if (!(context->buffer_age = has_extension(context, "EGL_EXT_buffer_age")))
+      wlc_log(WLC_LOG_WARN, "EGL_EXT_buffer_age not supported. Performance could be affected.");
 
    EGL_CALL(eglSwapInterval(context->display, 1));
+   wl_list_insert(&contexts, &context->link);
    return context;
 
 egl_fail:
@@ -532,8 +596,33 @@ output_stream_flip(struct ctx *context, struct wlc_backend_surface *bsurface)
    return true;
 }
 
+static EGLBoolean
+swap_with_damage(struct ctx *context, const struct wlc_geometry *damage, uint32_t nmemb)
+{
+   assert(context);
+
+   EGLBoolean ret;
+   EGLint rects[4 * 16], height;
+   if (!damage || !context->api.eglSwapBuffersWithDamageEXT || nmemb > LENGTH(rects) / 4 ||
+       !eglQuerySurface(context->display, context->surface, EGL_HEIGHT, &height)) {
+      ret = EGL_CALL(eglSwapBuffers(context->display, context->surface));
+      return ret;
+   }
+
+   // EGL wants the rectangles with lower left origin
+   for (uint32_t i = 0; i < nmemb; ++i) {
+      rects[i * 4 + 0] = damage[i].origin.x;
+      rects[i * 4 + 1] = height - (damage[i].origin.y + (EGLint)damage[i].size.h);
+      rects[i * 4 + 2] = damage[i].size.w;
+      rects[i * 4 + 3] = damage[i].size.h;
+   }
+
+   ret = EGL_CALL(context->api.eglSwapBuffersWithDamageEXT(context->display, context->surface, rects, nmemb));
+   return ret;
+}
+
 static void
-swap(struct ctx *context, struct wlc_backend_surface *bsurface)
+swap(struct ctx *context, struct wlc_backend_surface *bsurface, const struct wlc_geometry *damage, uint32_t nmemb)
 {
    assert(context);
 
@@ -545,7 +634,7 @@ swap(struct ctx *context, struct wlc_backend_surface *bsurface)
    }
 
    if (!context->flip_failed)
-      ret = EGL_CALL(eglSwapBuffers(context->display, context->surface));
+      ret = swap_with_damage(context, damage, nmemb);
 
    if (ret == EGL_TRUE && bsurface->use_egldevice) {
       output_stream_flip(context, bsurface);
@@ -553,6 +642,26 @@ swap(struct ctx *context, struct wlc_backend_surface *bsurface)
       context->flip_failed = !bsurface->api.page_flip(bsurface);
 }
 
+static int32_t
+buffer_age(struct ctx *context)
+{
+   assert(context);
+
+   if (!context->buffer_age)
+      return 0;
+
+   EGLint age = 0;
+   EGLBoolean ret = EGL_CALL(eglQuerySurface(context->display, context->surface, EGL_BUFFER_AGE_EXT, &age));
+   return (ret == EGL_TRUE ? age : 0);
+}
+
+static bool
+shares(struct ctx *context, struct ctx *other)
+{
+   assert(context && other);
+   return (context == other || (context->shared && other->shared && context->display == other->display));
+}
+
 static void*
 get_proc_address(struct ctx *context, const char *procname)
 {
@@ -601,7 +710,9 @@ wlc_egl(struct wlc_backend_surface *bsurface, struct wlc_context_api *api)
    api->bind = bind;
    api->bind_to_wl_display = bind_to_wl_display;
    api->swap = swap;
+   api->buffer_age = buffer_age;
    api->get_proc_address = get_proc_address;
+   api->shares = shares;
    api->destroy_image = destroy_image;
    api->create_image = create_image;
    api->query_buffer = query_buffer;
@@ -0,0 +1,72 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "internal.h"
+#include "memory.h"
+#include "context.h"
+#include "platform/backend/backend.h"
+
+// Context for renderers drawing with CPU into framebuffer they own.
+// There is nothing to make current, swapping just hands the frame to the backend.
+
+struct ctx {
+   bool flip_failed;
+};
+
+static void
+terminate(struct ctx *context)
+{
+   assert(context);
+   free(context);
+}
+
+static bool
+bind(struct ctx *context)
+{
+   (void)context;
+   assert(context);
+   return true;
+}
+
+static void
+swap(struct ctx *context, struct wlc_backend_surface *bsurface, const struct wlc_geometry *damage, uint32_t nmemb)
+{
+   (void)damage, (void)nmemb;
+   assert(context);
+
+   if (!context->flip_failed && bsurface->api.page_flip)
+      context->flip_failed = !bsurface->api.page_flip(bsurface);
+}
+
+static int32_t
+buffer_age(struct ctx *context)
+{
+   (void)context;
+   assert(context);
+
+   // Single framebuffer that keeps the last frame, only damage needs repainting
+   return 1;
+}
+
+void*
+wlc_memory(struct wlc_backend_surface *bsurface, struct wlc_context_api *api)
+{
+   assert(bsurface && api);
+
+   // Only offscreen surfaces can live without native window to present
+   if (!bsurface->use_pbuffer)
+      return NULL;
+
+   struct ctx *context;
+   if (!(context = calloc(1, sizeof(struct ctx))))
+      return NULL;
+
+   api->context_type = WLC_CONTEXT_MEMORY;
+   api->terminate = terminate;
+   api->bind = bind;
+   api->swap = swap;
+   api->buffer_age = buffer_age;
+
+   wlc_log(WLC_LOG_INFO, "Memory context created");
+   return context;
+}
@@ -5,7 +5,9 @@
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 #include <wayland-server.h>
+#include <math.h>
 #include <chck/string/string.h>
+#include <chck/math/math.h>
 #include "internal.h"
 #include "gles2.h"
 #include "render.h"
@@ -64,7 +66,18 @@ static const struct {
    { GL_RGBA, GL_UNSIGNED_BYTE }, // WLC_RGBA8888
 };
 
+// Quads collected before issuing a draw call
+#define BATCH_QUADS 256
+
+// Vertices per quad, and floats per vertex (pos.xy, uv.xy)
+#define QUAD_VERTICES 6
+#define VERTEX_FLOATS 4
+
+// Frames that may be timed on GPU at once, results lag behind by this many frames at most
+#define TIMER_QUERIES 3
+
 struct ctx {
+   struct wl_list link;
    const char *extensions;
 
    struct ctx_program *program;
@@ -83,12 +96,52 @@ struct ctx {
    GLenum preferred_type;
    bool native_resolution;
    bool fakefb_dirty;
+   bool scissor;
+
+   // Quads sharing program, textures and filter, drawn with single call
+   struct {
+      GLfloat vertices[BATCH_QUADS * QUAD_VERTICES * VERTEX_FLOATS];
+      GLuint quads;
+      GLuint textures[3];
+      GLenum filter;
+      enum program_type program;
+      GLuint vbo;
+   } batch;
+
+   // Cached GL state, forgotten whenever someone else may touch GL
+   struct {
+      GLuint textures[3];
+      GLenum unit; // active texture unit, 0 when unknown
+      bool vbo;
+   } bound;
+
+   // Filter of each texture, indexed by texture name
+   struct {
+      GLenum *filter;
+      GLuint size;
+   } params;
+
+   // GL_EXT_disjoint_timer_query, loaded on first use
+   struct {
+      GLuint queries[TIMER_QUERIES];
+      uint32_t issued, collected;
+      bool active, loaded, unsupported;
+   } timer;
 
    struct {
       PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES;
+      PFNGLGENQUERIESEXTPROC glGenQueriesEXT;
+      PFNGLDELETEQUERIESEXTPROC glDeleteQueriesEXT;
+      PFNGLBEGINQUERYEXTPROC glBeginQueryEXT;
+      PFNGLENDQUERYEXTPROC glEndQueryEXT;
+      PFNGLGETQUERYOBJECTIVEXTPROC glGetQueryObjectivEXT;
+      PFNGLGETQUERYOBJECTUI64VEXTPROC glGetQueryObjectui64vEXT;
    } api;
 };
 
+// Live renderers, EGL contexts of outputs may share texture names
+static struct wl_list contexts = { &contexts, &contexts };
+
 struct paint {
    struct wlc_geometry visible;
    enum program_type program;
@@ -156,10 +209,138 @@ set_program(struct ctx *context, enum program_type type)
 {
    assert(context && type >= 0 && type < PROGRAM_LAST);
 
+   if (context->program == &context->programs[type])
+      return;
+
    context->program = &context->programs[type];
    GL_CALL(glUseProgram(context->program->obj));
 }
 
+static void
+forget_bindings(struct ctx *context)
+{
+   assert(context);
+   memset(context->bound.textures, 0, sizeof(context->bound.textures));
+   context->bound.unit = 0;
+}
+
+static void
+forget_state(struct ctx *context)
+{
+   assert(context);
+   context->program = NULL;
+   memset(&context->bound, 0, sizeof(context->bound));
+}
+
+static void
+active_texture(struct ctx *context, GLuint unit)
+{
+   assert(context && unit < 3);
+
+   if (context->bound.unit == GL_TEXTURE0 + unit)
+      return;
+
+   GL_CALL(glActiveTexture(GL_TEXTURE0 + unit));
+   context->bound.unit = GL_TEXTURE0 + unit;
+}
+
+static void
+bind_texture(struct ctx *context, GLuint unit, GLuint texture)
+{
+   assert(context && unit < 3);
+
+   // unit is selected even when the texture is already bound, parameters and uploads that follow act on it
+   active_texture(context, unit);
+
+   if (context->bound.textures[unit] == texture)
+      return;
+
+   GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+   context->bound.textures[unit] = texture;
+}
+
+static void
+set_texture_filter(struct ctx *context, GLuint texture, GLenum filter)
+{
+   assert(context && texture);
+
+   if (texture < context->params.size && context->params.filter[texture] == filter)
+      return;
+
+   // assumes texture already bound!
+   GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter));
+   GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter));
+
+   if (texture >= context->params.size) {
+      const GLuint size = chck_maxu32(texture + 1, context->params.size * 2);
+
+      GLenum *params;
+      if (!(params = realloc(context->params.filter, size * sizeof(GLenum))))
+         return;
+
+      memset(params + context->params.size, 0, (size - context->params.size) * sizeof(GLenum));
+      context->params.filter = params;
+      context->params.size = size;
+   }
+
+   context->params.filter[texture] = filter;
+}
+
+static void
+forget_texture(GLuint texture)
+{
+   // Texture may have been used by any renderer in the share group, and its name is reused after deletion.
+   struct ctx *context;
+   wl_list_for_each(context, &contexts, link) {
+      if (texture < context->params.size)
+         context->params.filter[texture] = 0;
+
+      for (GLuint i = 0; i < 3; ++i) {
+         if (context->bound.textures[i] == texture)
+            context->bound.textures[i] = 0;
+      }
+   }
+}
+
+static void
+batch_flush(struct ctx *context)
+{
+   assert(context);
+
+   if (!context->batch.quads)
+      return;
+
+   set_program(context, context->batch.program);
+
+   for (GLuint i = 0; i < 3 && context->batch.textures[i]; ++i) {
+      bind_texture(context, i, context->batch.textures[i]);
+      set_texture_filter(context, context->batch.textures[i], context->batch.filter);
+   }
+
+   if (!context->bound.vbo) {
+      GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, context->batch.vbo));
+      GL_CALL(glEnableVertexAttribArray(0));
+      GL_CALL(glEnableVertexAttribArray(1));
+      GL_CALL(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(GLfloat), (void*)0));
+      GL_CALL(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat))));
+      context->bound.vbo = true;
+   }
+
+   // orphan the previous storage, so we don't stall on draws still in flight
+   const GLsizei count = context->batch.quads * QUAD_VERTICES;
+   GL_CALL(glBufferData(GL_ARRAY_BUFFER, count * VERTEX_FLOATS * sizeof(GLfloat), context->batch.vertices, GL_STREAM_DRAW));
+   GL_CALL(glDrawArrays(GL_TRIANGLES, 0, count));
+   context->batch.quads = 0;
+}
+
+static void
+set_blend_func(struct ctx *context, GLenum sfactor, GLenum dfactor)
+{
+   assert(context);
+   batch_flush(context);
+   GL_CALL(glBlendFunc(sfactor, dfactor));
+}
+
 static GLuint
 create_shader(const char *source, GLenum shader_type)
 {
@@ -351,6 +532,8 @@ create_context(void)
       context->programs[i].obj = glCreateProgram();
       GL_CALL(glAttachShader(context->programs[i].obj, vert));
       GL_CALL(glAttachShader(context->programs[i].obj, frag));
+      GL_CALL(glBindAttribLocation(context->programs[i].obj, 0, "pos"));
+      GL_CALL(glBindAttribLocation(context->programs[i].obj, 1, "uv"));
       GL_CALL(glLinkProgram(context->programs[i].obj));
       GL_CALL(glDeleteShader(vert));
       GL_CALL(glDeleteShader(frag));
@@ -366,8 +549,6 @@ create_context(void)
       }
 
       set_program(context, i);
-      GL_CALL(glBindAttribLocation(context->programs[i].obj, 0, "pos"));
-      GL_CALL(glBindAttribLocation(context->programs[i].obj, 1, "uv"));
 
       for (int u = 0; u < UNIFORM_LAST; ++u) {
          context->programs[i].uniforms[u] = GL_CALL(glGetUniformLocation(context->programs[i].obj, uniform_names[u]));
@@ -401,8 +582,7 @@ create_context(void)
       GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, images[i].format, images[i].w, images[i].h, 0, images[i].format, images[i].type, images[i].data));
    }
 
-   GL_CALL(glEnableVertexAttribArray(0));
-   GL_CALL(glEnableVertexAttribArray(1));
+   GL_CALL(glGenBuffers(1, &context->batch.vbo));
 
    GL_CALL(glGenFramebuffers(1, &context->clear_fbo));
    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, context->clear_fbo));
@@ -412,6 +592,8 @@ create_context(void)
    GL_CALL(glEnable(GL_BLEND));
    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
    GL_CALL(glClearColor(0.0, 0.0, 0.0, 0.0));
+   forget_state(context);
+   wl_list_insert(&contexts, &context->link);
    return context;
 }
 
@@ -419,9 +601,16 @@ static void
 clear_fakefb(struct ctx *context)
 {
    // assumes texture already bound!
+   // fakefb must be cleared fully, scissor box only applies to the output framebuffer
+   if (context->scissor)
+      GL_CALL(glDisable(GL_SCISSOR_TEST));
+
    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, context->clear_fbo));
    GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+   if (context->scissor)
+      GL_CALL(glEnable(GL_SCISSOR_TEST));
 }
 
 static void
@@ -429,13 +618,15 @@ resolution(struct ctx *context, const struct wlc_size *mode, const struct wlc_si
 {
    assert(context && resolution && scale > 0);
 
+   batch_flush(context);
+
    if (!wlc_size_equals(&context->resolution, resolution)) {
       for (GLuint i = 0; i < PROGRAM_LAST; ++i) {
          set_program(context, i);
          GL_CALL(glUniform2fv(context->program->uniforms[UNIFORM_RESOLUTION], 1, (GLfloat[]){ resolution->w, resolution->h }));
       }
 
-      GL_CALL(glBindTexture(GL_TEXTURE_2D, context->textures[TEXTURE_FAKEFB]));
+      bind_texture(context, 0, context->textures[TEXTURE_FAKEFB]);
       GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, resolution->w, resolution->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL));
       clear_fakefb(context);
       context->resolution = *resolution;
@@ -452,33 +643,35 @@ resolution(struct ctx *context, const struct wlc_size *mode, const struct wlc_si
 }
 
 static void
-surface_gen_textures(struct wlc_surface *surface, const GLuint num_textures)
+surface_gen_textures(struct ctx *context, struct wlc_surface *surface, const GLuint num_textures)
 {
-   assert(surface);
+   assert(context && surface);
 
    for (GLuint i = 0; i < num_textures; ++i) {
       if (surface->textures[i])
          continue;
 
       GL_CALL(glGenTextures(1, &surface->textures[i]));
-      GL_CALL(glBindTexture(GL_TEXTURE_2D, surface->textures[i]));
+      bind_texture(context, 0, surface->textures[i]);
       GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
       GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
    }
 }
 
 static void
-surface_flush_textures(struct wlc_surface *surface)
+surface_flush_textures(struct ctx *context, struct wlc_surface *surface)
 {
-   assert(surface);
+   assert(context && surface);
 
    for (GLuint i = 0; i < 3; ++i) {
       if (surface->textures[i]) {
+         forget_texture(surface->textures[i]);
          GL_CALL(glDeleteTextures(1, &surface->textures[i]));
       }
    }
 
    memset(surface->textures, 0, sizeof(surface->textures));
+   memset(&surface->storage, 0, sizeof(surface->storage));
 }
 
 static void
@@ -497,21 +690,17 @@ surface_flush_images(struct wlc_context *context, struct wlc_surface *surface)
 static void
 surface_destroy(struct ctx *context, struct wlc_context *bound, struct wlc_surface *surface)
 {
-   (void)context;
    assert(context && bound && surface);
-   surface_flush_textures(surface);
+   batch_flush(context);
+   surface_flush_textures(context, surface);
    surface_flush_images(bound, surface);
    wlc_dlog(WLC_DBG_RENDER, "-> Destroyed surface");
 }
 
 static bool
-shm_attach(struct wlc_surface *surface, struct wlc_buffer *buffer, struct wl_shm_buffer *shm_buffer)
+shm_attach(struct ctx *context, struct wlc_surface *surface, struct wlc_buffer *buffer, struct wl_shm_buffer *shm_buffer)
 {
-   assert(surface && buffer && shm_buffer);
-
-   buffer->shm_buffer = shm_buffer;
-   buffer->size.w = wl_shm_buffer_get_width(shm_buffer);
-   buffer->size.h = wl_shm_buffer_get_height(shm_buffer);
+   assert(context && surface && buffer && shm_buffer);
 
    GLint pitch;
    GLenum gl_format, gl_pixel_type;
@@ -540,19 +729,46 @@ shm_attach(struct wlc_surface *surface, struct wlc_buffer *buffer, struct wl_shm
    }
 
    struct wlc_view *view;
-   if ((view = convert_from_wlc_handle(surface->view, "view")) && is_x11_view(view))
+   if ((view = convert_from_wlc_handle(surface->view, WLC_TYPE_VIEW)) && is_x11_view(view))
       wlc_x11_window_set_surface_format(surface, &view->x11);
 
-   surface_gen_textures(surface, 1);
-   GL_CALL(glBindTexture(GL_TEXTURE_2D, surface->textures[0]));
+   surface_gen_textures(context, surface, 1);
+   bind_texture(context, 0, surface->textures[0]);
    GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, pitch));
-   GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0));
-   GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0));
    wl_shm_buffer_begin_access(buffer->shm_buffer);
    void *data = wl_shm_buffer_get_data(buffer->shm_buffer);
-   GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, gl_format, pitch, buffer->size.h, 0, gl_format, gl_pixel_type, data));
+
+   const struct wlc_size size = { pitch, buffer->size.h };
+   if (!wlc_size_equals(&surface->storage.size, &size) || surface->storage.format != gl_format || surface->storage.type != gl_pixel_type) {
+      GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0));
+      GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0));
+      GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, gl_format, size.w, size.h, 0, gl_format, gl_pixel_type, data));
+      surface->storage.size = size;
+      surface->storage.format = gl_format;
+      surface->storage.type = gl_pixel_type;
+   } else {
+      // Storage is still valid, only upload what the client damaged since the last upload.
+      int nrects;
+      const pixman_box32_t *boxes = pixman_region32_rectangles(&surface->upload_damage, &nrects);
+      for (int i = 0; i < nrects; ++i) {
+         const int32_t x1 = chck_clamp32(boxes[i].x1, 0, size.w), y1 = chck_clamp32(boxes[i].y1, 0, size.h);
+         const int32_t x2 = chck_clamp32(boxes[i].x2, 0, size.w), y2 = chck_clamp32(boxes[i].y2, 0, size.h);
+
+         if (x2 <= x1 || y2 <= y1)
+            continue;
+
+         GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, x1));
+         GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, y1));
+         GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, x1, y1, x2 - x1, y2 - y1, gl_format, gl_pixel_type, data));
+      }
+
+      wlc_dlog(WLC_DBG_RENDER, "-> Uploaded %d damaged rectangles of surface (%" PRIuWLC ")", nrects, convert_to_wlc_resource(surface));
+   }
+
    wl_shm_buffer_end_access(buffer->shm_buffer);
    GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0));
+   GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0));
+   GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0));
 
    return true;
 }
@@ -571,11 +787,6 @@ egl_attach(struct ctx *context, struct wlc_context *ectx, struct wlc_surface *su
       assert(context->api.glEGLImageTargetTexture2DOES);
    }
 
-   buffer->legacy_buffer = convert_to_wl_resource(buffer, "buffer");
-   wlc_context_query_buffer(ectx, buffer->legacy_buffer, EGL_WIDTH, (EGLint*)&buffer->size.w);
-   wlc_context_query_buffer(ectx, buffer->legacy_buffer, EGL_HEIGHT, (EGLint*)&buffer->size.h);
-   wlc_context_query_buffer(ectx, buffer->legacy_buffer, EGL_WAYLAND_Y_INVERTED_WL, (EGLint*)&buffer->y_inverted);
-
    GLuint num_planes;
    GLenum target = GL_TEXTURE_2D;
    switch (format) {
@@ -605,7 +816,7 @@ egl_attach(struct ctx *context, struct wlc_context *ectx, struct wlc_surface *su
    }
 
    struct wlc_view *view;
-   if ((view = convert_from_wlc_handle(surface->view, "view")) && is_x11_view(view))
+   if ((view = convert_from_wlc_handle(surface->view, WLC_TYPE_VIEW)) && is_x11_view(view))
       wlc_x11_window_set_surface_format(surface, &view->x11);
 
    if (num_planes > 3) {
@@ -614,7 +825,10 @@ egl_attach(struct ctx *context, struct wlc_context *ectx, struct wlc_surface *su
    }
 
    surface_flush_images(ectx, surface);
-   surface_gen_textures(surface, num_planes);
+   surface_gen_textures(context, surface, num_planes);
+
+   // textures are now backed by images, shm attach must specify new storage
+   memset(&surface->storage, 0, sizeof(surface->storage));
 
    for (GLuint i = 0; i < num_planes; ++i) {
       EGLint attribs[] = { EGL_WAYLAND_PLANE_WL, i, EGL_NONE };
@@ -626,6 +840,41 @@ egl_attach(struct ctx *context, struct wlc_context *ectx, struct wlc_surface *su
       GL_CALL(context->api.glEGLImageTargetTexture2DOES(target, surface->images[i]));
    }
 
+   // binding may have happened on another target
+   forget_bindings(context);
+
+   return true;
+}
+
+static bool
+buffer_query(struct ctx *context, struct wlc_context *bound, struct wlc_buffer *buffer)
+{
+   (void)context;
+   assert(context && bound && buffer);
+
+   struct wl_resource *wl_buffer;
+   if (!(wl_buffer = convert_to_wl_resource(buffer, WLC_TYPE_BUFFER)))
+      return false;
+
+   struct wl_shm_buffer *shm_buffer;
+   if ((shm_buffer = wl_shm_buffer_get(wl_buffer))) {
+      buffer->shm_buffer = shm_buffer;
+      buffer->size.w = wl_shm_buffer_get_width(shm_buffer);
+      buffer->size.h = wl_shm_buffer_get_height(shm_buffer);
+      return true;
+   }
+
+   EGLint format;
+   if (!wlc_context_query_buffer(bound, (void*)wl_buffer, EGL_TEXTURE_FORMAT, &format)) {
+      /* unknown buffer */
+      wlc_log(WLC_LOG_WARN, "Unknown buffer");
+      return false;
+   }
+
+   buffer->legacy_buffer = wl_buffer;
+   wlc_context_query_buffer(bound, buffer->legacy_buffer, EGL_WIDTH, (EGLint*)&buffer->size.w);
+   wlc_context_query_buffer(bound, buffer->legacy_buffer, EGL_HEIGHT, (EGLint*)&buffer->size.h);
+   wlc_context_query_buffer(bound, buffer->legacy_buffer, EGL_WAYLAND_Y_INVERTED_WL, (EGLint*)&buffer->y_inverted);
    return true;
 }
 
@@ -635,22 +884,25 @@ surface_attach(struct ctx *context, struct wlc_context *bound, struct wlc_surfac
    assert(context && bound && surface);
 
    struct wl_resource *wl_buffer;
-   if (!buffer || !(wl_buffer = convert_to_wl_resource(buffer, "buffer"))) {
+   if (!buffer || !(wl_buffer = convert_to_wl_resource(buffer, WLC_TYPE_BUFFER))) {
       surface_destroy(context, bound, surface);
       return true;
    }
 
+   if (!buffer_query(context, bound, buffer))
+      return false;
+
+   // queued quads may still sample the old contents
+   batch_flush(context);
+
    EGLint format;
    bool attached = false;
 
    struct wl_shm_buffer *shm_buffer = wl_shm_buffer_get(wl_buffer);
    if (shm_buffer) {
-      attached = shm_attach(surface, buffer, shm_buffer);
+      attached = shm_attach(context, surface, buffer, shm_buffer);
    } else if (wlc_context_query_buffer(bound, (void*)wl_buffer, EGL_TEXTURE_FORMAT, &format)) {
       attached = egl_attach(context, bound, surface, buffer, format);
-   } else {
-      /* unknown buffer */
-      wlc_log(WLC_LOG_WARN, "Unknown buffer");
    }
 
    if (attached)
@@ -662,41 +914,36 @@ surface_attach(struct ctx *context, struct wlc_context *bound, struct wlc_surfac
 static void
 texture_paint(struct ctx *context, GLuint *textures, GLuint nmemb, const struct wlc_geometry *geometry, struct paint *settings)
 {
-   const GLfloat vertices[8] = {
-      geometry->origin.x + geometry->size.w, geometry->origin.y,
-      geometry->origin.x, geometry->origin.y,
-      geometry->origin.x + geometry->size.w, geometry->origin.y + geometry->size.h,
-      geometry->origin.x, geometry->origin.y + geometry->size.h,
+   GLuint batch_textures[3] = {0};
+   for (GLuint i = 0; i < nmemb && i < 3 && textures[i]; ++i)
+      batch_textures[i] = textures[i];
+
+   const GLenum filter = (settings->filter || !context->native_resolution ? GL_LINEAR : GL_NEAREST);
+
+   if (context->batch.quads > 0 &&
+       (context->batch.quads >= BATCH_QUADS || context->batch.program != settings->program || context->batch.filter != filter ||
+        memcmp(context->batch.textures, batch_textures, sizeof(batch_textures))))
+      batch_flush(context);
+
+   context->batch.program = settings->program;
+   context->batch.filter = filter;
+   memcpy(context->batch.textures, batch_textures, sizeof(batch_textures));
+
+   const GLfloat x1 = geometry->origin.x, y1 = geometry->origin.y;
+   const GLfloat x2 = x1 + geometry->size.w, y2 = y1 + geometry->size.h;
+
+   // two triangles, same winding as the old triangle strip
+   const GLfloat quad[QUAD_VERTICES * VERTEX_FLOATS] = {
+      x2, y1, 1, 0,
+      x1, y1, 0, 0,
+      x2, y2, 1, 1,
+      x2, y2, 1, 1,
+      x1, y1, 0, 0,
+      x1, y2, 0, 1,
    };
 
-   const GLfloat coords[8] = {
-      1, 0,
-      0, 0,
-      1, 1,
-      0, 1
-   };
-
-   set_program(context, settings->program);
-
-   for (GLuint i = 0; i < nmemb; ++i) {
-      if (!textures[i])
-         break;
-
-      GL_CALL(glActiveTexture(GL_TEXTURE0 + i));
-      GL_CALL(glBindTexture(GL_TEXTURE_2D, textures[i]));
-
-      if (settings->filter || !context->native_resolution) {
-         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-      } else {
-         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-      }
-   }
-
-   GL_CALL(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, vertices));
-   GL_CALL(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, coords));
-   GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+   memcpy(&context->batch.vertices[context->batch.quads * QUAD_VERTICES * VERTEX_FLOATS], quad, sizeof(quad));
+   context->batch.quads++;
 }
 
 static void
@@ -736,17 +983,17 @@ surface_paint(struct ctx *context, struct wlc_surface *surface, const struct wlc
    if (DRAW_OPAQUE) {
       wlc_surface_get_opaque(surface, &geometry->origin, &settings.visible);
       settings.program = PROGRAM_RGB;
-      GL_CALL(glBlendFunc(GL_ONE, GL_DST_COLOR));
+      set_blend_func(context, GL_ONE, GL_DST_COLOR);
       texture_paint(context, &context->textures[TEXTURE_RED], 1, &settings.visible, &settings);
-      GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+      set_blend_func(context, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
    }
 
    if (DRAW_INPUT) {
       wlc_surface_get_input(surface, &geometry->origin, &settings.visible);
       settings.program = PROGRAM_RGB;
-      GL_CALL(glBlendFunc(GL_ONE, GL_DST_COLOR));
+      set_blend_func(context, GL_ONE, GL_DST_COLOR);
       texture_paint(context, &context->textures[TEXTURE_BLUE], 1, &settings.visible, &settings);
-      GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+      set_blend_func(context, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
    }
 }
 
@@ -756,7 +1003,7 @@ view_paint(struct ctx *context, struct wlc_view *view)
    assert(context && view);
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wlc_resource(view->surface, "surface")))
+   if (!(surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
       return;
 
    struct paint settings;
@@ -770,17 +1017,17 @@ view_paint(struct ctx *context, struct wlc_view *view)
    if (DRAW_OPAQUE) {
       wlc_view_get_opaque(view, &settings.visible);
       settings.program = PROGRAM_RGB;
-      GL_CALL(glBlendFunc(GL_ONE, GL_DST_COLOR));
+      set_blend_func(context, GL_ONE, GL_DST_COLOR);
       texture_paint(context, &context->textures[TEXTURE_RED], 1, &settings.visible, &settings);
-      GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+      set_blend_func(context, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
    }
 
    if (DRAW_INPUT) {
       wlc_view_get_input(view, &settings.visible);
       settings.program = PROGRAM_RGB;
-      GL_CALL(glBlendFunc(GL_ONE, GL_DST_COLOR));
+      set_blend_func(context, GL_ONE, GL_DST_COLOR);
       texture_paint(context, &context->textures[TEXTURE_BLUE], 1, &settings.visible, &settings);
-      GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+      set_blend_func(context, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
    }
 }
 
@@ -826,8 +1073,8 @@ clamp_to_bounds(struct wlc_geometry *g, const struct wlc_size *bounds)
 static void
 read_pixels(struct ctx *context, enum wlc_pixel_format format, const struct wlc_geometry *geometry, struct wlc_geometry *out_geometry, void *out_data)
 {
-   (void)context;
    assert(context && geometry && out_geometry && out_data);
+   batch_flush(context);
    struct wlc_geometry g = *geometry;
    clamp_to_bounds(&g, &context->mode);
    // flip vertical coords, OpenGL assumes lower left is (0, 0)
@@ -839,11 +1086,11 @@ read_pixels(struct ctx *context, enum wlc_pixel_format format, const struct wlc_
 static void
 write_pixels(struct ctx *context, enum wlc_pixel_format format, const struct wlc_geometry *geometry, const void *data)
 {
-   (void)context;
    assert(context && geometry && data);
+   batch_flush(context);
    struct wlc_geometry g = *geometry;
    clamp_to_bounds(&g, &context->mode);
-   GL_CALL(glBindTexture(GL_TEXTURE_2D, context->textures[TEXTURE_FAKEFB]));
+   bind_texture(context, 0, context->textures[TEXTURE_FAKEFB]);
    GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, g.origin.x, g.origin.y, g.size.w, g.size.h, format_map[format].format, format_map[format].type, data));
    context->fakefb_dirty = true;
 }
@@ -859,6 +1106,7 @@ flush_fakefb(struct ctx *context)
    struct paint settings = {0};
    settings.program = PROGRAM_RGBA;
    texture_paint(context, &context->textures[TEXTURE_FAKEFB], 1, &(struct wlc_geometry){ .origin = { 0, 0 }, .size = context->resolution }, &settings);
+   batch_flush(context);
    clear_fakefb(context);
    context->fakefb_dirty = false;
 }
@@ -866,22 +1114,163 @@ flush_fakefb(struct ctx *context)
 static void
 clear(struct ctx *context)
 {
-   (void)context;
    assert(context);
+   batch_flush(context);
    GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
 }
 
+static void
+flush(struct ctx *context)
+{
+   assert(context);
+   batch_flush(context);
+
+   // hooks may still draw with client side arrays, which the streaming buffer would break
+   if (context->bound.vbo) {
+      GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+      GL_CALL(glDisableVertexAttribArray(0));
+      GL_CALL(glDisableVertexAttribArray(1));
+   }
+
+   // whoever runs next may use GL behind our back
+   forget_state(context);
+}
+
+static void
+scissor(struct ctx *context, const struct wlc_geometry *geometry)
+{
+   assert(context);
+   batch_flush(context);
+
+   if (!geometry) {
+      if (context->scissor)
+         GL_CALL(glDisable(GL_SCISSOR_TEST));
+
+      context->scissor = false;
+      return;
+   }
+
+   // geometry is in virtual resolution, scissor box is in mode pixels with lower left origin
+   const float sx = (float)context->mode.w / chck_maxu32(context->resolution.w, 1);
+   const float sy = (float)context->mode.h / chck_maxu32(context->resolution.h, 1);
+   const int32_t x1 = floor(geometry->origin.x * sx), y1 = floor(geometry->origin.y * sy);
+   const int32_t x2 = ceil((geometry->origin.x + (int32_t)geometry->size.w) * sx), y2 = ceil((geometry->origin.y + (int32_t)geometry->size.h) * sy);
+   GL_CALL(glScissor(x1, (int32_t)context->mode.h - y2, x2 - x1, y2 - y1));
+
+   if (!context->scissor)
+      GL_CALL(glEnable(GL_SCISSOR_TEST));
+
+   context->scissor = true;
+}
+
+static bool
+timer_load(struct ctx *context, struct wlc_context *bound)
+{
+   assert(context && bound);
+
+   if (context->timer.loaded || context->timer.unsupported)
+      return context->timer.loaded;
+
+   if (!has_extension(context, "GL_EXT_disjoint_timer_query") ||
+       !(context->api.glGenQueriesEXT = wlc_context_get_proc_address(bound, "glGenQueriesEXT")) ||
+       !(context->api.glDeleteQueriesEXT = wlc_context_get_proc_address(bound, "glDeleteQueriesEXT")) ||
+       !(context->api.glBeginQueryEXT = wlc_context_get_proc_address(bound, "glBeginQueryEXT")) ||
+       !(context->api.glEndQueryEXT = wlc_context_get_proc_address(bound, "glEndQueryEXT")) ||
+       !(context->api.glGetQueryObjectivEXT = wlc_context_get_proc_address(bound, "glGetQueryObjectivEXT")) ||
+       !(context->api.glGetQueryObjectui64vEXT = wlc_context_get_proc_address(bound, "glGetQueryObjectui64vEXT"))) {
+      wlc_log(WLC_LOG_INFO, "gles2: No GL_EXT_disjoint_timer_query, GPU frame times are not measured");
+      context->timer.unsupported = true;
+      return false;
+   }
+
+   GL_CALL(context->api.glGenQueriesEXT(TIMER_QUERIES, context->timer.queries));
+   context->timer.loaded = true;
+   return true;
+}
+
+static void
+timer_begin(struct ctx *context, struct wlc_context *bound)
+{
+   assert(context && bound);
+
+   // all queries still in flight, this frame goes unmeasured
+   if (context->timer.active || !timer_load(context, bound) || context->timer.issued - context->timer.collected >= TIMER_QUERIES)
+      return;
+
+   batch_flush(context);
+   GL_CALL(context->api.glBeginQueryEXT(GL_TIME_ELAPSED_EXT, context->timer.queries[context->timer.issued % TIMER_QUERIES]));
+   context->timer.active = true;
+}
+
+static void
+timer_end(struct ctx *context)
+{
+   assert(context);
+
+   if (!context->timer.active)
+      return;
+
+   batch_flush(context);
+   GL_CALL(context->api.glEndQueryEXT(GL_TIME_ELAPSED_EXT));
+   context->timer.issued++;
+   context->timer.active = false;
+}
+
+static bool
+timer_result(struct ctx *context, uint64_t *out_ns)
+{
+   assert(context && out_ns);
+
+   bool completed = false;
+   GLuint64 elapsed = 0;
+   while (context->timer.collected != context->timer.issued) {
+      GLint available = 0;
+      const GLuint query = context->timer.queries[context->timer.collected % TIMER_QUERIES];
+      GL_CALL(context->api.glGetQueryObjectivEXT(query, GL_QUERY_RESULT_AVAILABLE_EXT, &available));
+
+      if (!available)
+         break;
+
+      GL_CALL(context->api.glGetQueryObjectui64vEXT(query, GL_QUERY_RESULT_EXT, &elapsed));
+      context->timer.collected++;
+      completed = true;
+   }
+
+   if (!completed)
+      return false;
+
+   // clock changes (power management for example) make the results meaningless
+   GLint disjoint = 0;
+   GL_CALL(glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint));
+   if (disjoint)
+      return false;
+
+   *out_ns = elapsed;
+   return true;
+}
+
 static void
 terminate(struct ctx *context)
 {
    assert(context);
 
+   if (context->timer.loaded) {
+      GL_CALL(context->api.glDeleteQueriesEXT(TIMER_QUERIES, context->timer.queries));
+   }
+
    for (GLuint i = 0; i < PROGRAM_LAST; ++i) {
       GL_CALL(glDeleteProgram(context->programs[i].obj));
    }
 
+   wl_list_remove(&context->link);
+
+   for (GLuint i = 0; i < TEXTURE_LAST; ++i)
+      forget_texture(context->textures[i]);
+
    GL_CALL(glDeleteTextures(TEXTURE_LAST, context->textures));
+   GL_CALL(glDeleteBuffers(1, &context->batch.vbo));
    GL_CALL(glDeleteFramebuffers(1, &context->clear_fbo));
+   free(context->params.filter);
    free(context);
 }
 
@@ -898,6 +1287,7 @@ wlc_gles2(struct wlc_render_api *api)
    api->terminate = terminate;
    api->resolution = resolution;
    api->surface_destroy = surface_destroy;
+   api->buffer_query = buffer_query;
    api->surface_attach = surface_attach;
    api->view_paint = view_paint;
    api->surface_paint = surface_paint;
@@ -906,6 +1296,11 @@ wlc_gles2(struct wlc_render_api *api)
    api->write_pixels = write_pixels;
    api->flush_fakefb = flush_fakefb;
    api->clear = clear;
+   api->scissor = scissor;
+   api->flush = flush;
+   api->timer_begin = timer_begin;
+   api->timer_end = timer_end;
+   api->timer_result = timer_result;
 
    chck_cstr_to_bool(getenv("WLC_DRAW_OPAQUE"), &DRAW_OPAQUE);
    chck_cstr_to_bool(getenv("WLC_DRAW_INPUT"), &DRAW_INPUT);
@@ -0,0 +1,468 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <pixman.h>
+#include <wayland-server.h>
+#include <chck/math/math.h>
+#include "internal.h"
+#include "pixman.h"
+#include "render.h"
+#include "compositor/view.h"
+#include "xwayland/xwm.h"
+#include "resources/types/surface.h"
+#include "resources/types/buffer.h"
+
+// Software renderer for outputs rendered by CPU into memory (see platform/context/memory.c).
+// Client SHM buffers are composited straight from their pool, pixman picks SIMD paths for us.
+
+#define CURSOR_SIZE 14
+
+static const uint8_t cursor_palette[];
+
+struct ctx {
+   pixman_image_t *framebuffer;
+   pixman_image_t *cursor;
+   uint32_t cursor_pixels[CURSOR_SIZE * CURSOR_SIZE];
+   struct wlc_size resolution, mode;
+};
+
+// Stored in images[0] of surface, wraps the client buffer without copying
+struct surface_image {
+   pixman_image_t *image;
+   wlc_resource buffer;
+};
+
+static void
+to_mode_box(struct ctx *context, const struct wlc_geometry *g, pixman_box32_t *out_box)
+{
+   assert(context && g && out_box);
+
+   // geometry is in virtual resolution, framebuffer is in mode pixels
+   const float sx = (float)context->mode.w / chck_maxu32(context->resolution.w, 1);
+   const float sy = (float)context->mode.h / chck_maxu32(context->resolution.h, 1);
+   out_box->x1 = floor(g->origin.x * sx);
+   out_box->y1 = floor(g->origin.y * sy);
+   out_box->x2 = ceil((g->origin.x + (int32_t)g->size.w) * sx);
+   out_box->y2 = ceil((g->origin.y + (int32_t)g->size.h) * sy);
+}
+
+static void
+composite(struct ctx *context, pixman_op_t op, pixman_image_t *image, const struct wlc_geometry *geometry)
+{
+   assert(context && image && geometry);
+
+   pixman_box32_t box;
+   to_mode_box(context, geometry, &box);
+   const int32_t w = box.x2 - box.x1, h = box.y2 - box.y1;
+
+   if (w <= 0 || h <= 0)
+      return;
+
+   const int32_t iw = pixman_image_get_width(image), ih = pixman_image_get_height(image);
+   if (iw == w && ih == h) {
+      pixman_image_set_transform(image, NULL);
+      pixman_image_set_filter(image, PIXMAN_FILTER_NEAREST, NULL, 0);
+      pixman_image_set_repeat(image, PIXMAN_REPEAT_NONE);
+   } else {
+      pixman_transform_t transform;
+      pixman_transform_init_scale(&transform, pixman_double_to_fixed((double)iw / w), pixman_double_to_fixed((double)ih / h));
+      pixman_image_set_transform(image, &transform);
+      pixman_image_set_filter(image, PIXMAN_FILTER_BILINEAR, NULL, 0);
+      // filtering must not blend with nothing at the edges
+      pixman_image_set_repeat(image, PIXMAN_REPEAT_PAD);
+   }
+
+   pixman_image_composite32(op, image, NULL, context->framebuffer, 0, 0, 0, 0, box.x1, box.y1, w, h);
+}
+
+static void
+fill(struct ctx *context, const pixman_color_t *color, const struct wlc_geometry *geometry)
+{
+   assert(context && color && geometry);
+
+   pixman_box32_t box;
+   to_mode_box(context, geometry, &box);
+
+   if (box.x2 <= box.x1 || box.y2 <= box.y1)
+      return;
+
+   pixman_image_fill_boxes(PIXMAN_OP_SRC, context->framebuffer, color, 1, &box);
+}
+
+static void
+resolution(struct ctx *context, const struct wlc_size *mode, const struct wlc_size *resolution, uint32_t scale)
+{
+   (void)scale;
+   assert(context && mode && resolution && scale > 0);
+
+   context->resolution = *resolution;
+
+   if (context->framebuffer && wlc_size_equals(&context->mode, mode))
+      return;
+
+   pixman_image_t *framebuffer;
+   if (!(framebuffer = pixman_image_create_bits(PIXMAN_x8r8g8b8, mode->w, mode->h, NULL, 0))) {
+      wlc_log(WLC_LOG_WARN, "Failed to allocate %ux%u framebuffer", mode->w, mode->h);
+      return;
+   }
+
+   if (context->framebuffer)
+      pixman_image_unref(context->framebuffer);
+
+   context->framebuffer = framebuffer;
+   context->mode = *mode;
+}
+
+static void
+surface_destroy(struct ctx *context, struct wlc_context *bound, struct wlc_surface *surface)
+{
+   (void)context, (void)bound;
+   assert(context && bound && surface);
+
+   struct surface_image *si;
+   if ((si = surface->images[0])) {
+      if (si->image)
+         pixman_image_unref(si->image);
+      free(si);
+   }
+
+   memset(surface->images, 0, sizeof(surface->images));
+   memset(&surface->storage, 0, sizeof(surface->storage));
+   wlc_dlog(WLC_DBG_RENDER, "-> Destroyed surface");
+}
+
+static bool
+buffer_query(struct ctx *context, struct wlc_context *bound, struct wlc_buffer *buffer)
+{
+   (void)context, (void)bound;
+   assert(context && bound && buffer);
+
+   struct wl_resource *wl_buffer;
+   if (!(wl_buffer = convert_to_wl_resource(buffer, WLC_TYPE_BUFFER)))
+      return false;
+
+   struct wl_shm_buffer *shm_buffer;
+   if (!(shm_buffer = wl_shm_buffer_get(wl_buffer))) {
+      /* no EGL, so only shm buffers are understood */
+      wlc_log(WLC_LOG_WARN, "Unknown buffer");
+      return false;
+   }
+
+   buffer->shm_buffer = shm_buffer;
+   buffer->size.w = wl_shm_buffer_get_width(shm_buffer);
+   buffer->size.h = wl_shm_buffer_get_height(shm_buffer);
+   return true;
+}
+
+static bool
+shm_attach(struct surface_image *si, struct wlc_surface *surface, struct wlc_buffer *buffer)
+{
+   assert(si && surface && buffer && buffer->shm_buffer);
+
+   pixman_format_code_t format;
+   switch (wl_shm_buffer_get_format(buffer->shm_buffer)) {
+      case WL_SHM_FORMAT_XRGB8888:
+         format = PIXMAN_x8r8g8b8;
+         surface->format = SURFACE_RGB;
+         break;
+      case WL_SHM_FORMAT_ARGB8888:
+         format = PIXMAN_a8r8g8b8;
+         surface->format = SURFACE_RGBA;
+         break;
+      case WL_SHM_FORMAT_RGB565:
+         format = PIXMAN_r5g6b5;
+         surface->format = SURFACE_RGB;
+         break;
+      default:
+         /* unknown shm buffer format */
+         return false;
+   }
+
+   struct wlc_view *view;
+   if ((view = convert_from_wlc_handle(surface->view, WLC_TYPE_VIEW)) && is_x11_view(view))
+      wlc_x11_window_set_surface_format(surface, &view->x11);
+
+   // No upload, pixels are read from the pool when painted.
+   // Committed buffer is not released before next commit, which attaches again.
+   pixman_image_t *image;
+   if (!(image = pixman_image_create_bits(format, buffer->size.w, buffer->size.h, wl_shm_buffer_get_data(buffer->shm_buffer), wl_shm_buffer_get_stride(buffer->shm_buffer))))
+      return false;
+
+   if (si->image)
+      pixman_image_unref(si->image);
+
+   si->image = image;
+   si->buffer = convert_to_wlc_resource(buffer);
+   surface->storage.size = buffer->size;
+   surface->storage.format = format;
+   return true;
+}
+
+static bool
+surface_attach(struct ctx *context, struct wlc_context *bound, struct wlc_surface *surface, struct wlc_buffer *buffer)
+{
+   assert(context && bound && surface);
+
+   if (!buffer || !convert_to_wl_resource(buffer, WLC_TYPE_BUFFER)) {
+      surface_destroy(context, bound, surface);
+      return true;
+   }
+
+   if (!buffer_query(context, bound, buffer))
+      return false;
+
+   if (!surface->images[0] && !(surface->images[0] = calloc(1, sizeof(struct surface_image))))
+      return false;
+
+   if (!shm_attach(surface->images[0], surface, buffer))
+      return false;
+
+   wlc_dlog(WLC_DBG_RENDER, "-> Attached surface (%" PRIuWLC ") with buffer of size (%ux%u)", convert_to_wlc_resource(surface), buffer->size.w, buffer->size.h);
+   return true;
+}
+
+static void
+surface_paint_internal(struct ctx *context, struct wlc_surface *surface, const struct wlc_geometry *geometry, const struct wlc_geometry *visible)
+{
+   assert(context && surface && geometry && visible);
+
+   struct surface_image *si;
+   if (!context->framebuffer || !(si = surface->images[0]) || !si->image)
+      return;
+
+   // client may have destroyed the buffer since, its memory is gone then
+   struct wlc_buffer *buffer;
+   if (!(buffer = convert_from_wlc_resource(si->buffer, WLC_TYPE_BUFFER)) || !buffer->shm_buffer)
+      return;
+
+   const struct wlc_geometry *g = geometry;
+   if (!wlc_size_equals(&surface->size, &geometry->size) && !wlc_geometry_equals(visible, geometry)) {
+      // black borders are requested
+      fill(context, &(pixman_color_t){ 0, 0, 0, 0xffff }, geometry);
+      g = visible;
+   }
+
+   wl_shm_buffer_begin_access(buffer->shm_buffer);
+   composite(context, (surface->format == SURFACE_RGB ? PIXMAN_OP_SRC : PIXMAN_OP_OVER), si->image, g);
+   wl_shm_buffer_end_access(buffer->shm_buffer);
+}
+
+static void
+surface_paint(struct ctx *context, struct wlc_surface *surface, const struct wlc_geometry *geometry)
+{
+   surface_paint_internal(context, surface, geometry, geometry);
+}
+
+static void
+view_paint(struct ctx *context, struct wlc_view *view)
+{
+   assert(context && view);
+
+   struct wlc_surface *surface;
+   if (!(surface = convert_from_wlc_resource(view->surface, WLC_TYPE_SURFACE)))
+      return;
+
+   struct wlc_geometry geometry, visible;
+   wlc_view_get_bounds(view, &geometry, &visible);
+   surface_paint_internal(context, surface, &geometry, &visible);
+}
+
+static void
+pointer_paint(struct ctx *context, const struct wlc_point *pos)
+{
+   assert(context && pos);
+
+   if (!context->framebuffer)
+      return;
+
+   struct wlc_geometry g = { *pos, { CURSOR_SIZE, CURSOR_SIZE } };
+   composite(context, PIXMAN_OP_OVER, context->cursor, &g);
+}
+
+static void
+clamp_to_bounds(struct wlc_geometry *g, const struct wlc_size *bounds)
+{
+   assert(g);
+
+   if (g->origin.x < 0) {
+      g->size.w = ((int32_t)g->size.w + g->origin.x > 0 ? g->size.w + g->origin.x : 0);
+      g->origin.x = 0;
+   } else if ((uint32_t)g->origin.x > bounds->w) {
+      g->origin.x = bounds->w;
+   }
+
+   if (g->origin.y < 0) {
+      g->size.h = ((int32_t)g->size.h + g->origin.y > 0 ? g->size.h + g->origin.y : 0);
+      g->origin.y = 0;
+   } else if ((uint32_t)g->origin.y > bounds->h) {
+      g->origin.y = bounds->h;
+   }
+
+   if (g->origin.x + g->size.w > bounds->w)
+      g->size.w = bounds->w - g->origin.x;
+
+   if (g->origin.y + g->size.h > bounds->h)
+      g->size.h = bounds->h - g->origin.y;
+}
+
+static void
+read_pixels(struct ctx *context, enum wlc_pixel_format format, const struct wlc_geometry *geometry, struct wlc_geometry *out_geometry, void *out_data)
+{
+   (void)format;
+   assert(context && geometry && out_geometry && out_data);
+
+   struct wlc_geometry g = *geometry;
+   clamp_to_bounds(&g, &context->mode);
+   *out_geometry = g;
+
+   if (!context->framebuffer || !g.size.w || !g.size.h)
+      return;
+
+   // WLC_RGBA8888 is byte order, which is a8b8g8r8 for pixman on little endian
+   pixman_image_t *dst;
+   if (!(dst = pixman_image_create_bits(PIXMAN_a8b8g8r8, g.size.w, g.size.h, out_data, g.size.w * 4)))
+      return;
+
+   // rows are bottom up, same as glReadPixels gives them with GLES2 renderer
+   for (uint32_t y = 0; y < g.size.h; ++y)
+      pixman_image_composite32(PIXMAN_OP_SRC, context->framebuffer, NULL, dst, g.origin.x, g.origin.y + y, 0, 0, 0, g.size.h - 1 - y, g.size.w, 1);
+
+   pixman_image_unref(dst);
+}
+
+static void
+write_pixels(struct ctx *context, enum wlc_pixel_format format, const struct wlc_geometry *geometry, const void *data)
+{
+   (void)format;
+   assert(context && geometry && data);
+
+   struct wlc_geometry g = *geometry;
+   clamp_to_bounds(&g, &context->resolution);
+
+   if (!context->framebuffer || !g.size.w || !g.size.h)
+      return;
+
+   // Source rows keep stride of the unclamped geometry
+   const uint32_t stride = geometry->size.w * 4;
+   const uint8_t *pixels = (const uint8_t*)data + (g.origin.y - geometry->origin.y) * stride + (g.origin.x - geometry->origin.x) * 4;
+
+   pixman_image_t *src;
+   if (!(src = pixman_image_create_bits(PIXMAN_a8b8g8r8, g.size.w, g.size.h, (uint32_t*)pixels, stride)))
+      return;
+
+   // there is no separate fake framebuffer, pixels are blended in place
+   composite(context, PIXMAN_OP_OVER, src, &g);
+   pixman_image_unref(src);
+}
+
+static void
+clear(struct ctx *context)
+{
+   assert(context);
+
+   if (!context->framebuffer)
+      return;
+
+   fill(context, &(pixman_color_t){ 0, 0, 0, 0 }, &(struct wlc_geometry){ .origin = { 0, 0 }, .size = context->resolution });
+}
+
+static void
+scissor(struct ctx *context, const struct wlc_geometry *geometry)
+{
+   assert(context);
+
+   if (!context->framebuffer)
+      return;
+
+   if (!geometry) {
+      pixman_image_set_clip_region32(context->framebuffer, NULL);
+      return;
+   }
+
+   pixman_box32_t box;
+   to_mode_box(context, geometry, &box);
+
+   pixman_region32_t clip;
+   pixman_region32_init_rects(&clip, &box, 1);
+   pixman_image_set_clip_region32(context->framebuffer, &clip);
+   pixman_region32_fini(&clip);
+}
+
+static void
+terminate(struct ctx *context)
+{
+   assert(context);
+
+   if (context->framebuffer)
+      pixman_image_unref(context->framebuffer);
+
+   if (context->cursor)
+      pixman_image_unref(context->cursor);
+
+   free(context);
+}
+
+static struct ctx*
+create_context(void)
+{
+   struct ctx *context;
+   if (!(context = calloc(1, sizeof(struct ctx))))
+      return NULL;
+
+   // 0 == black, 1 == white, 2 == transparent
+   static const uint32_t colors[] = { 0xff000000, 0xffffffff, 0x00000000 };
+   for (uint32_t i = 0; i < CURSOR_SIZE * CURSOR_SIZE; ++i)
+      context->cursor_pixels[i] = colors[cursor_palette[i]];
+
+   if (!(context->cursor = pixman_image_create_bits(PIXMAN_a8r8g8b8, CURSOR_SIZE, CURSOR_SIZE, context->cursor_pixels, CURSOR_SIZE * 4))) {
+      free(context);
+      return NULL;
+   }
+
+   return context;
+}
+
+void*
+wlc_pixman(struct wlc_render_api *api)
+{
+   assert(api);
+
+   struct ctx *ctx;
+   if (!(ctx = create_context()))
+      return NULL;
+
+   api->renderer_type = WLC_RENDERER_PIXMAN;
+   api->terminate = terminate;
+   api->resolution = resolution;
+   api->surface_destroy = surface_destroy;
+   api->buffer_query = buffer_query;
+   api->surface_attach = surface_attach;
+   api->view_paint = view_paint;
+   api->surface_paint = surface_paint;
+   api->pointer_paint = pointer_paint;
+   api->read_pixels = read_pixels;
+   api->write_pixels = write_pixels;
+   api->clear = clear;
+   api->scissor = scissor;
+
+   wlc_log(WLC_LOG_INFO, "Pixman renderer initialized");
+   return ctx;
+}
+
+static const uint8_t cursor_palette[] = {
+   0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x02,
+   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
+   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
+   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
+   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
+   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02,
+   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02,
+   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+   0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02,
+   0x01, 0x00, 0x01, 0x02, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02,
+   0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0x01, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
+   0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x01, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
+   0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02
+};
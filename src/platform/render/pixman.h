@@ -0,0 +1,8 @@
+#ifndef _WLC_PIXMAN_H_
+#define _WLC_PIXMAN_H_
+
+struct wlc_render_api;
+
+void* wlc_pixman(struct wlc_render_api *api);
+
+#endif /* _WLC_PIXMAN_H_ */
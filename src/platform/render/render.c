@@ -4,6 +4,7 @@
 #include "platform/context/context.h"
 #include "render.h"
 #include "gles2.h"
+#include "pixman.h"
 
 void
 wlc_render_resolution(struct wlc_render *render, struct wlc_context *bound, const struct wlc_size *mode, const struct wlc_size *resolution, uint32_t scale)
@@ -27,6 +28,17 @@ wlc_render_surface_destroy(struct wlc_render *render, struct wlc_context *bound,
    render->api.surface_destroy(render->render, bound, surface);
 }
 
+bool
+wlc_render_buffer_query(struct wlc_render *render, struct wlc_context *bound, struct wlc_buffer *buffer)
+{
+   assert(render && bound && buffer);
+
+   if (!render->api.buffer_query || !wlc_context_bind(bound))
+      return false;
+
+   return render->api.buffer_query(render->render, bound, buffer);
+}
+
 bool
 wlc_render_surface_attach(struct wlc_render *render, struct wlc_context *bound, struct wlc_surface *surface, struct wlc_buffer *buffer)
 {
@@ -115,6 +127,61 @@ wlc_render_clear(struct wlc_render *render, struct wlc_context *bound)
    render->api.clear(render->render);
 }
 
+void
+wlc_render_scissor(struct wlc_render *render, struct wlc_context *bound, const struct wlc_geometry *geometry)
+{
+   assert(render);
+
+   if (!render->api.scissor || !wlc_context_bind(bound))
+      return;
+
+   render->api.scissor(render->render, geometry);
+}
+
+void
+wlc_render_flush(struct wlc_render *render, struct wlc_context *bound)
+{
+   assert(render);
+
+   if (!render->api.flush || !wlc_context_bind(bound))
+      return;
+
+   render->api.flush(render->render);
+}
+
+void
+wlc_render_timer_begin(struct wlc_render *render, struct wlc_context *bound)
+{
+   assert(render);
+
+   if (!render->api.timer_begin || !wlc_context_bind(bound))
+      return;
+
+   render->api.timer_begin(render->render, bound);
+}
+
+void
+wlc_render_timer_end(struct wlc_render *render, struct wlc_context *bound)
+{
+   assert(render);
+
+   if (!render->api.timer_end || !wlc_context_bind(bound))
+      return;
+
+   render->api.timer_end(render->render);
+}
+
+bool
+wlc_render_timer_result(struct wlc_render *render, struct wlc_context *bound, uint64_t *out_ns)
+{
+   assert(render && out_ns);
+
+   if (!render->api.timer_result || !wlc_context_bind(bound))
+      return false;
+
+   return render->api.timer_result(render->render, out_ns);
+}
+
 void
 wlc_render_release(struct wlc_render *render, struct wlc_context *bound)
 {
@@ -139,13 +206,19 @@ wlc_render(struct wlc_render *render, struct wlc_context *context)
    if (!wlc_context_bind(context))
       return NULL;
 
-   void* (*constructor[])(struct wlc_render_api*) = {
-      wlc_gles2,
-      NULL
+   static const struct {
+      void* (*constructor)(struct wlc_render_api*);
+      enum wlc_context_type context_type;
+   } renderers[] = {
+      { wlc_gles2, WLC_CONTEXT_EGL },
+      { wlc_pixman, WLC_CONTEXT_MEMORY },
    };
 
-   for (uint32_t i = 0; constructor[i]; ++i) {
-      if ((render->render = constructor[i](&render->api)))
+   for (uint32_t i = 0; i < LENGTH(renderers); ++i) {
+      if (renderers[i].context_type != context->api.context_type)
+         continue;
+
+      if ((render->render = renderers[i].constructor(&render->api)))
          return true;
    }
 
@@ -21,6 +21,7 @@ struct wlc_render_api {
    WLC_NONULL void (*terminate)(struct ctx *render);
    WLC_NONULL void (*resolution)(struct ctx *render, const struct wlc_size *mode, const struct wlc_size *resolution, uint32_t scale);
    WLC_NONULL void (*surface_destroy)(struct ctx *render, struct wlc_context *bound, struct wlc_surface *surface);
+   WLC_NONULL bool (*buffer_query)(struct ctx *render, struct wlc_context *bound, struct wlc_buffer *buffer);
    WLC_NONULLV(1,2,3) bool (*surface_attach)(struct ctx *render, struct wlc_context *bound, struct wlc_surface *surface, struct wlc_buffer *buffer);
    WLC_NONULL void (*view_paint)(struct ctx *render, struct wlc_view *view);
    WLC_NONULL void (*surface_paint)(struct ctx *render, struct wlc_surface *surface, const struct wlc_geometry *geometry);
@@ -29,6 +30,13 @@ struct wlc_render_api {
    WLC_NONULL void (*write_pixels)(struct ctx *render, enum wlc_pixel_format format, const struct wlc_geometry *geometry, const void *data);
    WLC_NONULL void (*flush_fakefb)(struct ctx *render);
    WLC_NONULL void (*clear)(struct ctx *render);
+   WLC_NONULLV(1) void (*scissor)(struct ctx *render, const struct wlc_geometry *geometry);
+   WLC_NONULL void (*flush)(struct ctx *render);
+
+   // Optional GPU timing of frames, results are collected later so nothing stalls on them
+   WLC_NONULL void (*timer_begin)(struct ctx *render, struct wlc_context *bound);
+   WLC_NONULL void (*timer_end)(struct ctx *render);
+   WLC_NONULL bool (*timer_result)(struct ctx *render, uint64_t *out_ns);
 };
 
 struct wlc_render {
@@ -38,6 +46,7 @@ struct wlc_render {
 
 WLC_NONULL void wlc_render_resolution(struct wlc_render *render, struct wlc_context *bound, const struct wlc_size *mode, const struct wlc_size *resolution, uint32_t scale);
 WLC_NONULL void wlc_render_surface_destroy(struct wlc_render *render, struct wlc_context *bound, struct wlc_surface *surface);
+WLC_NONULL bool wlc_render_buffer_query(struct wlc_render *render, struct wlc_context *bound, struct wlc_buffer *buffer);
 WLC_NONULLV(1,2,3) bool wlc_render_surface_attach(struct wlc_render *render, struct wlc_context *bound, struct wlc_surface *surface, struct wlc_buffer *buffer);
 WLC_NONULL void wlc_render_view_paint(struct wlc_render *render, struct wlc_context *bound, struct wlc_view *view);
 WLC_NONULL void wlc_render_surface_paint(struct wlc_render *render, struct wlc_context *bound, struct wlc_surface *surface, const struct wlc_geometry *geometry);
@@ -46,6 +55,11 @@ WLC_NONULL void wlc_render_read_pixels(struct wlc_render *render, struct wlc_con
 WLC_NONULL void wlc_render_write_pixels(struct wlc_render *render, struct wlc_context *bound, enum wlc_pixel_format format, const struct wlc_geometry *geometry, const void *data);
 WLC_NONULL void wlc_render_flush_fakefb(struct wlc_render *render, struct wlc_context *bound); // only relevant to GLES2
 WLC_NONULL void wlc_render_clear(struct wlc_render *render, struct wlc_context *bound);
+WLC_NONULLV(1,2) void wlc_render_scissor(struct wlc_render *render, struct wlc_context *bound, const struct wlc_geometry *geometry); // NULL geometry disables
+WLC_NONULL void wlc_render_flush(struct wlc_render *render, struct wlc_context *bound); // submit queued draws, forget cached state
+WLC_NONULL void wlc_render_timer_begin(struct wlc_render *render, struct wlc_context *bound);
+WLC_NONULL void wlc_render_timer_end(struct wlc_render *render, struct wlc_context *bound);
+WLC_NONULL bool wlc_render_timer_result(struct wlc_render *render, struct wlc_context *bound, uint64_t *out_ns); // false if nothing new completed
 void wlc_render_release(struct wlc_render *render, struct wlc_context *context);
 WLC_NONULL bool wlc_render(struct wlc_render *render, struct wlc_context *context);
 
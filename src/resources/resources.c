@@ -5,6 +5,7 @@
 #include "internal.h"
 #include "macros.h"
 #include "resources.h"
+#include "trace.h"
 
 #undef wl_resource_from_wlc_resource
 #undef convert_from_wl_resource
@@ -15,6 +16,8 @@ struct handle {
    wlc_resource public; // points to either to this struct handle or struct resource
    wlc_resource private; // the actual type under types/ folder
    struct wlc_source *source; // source this handle exists in
+   enum wlc_type type; // type of the source, kept here so type checks don't touch the source
+   struct wl_list link; // in handles or resources list of source
 };
 
 /**
@@ -39,92 +42,131 @@ struct handle_info {
    wlc_resource public, private;
 };
 
-struct chck_pool resources;
-struct chck_pool handles;
+/**
+ * Handles are slot index + 1 in the low bits and generation of the slot in the high bits.
+ * Generation is bumped when slot is released, so stale handles don't alias whatever reuses the slot.
+ */
+#define INDEX_BITS 24
+#define INDEX_MASK (((wlc_handle)1 << INDEX_BITS) - 1)
+#define GENERATION_MASK (sizeof(wlc_handle) > 4 ? 0xFFFFFFFF : 0xFF)
+
+struct generations {
+   uint32_t *slots;
+   size_t size;
+};
 
-static void
-relocate_handle(struct handle *handle, void *dest, const void *start, const void *end)
-{
-   assert(handle && dest && start && end);
+static const char *type_names[WLC_TYPE_LAST] = {
+   [WLC_TYPE_NONE] = "none",
+   [WLC_TYPE_OUTPUT] = "output",
+   [WLC_TYPE_VIEW] = "view",
+   [WLC_TYPE_SURFACE] = "surface",
+   [WLC_TYPE_SUBSURFACE] = "subsurface",
+   [WLC_TYPE_REGION] = "region",
+   [WLC_TYPE_BUFFER] = "buffer",
+   [WLC_TYPE_CALLBACK] = "callback",
+   [WLC_TYPE_POINTER] = "pointer",
+   [WLC_TYPE_KEYBOARD] = "keyboard",
+   [WLC_TYPE_TOUCH] = "touch",
+   [WLC_TYPE_DATA_SOURCE] = "data-source",
+   [WLC_TYPE_DATA_DEVICE] = "data-device",
+   [WLC_TYPE_DATA_OFFER] = "data-offer",
+   [WLC_TYPE_SHELL_SURFACE] = "shell-surface",
+   [WLC_TYPE_CUSTOM_SURFACE] = "custom-surface",
+   [WLC_TYPE_XDG_SURFACE] = "xdg-surface",
+   [WLC_TYPE_XDG_TOPLEVEL] = "xdg-toplevel",
+   [WLC_TYPE_XDG_POPUP] = "xdg-popup",
+   [WLC_TYPE_XDG_POSITIONER] = "xdg-positioner",
+   [WLC_TYPE_PRESENTATION_FEEDBACK] = "presentation-feedback",
+};
 
-   if ((char*)handle->source < (char*)start || (char*)handle->source > (char*)end)
-      return;
+static struct wlc_slab resources;
+static struct wlc_slab handles;
 
-   handle->source = (void*)((char*)dest + ((char*)handle->source - (char*)start));
+static struct generations resource_generations;
+static struct generations handle_generations;
+
+static struct generations*
+generations_for_pool(struct wlc_slab *pool)
+{
+   assert(pool == &handles || pool == &resources);
+   return (pool == &handles ? &handle_generations : &resource_generations);
 }
 
-static void
-relocate_handles(struct chck_pool *pool, void *dest, const void *start, const void *end)
+static bool
+generations_reserve(struct generations *generations, size_t index)
 {
-   // worst case scenario
-   // when source pool address changes on resize, we need to make sure all inner sources
-   // are relocated to avoid access to garbage location.
+   assert(generations);
 
-   assert(dest && end);
+   if (index < generations->size)
+      return true;
 
-   if (!start)
-      return;
+   const size_t size = (index + 1 > generations->size * 2 ? index + 1 : generations->size * 2);
 
-   wlc_dlog(WLC_DBG_HANDLE, "Relocating %s at range %p-%p to %p", (pool == &handles ? "handles" : "resources"), start, end, dest);
+   uint32_t *slots;
+   if (!(slots = realloc(generations->slots, size * sizeof(uint32_t))))
+      return false;
 
-   if (pool == &resources) {
-      struct resource *r;
-      chck_pool_for_each(pool, r)
-         relocate_handle(&r->handle, dest, start, end);
-   } else {
-      chck_pool_for_each_call(pool, relocate_handle, dest, start, end);
-   }
+   memset(slots + generations->size, 0, (size - generations->size) * sizeof(uint32_t));
+   generations->slots = slots;
+   generations->size = size;
+   return true;
 }
 
 static void
-relocate_resources(struct chck_pool *pool)
+generations_release(struct generations *generations)
 {
-   // worst case scenario
-   // when resrouce container pool address changes, we need to reset all destructors again
+   assert(generations);
+   free(generations->slots);
+   memset(generations, 0, sizeof(struct generations));
+}
 
-   wlc_dlog(WLC_DBG_HANDLE, "Relocating resources");
+WLC_PURE static inline size_t
+handle_index(wlc_handle handle)
+{
+   return (handle & INDEX_MASK) - 1;
+}
 
-   struct resource *r;
-   chck_pool_for_each(pool, r) {
-      if (!r->wl.r)
-         continue;
+/** Slot for handle, if the handle is still alive. */
+static void*
+slot_for_handle(struct wlc_slab *pool, wlc_handle handle)
+{
+   assert(pool);
 
-      wl_list_remove(&r->wl.destructor.link);
-      wl_resource_add_destroy_listener(r->wl.r, &r->wl.destructor);
-   }
+   if (!handle || !(handle & INDEX_MASK))
+      return NULL;
+
+   const struct generations *generations = generations_for_pool(pool);
+   const size_t index = handle_index(handle);
+   if (index >= generations->size || generations->slots[index] != (handle >> INDEX_BITS))
+      return NULL;
+
+   return wlc_slab_get(pool, index);
 }
 
 static bool
-handle_create(struct chck_pool *pool, struct wlc_source *source, struct handle_info *out_info)
+handle_create(struct wlc_slab *pool, struct wlc_source *source, struct handle_info *out_info)
 {
    assert(pool && source && out_info);
 
+   // slabs never move items, so pointers to sources and wl_listeners stay valid when storage grows
    size_t i;
    void *c;
-   uint8_t *original = pool->items.buffer;
-   if (!(c = chck_pool_add(pool, NULL, &i)))
+   if (!(c = wlc_slab_add(pool, &i)))
       return false;
 
-   if (pool == &resources && original != pool->items.buffer)
-      relocate_resources(pool);
-
    size_t h;
    uint8_t *v;
-   original = source->pool.items.buffer;
-   if (!(v = chck_pool_add(&source->pool, NULL, &h)))
+   if (!(v = wlc_slab_add(&source->pool, &h)))
       goto error0;
 
-   if (original != source->pool.items.buffer)
-      relocate_handles(pool, source->pool.items.buffer, original, original + source->pool.items.allocated);
-
-   if (i >= (wlc_resource)~0 || h >= (wlc_resource)~0)
+   if (i + 1 > INDEX_MASK || !generations_reserve(generations_for_pool(pool), i))
       goto error1;
 
    out_info->container = c;
    out_info->data = v;
-   out_info->public = i + 1;
+   out_info->public = ((wlc_handle)generations_for_pool(pool)->slots[i] << INDEX_BITS) | (i + 1);
    out_info->private = h + 1;
-   memcpy(v + source->pool.items.member - sizeof(wlc_handle), &out_info->public, sizeof(wlc_handle));
+   memcpy(v + source->pool.member - sizeof(wlc_handle), &out_info->public, sizeof(wlc_handle));
 
    if (source->constructor) {
       wlc_dlog(WLC_DBG_HANDLE, "=> Calling constructor for (%s) %" PRIuWLC, source->name, out_info->public);
@@ -135,18 +177,19 @@ handle_create(struct chck_pool *pool, struct wlc_source *source, struct handle_i
          goto error1;
    }
 
-   wlc_dlog(WLC_DBG_HANDLE, "New %s (%s) %" PRIuWLC, (pool == &handles ? "handle" : "resource"), source->name, i + 1);
+   wlc_dlog(WLC_DBG_HANDLE, "New %s (%s) %" PRIuWLC, (pool == &handles ? "handle" : "resource"), source->name, out_info->public);
+   wlc_trace(WLC_TRACE_HANDLE_NEW, 0, out_info->public, 0);
    return true;
 
 error1:
-   chck_pool_remove(&source->pool, h);
+   wlc_slab_remove(&source->pool, h);
 error0:
-   chck_pool_remove(pool, i);
+   wlc_slab_remove(pool, i);
    return false;
 }
 
 static void
-handle_release(struct chck_pool *pool, struct handle *handle, void (*preremove)())
+handle_release(struct wlc_slab *pool, struct handle *handle, void (*preremove)())
 {
    assert(pool);
 
@@ -155,65 +198,55 @@ handle_release(struct chck_pool *pool, struct handle *handle, void (*preremove)(
 
    if (handle->private) {
       void *v;
-      if (handle->source->destructor && (v = chck_pool_get(&handle->source->pool, handle->private - 1))) {
+      if (handle->source->destructor && (v = wlc_slab_get(&handle->source->pool, handle->private - 1))) {
+         // destructor may release other handles, but it can't move this one
          wlc_dlog(WLC_DBG_HANDLE, "=> Calling destructor for (%s) %" PRIuWLC, handle->source->name, handle->public);
-
-         // destructor may trigger destruction of other handles
-         // that may then cause relocation of the containing pool
-         // keep track of the address and relocate our handle after.
-         uint8_t *original = pool->items.buffer;
          handle->source->destructor(v);
-
-         if (pool->items.buffer != original) {
-            wlc_dlog(WLC_DBG_HANDLE, "Pool got relocated after calling destructor. Relocating handle...");
-            handle = (struct handle*)(pool->items.buffer + ((uint8_t*)handle - original));
-         }
-
          wlc_dlog(WLC_DBG_HANDLE, "<= Called destructor for (%s) %" PRIuWLC, handle->source->name, handle->public);
       }
 
-      uint8_t *original = handle->source->pool.items.buffer;
-      chck_pool_remove(&handle->source->pool, handle->private - 1);
-
-      if (original != handle->source->pool.items.buffer)
-         relocate_handles(pool, handle->source->pool.items.buffer, original, original + handle->source->pool.items.allocated);
+      wlc_slab_remove(&handle->source->pool, handle->private - 1);
    }
 
    // called right after removal of the container
    // used by resource handles to do final destruction of wayland resource
    if (preremove)
-      preremove(chck_pool_get(pool, handle->public - 1));
+      preremove(wlc_slab_get(pool, handle_index(handle->public)));
 
    wlc_dlog(WLC_DBG_HANDLE, "Released %s (%s) %" PRIuWLC, (pool == &handles ? "handle" : "resource"), handle->source->name, handle->public);
+   wlc_trace(WLC_TRACE_HANDLE_RELEASE, 0, handle->public, 0);
 
-   void *original = pool->items.buffer;
-   chck_pool_remove(pool, handle->public - 1);
+   wl_list_remove(&handle->link);
 
-   if (pool == &resources && original != pool->items.buffer)
-      relocate_resources(pool);
+   // no valid handle exists for the slot anymore
+   const size_t index = handle_index(handle->public);
+   struct generations *generations = generations_for_pool(pool);
+   generations->slots[index] = (generations->slots[index] + 1) & GENERATION_MASK;
+
+   wlc_slab_remove(pool, index);
 }
 
 WLC_PURE static bool
-handle_is(struct handle *handle, const char *name)
+handle_is(struct handle *handle, enum wlc_type type)
 {
-   assert(name);
-   return (handle ? chck_cstreq(handle->source->name, name) : false);
+   assert(type < WLC_TYPE_LAST);
+   return (handle ? handle->type == type : false);
 }
 
 static void*
-handle_get(struct handle *handle, const char *name, size_t line, const char *file, const char *function)
+handle_get(struct handle *handle, enum wlc_type type, size_t line, const char *file, const char *function)
 {
-   assert(name && file && function);
+   assert(file && function);
 
    if (!handle || !handle->private)
       return NULL;
 
-   if (!handle_is(handle, name)) {
-      wlc_log(WLC_LOG_WARN, "%s: %zu @ %s(): Tried to retrieve handle of wrong type (%s != %s)", file, line, function, handle->source->name, name);
+   if (!handle_is(handle, type)) {
+      wlc_log(WLC_LOG_WARN, "%s: %zu @ %s(): Tried to retrieve handle of wrong type (%s != %s)", file, line, function, handle->source->name, type_names[type]);
       return NULL;
    }
 
-   return chck_pool_get(&handle->source->pool, handle->private - 1);
+   return wlc_slab_get(&handle->source->pool, handle->private - 1);
 }
 
 WLC_PURE wlc_handle
@@ -265,53 +298,59 @@ resource_release(struct resource *resource)
 bool
 wlc_resources_init(void)
 {
-   return (chck_pool(&resources, 32, 0, sizeof(struct resource)) && chck_pool(&handles, 32, 0, sizeof(struct handle_public)));
+   return (wlc_slab(&resources, 256, sizeof(struct resource)) && wlc_slab(&handles, 256, sizeof(struct handle_public)));
 }
 
 void
 wlc_resources_terminate(void)
 {
-   chck_pool_for_each_call(&resources, wlc_resource_release_ptr);
-   chck_pool_for_each_call(&handles, wlc_handle_release_ptr);
-   chck_pool_release(&resources);
-   chck_pool_release(&handles);
+   struct resource *r;
+   wlc_slab_for_each(&resources, r)
+      resource_release(r);
+
+   wlc_slab_for_each_call(&handles, wlc_handle_release_ptr);
+   wlc_slab_release(&resources);
+   wlc_slab_release(&handles);
+   generations_release(&resource_generations);
+   generations_release(&handle_generations);
 }
 
 bool
-wlc_source(struct wlc_source *source, const char *name, bool (*constructor)(), void (*destructor)(), size_t grow, size_t member)
+wlc_source(struct wlc_source *source, enum wlc_type type, bool (*constructor)(), void (*destructor)(), size_t grow, size_t member)
 {
-   assert(source && name && grow);
+   assert(source && type < WLC_TYPE_LAST && grow);
    memset(source, 0, sizeof(struct wlc_source));
 
-   source->name = name;
+   source->name = type_names[type];
+   source->type = type;
    source->constructor = constructor;
    source->destructor = destructor;
-   return chck_pool(&source->pool, grow, 0, member + sizeof(wlc_handle));
+   wl_list_init(&source->handles);
+   wl_list_init(&source->resources);
+   return wlc_slab(&source->pool, grow, member + sizeof(wlc_handle));
 }
 
 void
 wlc_source_release(struct wlc_source *source)
 {
-   if (!source)
+   // source that was never initialized has no members
+   if (!source || !source->handles.next)
       return;
 
-   struct handle *h;
-   chck_pool_for_each(&handles, h) {
-      if (h->source != source)
-         continue;
-
+   // releasing member may release other members, so always take the first one left
+   while (!wl_list_empty(&source->handles)) {
+      struct handle *h;
+      except((h = wl_container_of(source->handles.next, h, link)));
       handle_release(&handles, h, NULL);
    }
 
-   struct resource *r;
-   chck_pool_for_each(&resources, r) {
-      if (r->handle.source != source)
-         continue;
-
+   while (!wl_list_empty(&source->resources)) {
+      struct resource *r;
+      except((r = wl_container_of(source->resources.next, r, handle.link)));
       resource_release(r);
    }
 
-   chck_pool_release(&source->pool);
+   wlc_slab_release(&source->pool);
 }
 
 void*
@@ -325,29 +364,24 @@ wlc_handle_create(struct wlc_source *source)
 
    struct handle *h = info.container;
    h->source = source;
+   h->type = source->type;
    h->public = info.public;
    h->private = info.private;
+   wl_list_insert(&source->handles, &h->link);
    return info.data;
 }
 
 void*
-convert_from_wlc_handle(wlc_handle handle, const char *name, size_t line, const char *file, const char *function)
+convert_from_wlc_handle(wlc_handle handle, enum wlc_type type, size_t line, const char *file, const char *function)
 {
-   assert(name && file && function);
-
-   if (!handle)
-      return NULL;
-
-   return handle_get(chck_pool_get(&handles, handle - 1), name, line, file, function);
+   assert(file && function);
+   return handle_get(slot_for_handle(&handles, handle), type, line, file, function);
 }
 
 void
 wlc_handle_release(wlc_handle handle)
 {
-   if (!handle)
-      return;
-
-   handle_release(&handles, chck_pool_get(&handles, handle - 1), NULL);
+   handle_release(&handles, slot_for_handle(&handles, handle), NULL);
 }
 
 struct wl_resource*
@@ -429,8 +463,10 @@ wlc_resource_create_from(struct wlc_source *source, struct wl_resource *resource
 
    struct resource *r = info.container;
    r->handle.source = source;
+   r->handle.type = source->type;
    r->handle.public = info.public;
    r->handle.private = info.private;
+   wl_list_insert(&source->resources, &r->handle.link);
    r->wl.r = resource;
    r->wl.destructor.notify = wl_destructor;
    wl_resource_add_destroy_listener(resource, &r->wl.destructor);
@@ -438,15 +474,12 @@ wlc_resource_create_from(struct wlc_source *source, struct wl_resource *resource
 }
 
 void*
-convert_from_wlc_resource(wlc_resource resource, const char *name, size_t line, const char *file, const char *function)
+convert_from_wlc_resource(wlc_resource resource, enum wlc_type type, size_t line, const char *file, const char *function)
 {
-   assert(name && file && function);
+   assert(file && function);
 
-   if (!resource)
-      return NULL;
-
-   struct resource *r = chck_pool_get(&resources, resource - 1);
-   return (r ? handle_get(&r->handle, name, line, file, function) : NULL);
+   struct resource *r = slot_for_handle(&resources, resource);
+   return (r ? handle_get(&r->handle, type, line, file, function) : NULL);
 }
 
 wlc_resource
@@ -467,22 +500,22 @@ wlc_resource_from_wl_resource(struct wl_resource *resource)
 }
 
 void*
-convert_from_wl_resource(struct wl_resource *resource, const char *name, size_t line, const char *file, const char *function)
+convert_from_wl_resource(struct wl_resource *resource, enum wlc_type type, size_t line, const char *file, const char *function)
 {
-   return convert_from_wlc_resource(wlc_resource_from_wl_resource(resource), name, line, file, function);
+   return convert_from_wlc_resource(wlc_resource_from_wl_resource(resource), type, line, file, function);
 }
 
 struct wl_resource*
-wl_resource_from_wlc_resource(wlc_resource resource, const char *name, size_t line, const char *file, const char *function)
+wl_resource_from_wlc_resource(wlc_resource resource, enum wlc_type type, size_t line, const char *file, const char *function)
 {
-   assert(name && file && function);
+   assert(file && function);
 
    struct resource *r;
-   if (!resource || !(r = chck_pool_get(&resources, resource - 1)))
+   if (!(r = slot_for_handle(&resources, resource)))
       return NULL;
 
-   if (!handle_is(&r->handle, name)) {
-      wlc_log(WLC_LOG_WARN, "%s: %zu @ %s(): Tried to retrieve resource of wrong type (%s != %s)", file, line, function, r->handle.source->name, name);
+   if (!handle_is(&r->handle, type)) {
+      wlc_log(WLC_LOG_WARN, "%s: %zu @ %s(): Tried to retrieve resource of wrong type (%s != %s)", file, line, function, r->handle.source->name, type_names[type]);
       return NULL;
    }
 
@@ -495,7 +528,7 @@ wl_resource_for_client(struct wlc_source *source, struct wl_client *client)
    assert(source && client);
 
    struct resource *r;
-   chck_pool_for_each(&resources, r) {
+   wlc_slab_for_each(&resources, r) {
       if (r->handle.source != source || wl_resource_get_client(r->wl.r) != client)
          continue;
 
@@ -508,26 +541,20 @@ wl_resource_for_client(struct wlc_source *source, struct wl_client *client)
 void
 wlc_resource_invalidate(wlc_resource resource)
 {
-   if (!resource)
-      return;
-
-   resource_invalidate(chck_pool_get(&resources, resource - 1));
+   resource_invalidate(slot_for_handle(&resources, resource));
 }
 
 void
 wlc_resource_release(wlc_resource resource)
 {
-   if (!resource)
-      return;
-
-   resource_release(chck_pool_get(&resources, resource - 1));
+   resource_release(slot_for_handle(&resources, resource));
 }
 
 void
 wlc_resource_implement(wlc_resource resource, const void *implementation, void *userdata)
 {
    struct resource *r;
-   if (!resource || !(r = chck_pool_get(&resources, resource - 1)))
+   if (!(r = slot_for_handle(&resources, resource)))
       return;
 
    wl_resource_set_implementation(r->wl.r, implementation, userdata, NULL);
@@ -537,7 +564,7 @@ WLC_API void
 wlc_handle_set_user_data(wlc_handle handle, const void *userdata)
 {
    struct handle_public *h;
-   if (!handle || !(h = chck_pool_get(&handles, handle - 1)))
+   if (!(h = slot_for_handle(&handles, handle)))
       return;
 
    h->userdata = (void*)userdata;
@@ -547,7 +574,7 @@ WLC_API WLC_PURE void*
 wlc_handle_get_user_data(wlc_handle handle)
 {
    const struct handle_public *h;
-   if (!handle || !(h = chck_pool_get(&handles, handle - 1)))
+   if (!(h = slot_for_handle(&handles, handle)))
       return NULL;
 
    return h->userdata;
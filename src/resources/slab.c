@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "slab.h"
+
+static bool
+add_chunk(struct wlc_slab *slab)
+{
+   assert(slab);
+
+   const size_t step = (size_t)1 << slab->shift;
+   const size_t slots = (slab->chunks_count + 1) * step;
+
+   uint8_t *chunk;
+   if (!(chunk = calloc(step, slab->member)))
+      return false;
+
+   // bookkeeping arrays may move, items never do
+   uint8_t **chunks;
+   if (!(chunks = realloc(slab->chunks, (slab->chunks_count + 1) * sizeof(uint8_t*))))
+      goto error0;
+
+   slab->chunks = chunks;
+
+   uint8_t *alive;
+   if (!(alive = realloc(slab->alive, slots)))
+      goto error0;
+
+   memset(alive + slots - step, 0, step);
+   slab->alive = alive;
+
+   size_t *free_slots;
+   if (!(free_slots = realloc(slab->free, slots * sizeof(size_t))))
+      goto error0;
+
+   slab->free = free_slots;
+   slab->chunks[slab->chunks_count++] = chunk;
+   return true;
+
+error0:
+   free(chunk);
+   return false;
+}
+
+void*
+wlc_slab_add(struct wlc_slab *slab, size_t *out_index)
+{
+   assert(slab);
+
+   size_t index;
+   if (slab->free_count > 0) {
+      index = slab->free[--slab->free_count];
+   } else {
+      if (slab->used >= (slab->chunks_count << slab->shift) && !add_chunk(slab))
+         return NULL;
+
+      index = slab->used++;
+   }
+
+   slab->alive[index] = true;
+   slab->count++;
+
+   void *item = wlc_slab_get(slab, index);
+   memset(item, 0, slab->member);
+
+   if (out_index)
+      *out_index = index;
+
+   return item;
+}
+
+void
+wlc_slab_remove(struct wlc_slab *slab, size_t index)
+{
+   if (!slab || index >= slab->used || !slab->alive[index])
+      return;
+
+   slab->alive[index] = false;
+   slab->free[slab->free_count++] = index;
+   slab->count--;
+}
+
+void
+wlc_slab_release(struct wlc_slab *slab)
+{
+   if (!slab)
+      return;
+
+   for (size_t i = 0; i < slab->chunks_count; ++i)
+      free(slab->chunks[i]);
+
+   free(slab->chunks);
+   free(slab->alive);
+   free(slab->free);
+
+   const size_t member = slab->member, shift = slab->shift;
+   memset(slab, 0, sizeof(struct wlc_slab));
+   slab->member = member;
+   slab->shift = shift;
+}
+
+bool
+wlc_slab(struct wlc_slab *slab, size_t step, size_t member)
+{
+   assert(slab && member > 0);
+   memset(slab, 0, sizeof(struct wlc_slab));
+
+   while (((size_t)1 << slab->shift) < step)
+      ++slab->shift;
+
+   slab->member = member;
+   return true;
+}
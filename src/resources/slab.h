@@ -0,0 +1,56 @@
+#ifndef _WLC_SLAB_H_
+#define _WLC_SLAB_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <wlc/defines.h>
+
+/**
+ * Chunked storage with stable item addresses.
+ * Growing allocates a new chunk and never moves existing items,
+ * removed slots are reused and skipped on iteration.
+ */
+struct wlc_slab {
+   uint8_t **chunks;
+   uint8_t *alive; // one byte for each slot in chunks
+   size_t *free; // removed slots, reused in last in first out order
+   size_t member; // size of item
+   size_t shift; // items per chunk as power of two
+   size_t chunks_count, free_count;
+   size_t used; // slots handed out so far, including removed ones
+   size_t count; // alive items
+};
+
+/** Initialize slab, step is rounded up to power of two and is the number of items in chunk. */
+WLC_NONULL bool wlc_slab(struct wlc_slab *slab, size_t step, size_t member);
+
+/** Release all chunks, pointers to items are invalid after this. */
+void wlc_slab_release(struct wlc_slab *slab);
+
+/** Add zeroed item, index of the slot is stored to out_index. */
+WLC_NONULLV(1) void* wlc_slab_add(struct wlc_slab *slab, size_t *out_index);
+
+/** Remove item, the slot gets reused by later wlc_slab_add. */
+void wlc_slab_remove(struct wlc_slab *slab, size_t index);
+
+/** Get item from slot, NULL if the slot is not alive. */
+static inline void*
+wlc_slab_get(const struct wlc_slab *slab, size_t index)
+{
+   if (!slab || index >= slab->used || !slab->alive[index])
+      return NULL;
+
+   const size_t mask = ((size_t)1 << slab->shift) - 1;
+   return slab->chunks[index >> slab->shift] + (index & mask) * slab->member;
+}
+
+/** Iterate alive items, items may be added or removed while iterating. */
+#define wlc_slab_for_each(slab, pos) \
+   for (size_t _s = 0; _s < (slab)->used; ++_s) if (!((pos) = wlc_slab_get(slab, _s))) {} else
+
+/** Call function for each alive item with item as first argument. */
+#define wlc_slab_for_each_call(slab, function, ...) \
+   { void *_p; wlc_slab_for_each(slab, _p) function(_p, ##__VA_ARGS__); }
+
+#endif /* _WLC_SLAB_H_ */
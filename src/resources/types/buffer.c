@@ -32,7 +32,7 @@ wlc_buffer_release(struct wlc_buffer *buffer)
       return;
 
    struct wlc_surface *surface;
-   if ((surface = convert_from_wlc_resource(buffer->surface, "surface"))) {
+   if ((surface = convert_from_wlc_resource(buffer->surface, WLC_TYPE_SURFACE))) {
       if (surface->commit.buffer == convert_to_wlc_resource(buffer))
          surface->commit.buffer = 0;
       if (surface->pending.buffer == convert_to_wlc_resource(buffer))
@@ -40,7 +40,7 @@ wlc_buffer_release(struct wlc_buffer *buffer)
    }
 
    struct wl_resource *resource;
-   if ((resource = convert_to_wl_resource(buffer, "buffer"))) {
+   if ((resource = convert_to_wl_resource(buffer, WLC_TYPE_BUFFER))) {
       wlc_resource_invalidate(convert_to_wlc_resource(buffer));
       wl_resource_queue_event(resource, WL_BUFFER_RELEASE);
    }
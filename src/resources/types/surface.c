@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <math.h>
 #include <wayland-server.h>
 #include "internal.h"
 #include "surface.h"
@@ -10,6 +11,8 @@
 #include "macros.h"
 #include "compositor/output.h"
 #include "compositor/view.h"
+#include "compositor/presentation.h"
+#include "trace.h"
 #include <chck/math/math.h>
 
 static void
@@ -18,13 +21,13 @@ surface_attach(struct wlc_surface *surface, struct wlc_buffer *buffer)
    assert(surface);
 
    struct wlc_output *output;
-   if (!(output = convert_from_wlc_handle(surface->output, "output")))
+   if (!(output = convert_from_wlc_handle(surface->output, WLC_TYPE_OUTPUT)))
       return;
 
    wlc_surface_attach_to_output(surface, output, buffer);
 
    struct wlc_view *view;
-   if ((view = convert_from_wlc_handle(surface->view, "view"))) {
+   if ((view = convert_from_wlc_handle(surface->view, WLC_TYPE_VIEW))) {
       if (buffer) {
          wlc_view_map(view);
          wlc_view_ack_surface_attach(view, surface);
@@ -40,7 +43,7 @@ state_set_buffer(struct wlc_surface_state *state, struct wlc_buffer *buffer)
    if (state->buffer == convert_to_wlc_resource(buffer))
       return;
 
-   wlc_buffer_dispose(convert_from_wlc_resource(state->buffer, "buffer"));
+   wlc_buffer_dispose(convert_from_wlc_resource(state->buffer, WLC_TYPE_BUFFER));
    state->buffer = wlc_buffer_use(buffer);
 }
 
@@ -55,6 +58,27 @@ commit_state(struct wlc_surface *surface, struct wlc_surface_state *pending, str
       chck_iter_pool_push_back(&out->frame_cbs, r);
    chck_iter_pool_flush(&pending->frame_cbs);
 
+   // Content these were for was replaced before it got on screen
+   chck_iter_pool_for_each(&out->feedbacks, r)
+      wlc_presentation_feedback_discarded(*r);
+   chck_iter_pool_flush(&out->feedbacks);
+
+   chck_iter_pool_for_each(&pending->feedbacks, r)
+      chck_iter_pool_push_back(&out->feedbacks, r);
+   chck_iter_pool_flush(&pending->feedbacks);
+
+   {
+      // textures are updated in buffer coordinates, possibly frames later than the damage is painted
+      int nrects;
+      const pixman_box32_t *boxes = pixman_region32_rectangles(&pending->damage, &nrects);
+      for (int i = 0; i < nrects; ++i) {
+         const int32_t x1 = chck_max32(boxes[i].x1, 0), y1 = chck_max32(boxes[i].y1, 0);
+         const int32_t x2 = chck_min32(boxes[i].x2, surface->size.w), y2 = chck_min32(boxes[i].y2, surface->size.h);
+         if (x2 > x1 && y2 > y1)
+            pixman_region32_union_rect(&surface->upload_damage, &surface->upload_damage, x1 * out->scale, y1 * out->scale, (x2 - x1) * out->scale, (y2 - y1) * out->scale);
+      }
+   }
+
    pixman_region32_union(&out->damage, &out->damage, &pending->damage);
    pixman_region32_intersect_rect(&out->damage, &out->damage, 0, 0, surface->size.w, surface->size.h);
    pixman_region32_clear(&surface->pending.damage);
@@ -70,13 +94,19 @@ commit_state(struct wlc_surface *surface, struct wlc_surface_state *pending, str
 
    pixman_region32_intersect_rect(&out->input, &pending->input, 0, 0, surface->size.w, surface->size.h);
 
-   if (pending->attached) {
-      surface_attach(surface, convert_from_wlc_resource(pending->buffer, "buffer"));
+   const bool attached = pending->attached;
+   if (attached) {
+      surface_attach(surface, convert_from_wlc_resource(pending->buffer, WLC_TYPE_BUFFER));
       pending->attached = false;
    }
 
-   state_set_buffer(out, convert_from_wlc_resource(pending->buffer, "buffer"));
+   state_set_buffer(out, convert_from_wlc_resource(pending->buffer, WLC_TYPE_BUFFER));
    state_set_buffer(pending, NULL);
+
+   if (attached) {
+      struct wlc_surface_event ev = { .surface = surface, .type = WLC_SURFACE_EVENT_ATTACHED };
+      wl_signal_emit(&wlc_system_signals()->surface, &ev);
+   }
 }
 
 static void
@@ -103,6 +133,11 @@ release_state(struct wlc_surface_state *state)
    state_set_buffer(state, 0);
    chck_iter_pool_for_each_call(&state->frame_cbs, wlc_resource_release_ptr);
    chck_iter_pool_release(&state->frame_cbs);
+
+   wlc_resource *r;
+   chck_iter_pool_for_each(&state->feedbacks, r)
+      wlc_presentation_feedback_discarded(*r);
+   chck_iter_pool_release(&state->feedbacks);
 }
 
 static void
@@ -111,7 +146,7 @@ wl_cb_surface_attach(struct wl_client *client, struct wl_resource *resource, str
    (void)client;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wl_resource(resource, "surface")))
+   if (!(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE)))
       return;
 
    wlc_resource buffer = 0;
@@ -121,7 +156,7 @@ wl_cb_surface_attach(struct wl_client *client, struct wl_resource *resource, str
    }
 
    struct wlc_buffer *b;
-   if ((b = convert_from_wlc_resource(buffer, "buffer"))) {
+   if ((b = convert_from_wlc_resource(buffer, WLC_TYPE_BUFFER))) {
       b->surface = convert_to_wlc_resource(surface);
       state_set_buffer(&surface->pending, b);
    }
@@ -138,7 +173,7 @@ wl_cb_surface_damage(struct wl_client *client, struct wl_resource *resource, int
    (void)client;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wl_resource(resource, "surface")))
+   if (!(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE)))
       return;
 
    pixman_region32_union_rect(&surface->pending.damage, &surface->pending.damage, x, y, width, height);
@@ -149,7 +184,7 @@ static void
 wl_cb_surface_frame(struct wl_client *client, struct wl_resource *resource, uint32_t callback_id)
 {
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wl_resource(resource, "surface")))
+   if (!(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE)))
       return;
 
    wlc_resource r;
@@ -167,11 +202,11 @@ wl_cb_surface_set_opaque_region(struct wl_client *client, struct wl_resource *re
    (void)client;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wl_resource(resource, "surface")))
+   if (!(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE)))
       return;
 
    struct wlc_region *region;
-   if (region_resource && (region = convert_from_wl_resource(region_resource, "region"))) {
+   if (region_resource && (region = convert_from_wl_resource(region_resource, WLC_TYPE_REGION))) {
       pixman_region32_copy(&surface->pending.opaque, &region->region);
    } else {
       pixman_region32_clear(&surface->pending.opaque);
@@ -184,11 +219,11 @@ wl_cb_surface_set_input_region(struct wl_client *client, struct wl_resource *res
    (void)client;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wl_resource(resource, "surface")))
+   if (!(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE)))
       return;
 
    struct wlc_region *region;
-   if (region_resource && (region = convert_from_wl_resource(region_resource, "region"))) {
+   if (region_resource && (region = convert_from_wl_resource(region_resource, WLC_TYPE_REGION))) {
       pixman_region32_copy(&surface->pending.input, &region->region);
    } else {
       pixman_region32_fini(&surface->pending.input);
@@ -203,19 +238,22 @@ commit_subsurface_state(struct wlc_surface *surface)
       return;
 
    commit_state(surface, &surface->pending, &surface->commit);
-   wlc_output_schedule_repaint(convert_from_wlc_handle(surface->output, "output"));
+   wlc_output_schedule_repaint(convert_from_wlc_handle(surface->output, WLC_TYPE_OUTPUT));
    wlc_dlog(WLC_DBG_RENDER, "-> Commit request");
 
    wlc_resource *r;
    chck_iter_pool_for_each(&surface->subsurface_list, r) {
       struct wlc_surface *sub;
-      if (!(sub = convert_from_wlc_resource(*r, "surface")))
+      if (!(sub = convert_from_wlc_resource(*r, WLC_TYPE_SURFACE)))
          continue;
 
       sub->commit.subsurface_position = sub->pending.subsurface_position;
       if (sub->synchronized || sub->parent_synchronized)
          commit_subsurface_state(sub);
    }
+
+   // subsurfaces may have moved
+   wlc_view_grid_invalidate(convert_from_wlc_handle(surface->parent_view, WLC_TYPE_VIEW));
 }
 
 static void
@@ -224,9 +262,11 @@ wl_cb_surface_commit(struct wl_client *client, struct wl_resource *resource)
    (void)client;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wl_resource(resource, "surface")))
+   if (!(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE)))
       return;
 
+   wlc_trace(WLC_TRACE_COMMIT, surface->output, convert_to_wlc_resource(surface), surface->view);
+
    if (surface->parent_synchronized || surface->synchronized) {
       return;
    } else {
@@ -240,7 +280,7 @@ wl_cb_surface_set_buffer_transform(struct wl_client *client, struct wl_resource
    (void)client, (void)resource, (void)transform;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wl_resource(resource, "surface")))
+   if (!(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE)))
       return;
 
    if (transform < 0 || transform > WL_OUTPUT_TRANSFORM_FLIPPED_270) {
@@ -257,7 +297,7 @@ wl_cb_surface_set_buffer_scale(struct wl_client *client, struct wl_resource *res
    (void)client;
 
    struct wlc_surface *surface;
-   if (!(surface = convert_from_wl_resource(resource, "surface")))
+   if (!(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE)))
       return;
 
    if (scale < 0) {
@@ -311,6 +351,31 @@ wlc_surface_get_opaque(struct wlc_surface *surface, const struct wlc_point *offs
    return opaque;
 }
 
+void
+wlc_surface_get_opaque_region(struct wlc_surface *surface, const struct wlc_point *offset, pixman_region32_t *out_opaque)
+{
+   assert(offset && out_opaque);
+   pixman_region32_clear(out_opaque);
+
+   if (!surface)
+      return;
+
+   // Rounded inwards when scaled, it's better to draw something hidden than to not draw something visible
+   int nrects;
+   const pixman_box32_t *boxes = pixman_region32_rectangles(&surface->commit.opaque, &nrects);
+   for (int i = 0; i < nrects; ++i) {
+      const int32_t x1 = ceil(chck_min32(boxes[i].x1, surface->size.w) * surface->coordinate_transform.w);
+      const int32_t y1 = ceil(chck_min32(boxes[i].y1, surface->size.h) * surface->coordinate_transform.h);
+      const int32_t x2 = floor(chck_min32(boxes[i].x2, surface->size.w) * surface->coordinate_transform.w);
+      const int32_t y2 = floor(chck_min32(boxes[i].y2, surface->size.h) * surface->coordinate_transform.h);
+
+      if (x2 <= x1 || y2 <= y1)
+         continue;
+
+      pixman_region32_union_rect(out_opaque, out_opaque, offset->x + x1, offset->y + y1, x2 - x1, y2 - y1);
+   }
+}
+
 void
 wlc_surface_get_input(struct wlc_surface *surface, const struct wlc_point *offset, struct wlc_geometry *out_input)
 {
@@ -337,7 +402,7 @@ wlc_surface_get_buffer(struct wlc_surface *surface)
    if (!surface)
       return NULL;
 
-   return convert_from_wlc_resource((surface->commit.buffer ? surface->commit.buffer : surface->pending.buffer), "buffer");
+   return convert_from_wlc_resource((surface->commit.buffer ? surface->commit.buffer : surface->pending.buffer), WLC_TYPE_BUFFER);
 }
 
 void
@@ -348,7 +413,7 @@ wlc_surface_attach_to_view(struct wlc_surface *surface, struct wlc_view *view)
 
    wlc_handle old = surface->view;
    surface->view = surface->parent_view = convert_to_wlc_handle(view);
-   wlc_view_set_surface(convert_from_wlc_handle(old, "view"), NULL);
+   wlc_view_set_surface(convert_from_wlc_handle(old, WLC_TYPE_VIEW), NULL);
    wlc_view_set_surface(view, surface);
 }
 
@@ -369,7 +434,7 @@ wlc_surface_attach_to_output(struct wlc_surface *surface, struct wlc_output *out
    surface->size = size;
 
    struct wlc_view *view;
-   if (surface->view && (view = convert_from_wlc_handle(surface->view, "view"))) {
+   if (surface->view && (view = convert_from_wlc_handle(surface->view, WLC_TYPE_VIEW))) {
       struct wlc_geometry g, area;
       wlc_view_get_bounds(view, &g, &area);
       surface->coordinate_transform.w = (float)(area.size.w) / size.w;
@@ -379,12 +444,13 @@ wlc_surface_attach_to_output(struct wlc_surface *surface, struct wlc_output *out
    }
 
    struct wlc_surface *p;
-   if ((p = convert_from_wlc_resource(surface->parent, "surface"))) {
+   if ((p = convert_from_wlc_resource(surface->parent, WLC_TYPE_SURFACE))) {
       surface->coordinate_transform.w *= p->coordinate_transform.w;
       surface->coordinate_transform.h *= p->coordinate_transform.h;
    }
 
    surface->commit.attached = (buffer ? true : false);
+   wlc_view_grid_invalidate(convert_from_wlc_handle(surface->parent_view, WLC_TYPE_VIEW));
    return true;
 }
 
@@ -398,8 +464,10 @@ wlc_surface_set_parent(struct wlc_surface *surface, struct wlc_surface *parent)
    if (surface->parent == newp)
       return;
 
+   wlc_view_grid_invalidate(convert_from_wlc_handle(surface->parent_view, WLC_TYPE_VIEW));
+
    struct wlc_surface *p;
-   if ((p = convert_from_wlc_resource(surface->parent, "surface"))) {
+   if ((p = convert_from_wlc_resource(surface->parent, WLC_TYPE_SURFACE))) {
       wlc_resource *sub;
       const wlc_resource surface_id = convert_to_wlc_resource(surface);
       chck_iter_pool_for_each(&p->subsurface_list, sub) {
@@ -413,9 +481,10 @@ wlc_surface_set_parent(struct wlc_surface *surface, struct wlc_surface *parent)
 
    const wlc_resource r = convert_to_wlc_resource(surface);
    if (parent && chck_iter_pool_push_front(&parent->subsurface_list, &r)) {
-      wlc_surface_attach_to_output(surface, convert_from_wlc_handle(parent->output, "output"), wlc_surface_get_buffer(surface));
+      wlc_surface_attach_to_output(surface, convert_from_wlc_handle(parent->output, WLC_TYPE_OUTPUT), wlc_surface_get_buffer(surface));
       surface->parent = newp;
       surface->parent_view = parent->parent_view;
+      wlc_view_grid_invalidate(convert_from_wlc_handle(surface->parent_view, WLC_TYPE_VIEW));
    } else {
       surface->parent = 0;
    }
@@ -427,7 +496,7 @@ wlc_surface_invalidate(struct wlc_surface *surface)
    if (!surface)
       return;
 
-   wlc_output_surface_destroy(convert_from_wlc_handle(surface->output, "output"), surface);
+   wlc_output_surface_destroy(convert_from_wlc_handle(surface->output, WLC_TYPE_OUTPUT), surface);
 }
 
 void
@@ -449,6 +518,7 @@ wlc_surface_release(struct wlc_surface *surface)
 
    release_state(&surface->commit);
    release_state(&surface->pending);
+   pixman_region32_fini(&surface->upload_damage);
 
    wlc_source_release(&surface->buffers);
    wlc_source_release(&surface->callbacks);
@@ -466,12 +536,16 @@ wlc_surface(struct wlc_surface *surface)
 {
    assert(surface);
 
-   if (!wlc_source(&surface->buffers, "buffer", wlc_buffer, wlc_buffer_release, 4, sizeof(struct wlc_buffer)) ||
-       !wlc_source(&surface->callbacks, "callback", NULL, NULL, 4, sizeof(struct wlc_resource)))
+   pixman_region32_init(&surface->upload_damage);
+
+   if (!wlc_source(&surface->buffers, WLC_TYPE_BUFFER, wlc_buffer, wlc_buffer_release, 4, sizeof(struct wlc_buffer)) ||
+       !wlc_source(&surface->callbacks, WLC_TYPE_CALLBACK, NULL, NULL, 4, sizeof(struct wlc_resource)))
       goto fail;
 
    if (!chck_iter_pool(&surface->commit.frame_cbs, 4, 0, sizeof(wlc_resource)) ||
        !chck_iter_pool(&surface->pending.frame_cbs, 4, 0, sizeof(wlc_resource)) ||
+       !chck_iter_pool(&surface->commit.feedbacks, 4, 0, sizeof(wlc_resource)) ||
+       !chck_iter_pool(&surface->pending.feedbacks, 4, 0, sizeof(wlc_resource)) ||
        !chck_iter_pool(&surface->subsurface_list, 4, 0, sizeof(wlc_resource)))
       goto fail;
 
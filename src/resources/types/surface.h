@@ -15,6 +15,8 @@ struct wlc_view;
 
 struct wlc_surface_state {
    struct chck_iter_pool frame_cbs;
+   struct chck_iter_pool feedbacks; // wp_presentation_feedback
+
    pixman_region32_t opaque;
    pixman_region32_t input;
    pixman_region32_t damage;
@@ -52,6 +54,9 @@ struct wlc_surface {
    /* Current output the surface is attached to */
    wlc_handle output;
 
+   /* Geometry the surface was last painted at on its output, used for damage tracking */
+   struct wlc_geometry painted;
+
    /**
     * "Texture" as we use OpenGL terminology, but can be id to anything.
     * Managed by the renderer.
@@ -64,12 +69,28 @@ struct wlc_surface {
     */
    void *images[3];
 
+   /**
+    * Size and format of the texture storage, so the renderer can update it in place.
+    * Managed by the renderer.
+    */
+   struct {
+      struct wlc_size size;
+      uint32_t format, type;
+   } storage;
+
    enum wlc_surface_format format;
 
    bool synchronized, parent_synchronized;
+
+   /* Committed buffer is uploaded on next repaint, so commits in between cost nothing */
+   bool needs_upload;
+
+   /* Damage in buffer coordinates not uploaded yet, output damage tracking does not consume it */
+   pixman_region32_t upload_damage;
 };
 
 WLC_NONULLV(2,3) bool wlc_surface_get_opaque(struct wlc_surface *surface, const struct wlc_point *offset, struct wlc_geometry *out_opaque);
+WLC_NONULLV(2,3) void wlc_surface_get_opaque_region(struct wlc_surface *surface, const struct wlc_point *offset, pixman_region32_t *out_opaque);
 WLC_NONULLV(2,3) void wlc_surface_get_input(struct wlc_surface *surface, const struct wlc_point *offset, struct wlc_geometry *out_input);
 struct wlc_buffer* wlc_surface_get_buffer(struct wlc_surface *surface);
 void wlc_surface_attach_to_view(struct wlc_surface *surface, struct wlc_view *view);
@@ -94,6 +94,18 @@ wlc_touch_type_for_libinput_type(enum libinput_event_type type)
    return WLC_TOUCH_CANCEL;
 }
 
+static void
+flush_motion(struct wlc_input_event *motion)
+{
+   assert(motion);
+
+   if (!motion->motion.count)
+      return;
+
+   wl_signal_emit(&wlc_system_signals()->input, motion);
+   memset(motion, 0, sizeof(struct wlc_input_event));
+}
+
 static int
 input_event(int fd, uint32_t mask, void *data)
 {
@@ -103,13 +115,22 @@ input_event(int fd, uint32_t mask, void *data)
    if (libinput_dispatch(input->handle) != 0)
       wlc_log(WLC_LOG_WARN, "Failed to dispatch libinput");
 
+   // Relative motion queued since last wakeup is summed up, so the seat hit-tests and
+   // talks to clients once per batch instead of once per device report.
+   struct wlc_input_event motion = {0};
+
    struct libinput_event *event;
    while ((event = libinput_get_event(input->handle))) {
       struct libinput *handle = libinput_event_get_context(event);
       struct libinput_device *device = libinput_event_get_device(event);
       (void)handle;
 
-      switch (libinput_event_get_type(event)) {
+      // anything else must see the motion that happened before it
+      const enum libinput_event_type type = libinput_event_get_type(event);
+      if (type != LIBINPUT_EVENT_POINTER_MOTION)
+         flush_motion(&motion);
+
+      switch (type) {
          case LIBINPUT_EVENT_DEVICE_ADDED:
             WLC_INTERFACE_EMIT(input.created, device);
             break;
@@ -121,12 +142,13 @@ input_event(int fd, uint32_t mask, void *data)
          case LIBINPUT_EVENT_POINTER_MOTION:
          {
             struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
-            struct wlc_input_event ev = {0};
-            ev.type = WLC_INPUT_EVENT_MOTION;
-            ev.time = libinput_event_pointer_get_time(pev);
-            ev.motion.dx = libinput_event_pointer_get_dx(pev);
-            ev.motion.dy = libinput_event_pointer_get_dy(pev);
-            wl_signal_emit(&wlc_system_signals()->input, &ev);
+            motion.type = WLC_INPUT_EVENT_MOTION;
+            motion.time = libinput_event_pointer_get_time(pev);
+            motion.motion.dx += libinput_event_pointer_get_dx(pev);
+            motion.motion.dy += libinput_event_pointer_get_dy(pev);
+            motion.motion.dx_unaccel += libinput_event_pointer_get_dx_unaccelerated(pev);
+            motion.motion.dy_unaccel += libinput_event_pointer_get_dy_unaccelerated(pev);
+            motion.motion.count++;
          }
          break;
 
@@ -244,6 +266,7 @@ input_event(int fd, uint32_t mask, void *data)
       libinput_event_destroy(event);
    }
 
+   flush_motion(&motion);
    return 0;
 }
 
@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <chck/string/string.h>
+#include "internal.h"
+#include "trace.h"
+
+// Must be power of two, 40 bytes per record
+#define TRACE_RECORDS (1 << 16)
+
+struct trace_record {
+   uint64_t seq; // position + 1 once the record is complete, 0 while being written
+   uint64_t time;
+   uint32_t event, track;
+   int64_t a, b;
+};
+
+struct wlc_trace_ring {
+   struct trace_record records[TRACE_RECORDS];
+   uint64_t head;
+};
+
+struct wlc_trace_ring *wlc_trace_ring;
+
+static struct {
+   struct wl_event_source *signal;
+   char *path;
+} trace;
+
+// Phase is the Chrome trace event type: B(egin), E(nd) or i(nstant)
+// Argument without name is not written out
+static const struct {
+   const char *name;
+   char phase;
+   const char *a, *b;
+} events[WLC_TRACE_LAST] = {
+   { "repaint", 'B', NULL, NULL },
+   { "repaint", 'E', "views", "subsurfaces" },
+   { "repaint-skip", 'i', NULL, NULL },
+   { "repaint-schedule", 'i', "deadline", "vblank" },
+   { "activity", 'i', NULL, NULL },
+   { "scanout", 'i', "view", NULL },
+   { "swap", 'i', "rects", NULL },
+   { "flip", 'i', "seq", "flags" },
+   { "missed", 'i', "late", NULL },
+   { "commit", 'i', "surface", "view" },
+   { "handle-new", 'i', "handle", NULL },
+   { "handle-release", 'i', "handle", NULL },
+   { "pointer-motion", 'i', "x", "y" },
+   { "key", 'i', "key", "state" },
+};
+
+void
+wlc_trace_record(enum wlc_trace_event event, uint32_t track, int64_t a, int64_t b)
+{
+   struct wlc_trace_ring *ring;
+   if (!(ring = __atomic_load_n(&wlc_trace_ring, __ATOMIC_ACQUIRE)))
+      return;
+
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   // claiming a slot is the only synchronization, writers never wait on each other or on the dump
+   const uint64_t pos = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+   struct trace_record *r = &ring->records[pos & (TRACE_RECORDS - 1)];
+   __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   r->time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+   r->event = event;
+   r->track = track;
+   r->a = a;
+   r->b = b;
+   __atomic_store_n(&r->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void
+write_record(FILE *f, const struct trace_record *r, bool first, pid_t pid)
+{
+   fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03" PRIu64 ",\"pid\":%d,\"tid\":%" PRIu32,
+           (first ? "" : ","), events[r->event].name, events[r->event].phase, r->time / 1000, r->time % 1000, (int)pid, r->track);
+
+   if (events[r->event].phase == 'i')
+      fprintf(f, ",\"s\":\"t\"");
+
+   if (events[r->event].a) {
+      fprintf(f, ",\"args\":{\"%s\":%" PRId64, events[r->event].a, r->a);
+      if (events[r->event].b)
+         fprintf(f, ",\"%s\":%" PRId64, events[r->event].b, r->b);
+      fprintf(f, "}");
+   }
+
+   fprintf(f, "}");
+}
+
+bool
+wlc_trace_dump(const char *path)
+{
+   assert(path);
+
+   struct wlc_trace_ring *ring;
+   if (!(ring = wlc_trace_ring))
+      return false;
+
+   FILE *f;
+   if (!(f = fopen(path, "w"))) {
+      wlc_log(WLC_LOG_WARN, "Failed to open trace file '%s': %m", path);
+      return false;
+   }
+
+   const pid_t pid = getpid();
+   const uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+   const uint64_t tail = (head > TRACE_RECORDS ? head - TRACE_RECORDS : 0);
+
+   // Chrome trace JSON, loads in chrome://tracing and ui.perfetto.dev
+   uint64_t written = 0;
+   fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+   for (uint64_t pos = tail; pos < head; ++pos) {
+      const struct trace_record *slot = &ring->records[pos & (TRACE_RECORDS - 1)];
+
+      // skip records that are still being written or were already overwritten by newer ones
+      struct trace_record r;
+      if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+         continue;
+
+      memcpy(&r, slot, sizeof(r));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != pos + 1 || r.event >= WLC_TRACE_LAST)
+         continue;
+
+      write_record(f, &r, (written++ == 0), pid);
+   }
+   fprintf(f, "\n]}\n");
+
+   const bool ok = (fclose(f) == 0);
+   wlc_log(WLC_LOG_INFO, "Wrote %" PRIu64 " trace records to '%s'", written, path);
+   return ok;
+}
+
+static int
+cb_dump_signal(int signal_number, void *data)
+{
+   (void)signal_number, (void)data;
+   wlc_trace_dump(trace.path);
+   return 1;
+}
+
+void
+wlc_trace_terminate(void)
+{
+   struct wlc_trace_ring *ring;
+   if (!(ring = wlc_trace_ring))
+      return;
+
+   // whatever happened last before exit is usually the interesting part
+   wlc_trace_dump(trace.path);
+
+   if (trace.signal)
+      wl_event_source_remove(trace.signal);
+
+   __atomic_store_n(&wlc_trace_ring, NULL, __ATOMIC_RELEASE);
+   free(ring);
+   free(trace.path);
+   memset(&trace, 0, sizeof(trace));
+}
+
+bool
+wlc_trace_init(void)
+{
+   if (wlc_trace_ring)
+      return true;
+
+   const char *path = getenv("WLC_TRACE");
+   if (chck_cstr_is_empty(path))
+      return true;
+
+   struct wlc_trace_ring *ring;
+   if (!(ring = calloc(1, sizeof(struct wlc_trace_ring))) || !(trace.path = strdup(path)))
+      goto fail;
+
+   // SIGUSR1 and SIGUSR2 are taken by VT switching
+   if (!(trace.signal = wl_event_loop_add_signal(wlc_event_loop(), SIGRTMIN, cb_dump_signal, NULL)))
+      goto fail;
+
+   __atomic_store_n(&wlc_trace_ring, ring, __ATOMIC_RELEASE);
+   wlc_log(WLC_LOG_INFO, "Tracing to '%s', send SIGRTMIN to dump", trace.path);
+   return true;
+
+fail:
+   wlc_log(WLC_LOG_WARN, "Failed to initialize tracing");
+   free(ring);
+   free(trace.path);
+   memset(&trace, 0, sizeof(trace));
+   return false;
+}
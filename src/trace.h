@@ -0,0 +1,51 @@
+#ifndef _WLC_TRACE_H_
+#define _WLC_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Binary tracepoints for hot paths where wlc_dlog formatting would be too expensive.
+// Each record is a timestamp, event id, track and two integer arguments.
+// Names and argument meanings live in the event table of trace.c.
+
+enum wlc_trace_event {
+   WLC_TRACE_REPAINT_BEGIN, // track: output
+   WLC_TRACE_REPAINT_END, // track: output, a: views, b: subsurfaces
+   WLC_TRACE_REPAINT_SKIP, // track: output
+   WLC_TRACE_REPAINT_SCHEDULE, // track: output, a: deadline, b: vblank (ns)
+   WLC_TRACE_ACTIVITY, // track: output
+   WLC_TRACE_SCANOUT, // track: output, a: view
+   WLC_TRACE_SWAP, // track: output, a: damage rects
+   WLC_TRACE_FLIP, // track: output, a: seq, b: presentation flags
+   WLC_TRACE_MISSED, // track: output, a: lateness (ns)
+   WLC_TRACE_COMMIT, // track: output, a: surface, b: view
+   WLC_TRACE_HANDLE_NEW, // a: handle
+   WLC_TRACE_HANDLE_RELEASE, // a: handle
+   WLC_TRACE_POINTER_MOTION, // a: x, b: y
+   WLC_TRACE_KEY, // a: key, b: state
+   WLC_TRACE_LAST,
+};
+
+#ifdef ENABLE_TRACE
+
+// Non-NULL while recording, keeps disabled tracepoints at a single load and branch
+extern struct wlc_trace_ring *wlc_trace_ring;
+
+void wlc_trace_record(enum wlc_trace_event event, uint32_t track, int64_t a, int64_t b);
+bool wlc_trace_dump(const char *path);
+void wlc_trace_terminate(void);
+bool wlc_trace_init(void);
+
+#  define wlc_trace(event, track, a, b) { if (__builtin_expect(wlc_trace_ring != NULL, 0)) wlc_trace_record(event, track, a, b); }
+
+#else
+
+static inline bool wlc_trace_dump(const char *path) { (void)path; return false; }
+static inline void wlc_trace_terminate(void) {}
+static inline bool wlc_trace_init(void) { return true; }
+
+#  define wlc_trace(event, track, a, b) { (void)(event), (void)(track), (void)(a), (void)(b); }
+
+#endif
+
+#endif /* _WLC_TRACE_H_ */
@@ -1,5 +1,9 @@
 #include <stdlib.h>
+#include <stdio.h>
 #include <unistd.h>
+#include <signal.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include <chck/string/string.h>
 #include "internal.h"
@@ -11,6 +15,7 @@
 #include "session/logind.h"
 #include "xwayland/xwayland.h"
 #include "resources/resources.h"
+#include "trace.h"
 
 static struct wlc {
    struct wlc_compositor compositor;
@@ -21,12 +26,185 @@ static struct wlc {
    bool active;
 } wlc;
 
+// Longer log lines are truncated, formatting never allocates
+#define LOG_MESSAGE_MAX 512
+
+// Messages queued for the log thread before new ones get dropped
+#define LOG_RING_SIZE 256
+
+struct log_message {
+   enum wlc_log_type type;
+   uint64_t dropped; // messages dropped right before this one
+   char str[LOG_MESSAGE_MAX];
+};
+
+// Asynchronous delivery, handler is called from the log thread so a slow sink can't stall the event loop
+static struct {
+   struct log_message ring[LOG_RING_SIZE];
+   uint32_t head, tail; // free running, head is advanced by producers and tail by the log thread
+   uint64_t dropped, dropped_total;
+   pthread_t thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t wake, delivered;
+   bool running, stop, atfork;
+} logger = {
+   .mutex = PTHREAD_MUTEX_INITIALIZER,
+   .wake = PTHREAD_COND_INITIALIZER,
+   .delivered = PTHREAD_COND_INITIALIZER,
+};
+
 static inline void
 wl_cb_log(const char *fmt, va_list args)
 {
    wlc_vlog(WLC_LOG_WAYLAND, fmt, args);
 }
 
+static void
+log_deliver(enum wlc_log_type type, const char *str)
+{
+   void (*log_fun)(enum wlc_log_type type, const char *str) = wlc.log_fun;
+   if (log_fun)
+      log_fun(type, str);
+}
+
+static void*
+log_thread(void *arg)
+{
+   (void)arg;
+
+   struct log_message msg;
+   pthread_mutex_lock(&logger.mutex);
+   while (true) {
+      while (!logger.stop && logger.head == logger.tail)
+         pthread_cond_wait(&logger.wake, &logger.mutex);
+
+      if (logger.head == logger.tail)
+         break;
+
+      memcpy(&msg, &logger.ring[logger.tail % LOG_RING_SIZE], sizeof(msg));
+      pthread_mutex_unlock(&logger.mutex);
+
+      // drops are reported in place, so it's visible where the gap in the log is
+      if (msg.dropped > 0) {
+         char str[64];
+         snprintf(str, sizeof(str), "Log overflow, dropped %" PRIu64 " messages", msg.dropped);
+         log_deliver(WLC_LOG_WARN, str);
+      }
+
+      log_deliver(msg.type, msg.str);
+
+      // slot is released only after delivery, so waiting producers know their message is out
+      pthread_mutex_lock(&logger.mutex);
+      logger.tail++;
+      pthread_cond_broadcast(&logger.delivered);
+   }
+   pthread_mutex_unlock(&logger.mutex);
+   return NULL;
+}
+
+static void
+log_push(enum wlc_log_type type, const char *str)
+{
+   pthread_mutex_lock(&logger.mutex);
+
+   // errors usually precede exit, they are never dropped and everything up to them gets delivered first
+   const bool flush = (type == WLC_LOG_ERROR && !pthread_equal(pthread_self(), logger.thread));
+   while (flush && logger.running && logger.head - logger.tail >= LOG_RING_SIZE)
+      pthread_cond_wait(&logger.delivered, &logger.mutex);
+
+   if (logger.head - logger.tail >= LOG_RING_SIZE) {
+      logger.dropped++;
+      logger.dropped_total++;
+      pthread_mutex_unlock(&logger.mutex);
+      return;
+   }
+
+   struct log_message *msg = &logger.ring[logger.head % LOG_RING_SIZE];
+   msg->type = type;
+   msg->dropped = logger.dropped;
+   logger.dropped = 0;
+   memcpy(msg->str, str, strlen(str) + 1);
+   const uint32_t target = ++logger.head;
+   pthread_cond_signal(&logger.wake);
+
+   while (flush && logger.running && (int32_t)(logger.tail - target) < 0)
+      pthread_cond_wait(&logger.delivered, &logger.mutex);
+
+   pthread_mutex_unlock(&logger.mutex);
+}
+
+static void
+log_stop(void)
+{
+   if (!logger.running)
+      return;
+
+   // log thread drains the queue before exiting
+   pthread_mutex_lock(&logger.mutex);
+   logger.stop = true;
+   pthread_cond_signal(&logger.wake);
+   pthread_mutex_unlock(&logger.mutex);
+   pthread_join(logger.thread, NULL);
+
+   logger.running = logger.stop = false;
+   logger.head = logger.tail = 0;
+
+   if (logger.dropped_total > 0)
+      wlc_log(WLC_LOG_WARN, "Dropped %" PRIu64 " log messages in total", logger.dropped_total);
+
+   logger.dropped = logger.dropped_total = 0;
+}
+
+static void
+log_fork_prepare(void)
+{
+   pthread_mutex_lock(&logger.mutex);
+}
+
+static void
+log_fork_parent(void)
+{
+   pthread_mutex_unlock(&logger.mutex);
+}
+
+static void
+log_fork_child(void)
+{
+   // log thread does not exist in the child (e.g. Xwayland before exec), so log synchronously.
+   // Queued messages belong to the parent which still delivers them.
+   pthread_mutex_init(&logger.mutex, NULL);
+   pthread_cond_init(&logger.wake, NULL);
+   pthread_cond_init(&logger.delivered, NULL);
+   logger.running = logger.stop = false;
+   logger.head = logger.tail = 0;
+   logger.dropped = logger.dropped_total = 0;
+}
+
+static void
+log_start(void)
+{
+   bool async = false;
+   chck_cstr_to_bool(getenv("WLC_LOG_ASYNC"), &async);
+
+   if (!async || logger.running)
+      return;
+
+   if (!logger.atfork && !(logger.atfork = (pthread_atfork(log_fork_prepare, log_fork_parent, log_fork_child) == 0))) {
+      wlc_log(WLC_LOG_WARN, "Failed to register fork handlers, logging synchronously");
+      return;
+   }
+
+   // signals such as VT switching must keep going to the compositor thread
+   sigset_t all, old;
+   sigfillset(&all);
+   pthread_sigmask(SIG_SETMASK, &all, &old);
+   logger.running = (pthread_create(&logger.thread, NULL, log_thread, NULL) == 0);
+   pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+   if (!logger.running)
+      wlc_log(WLC_LOG_WARN, "Failed to start log thread, logging synchronously");
+}
+
 void
 wlc_vlog(enum wlc_log_type type, const char *fmt, va_list args)
 {
@@ -35,11 +213,15 @@ wlc_vlog(enum wlc_log_type type, const char *fmt, va_list args)
    if (!wlc.log_fun)
       return;
 
-   struct chck_string str = {0};
-   if (chck_string_set_varg(&str, fmt, args))
-      wlc.log_fun(type, str.data);
+   char str[LOG_MESSAGE_MAX];
+   if (vsnprintf(str, sizeof(str), fmt, args) < 0)
+      return;
 
-   chck_string_release(&str);
+   if (logger.running) {
+      log_push(type, str);
+   } else {
+      wlc.log_fun(type, str);
+   }
 }
 
 void
@@ -157,6 +339,7 @@ wlc_cleanup(void)
       wlc_log(WLC_LOG_INFO, "Cleanup wlc");
 
       // fd process never allocates display
+      wlc_trace_terminate();
       wlc_xwayland_terminate();
       wl_display_flush_clients(wlc.display);
       wlc_compositor_release(&wlc.compositor);
@@ -175,6 +358,7 @@ wlc_cleanup(void)
    if (wlc.display)
       wl_display_destroy(wlc.display);
 
+   log_stop();
    memset(&wlc, 0, sizeof(wlc));
 }
 
@@ -297,12 +481,17 @@ wlc_init(void)
 
    const char *x11display = getenv("DISPLAY");
    bool privileged = false;
+
+   // Headless needs no display, seat or tty
+   bool headless = false;
+   chck_cstr_to_bool(getenv("WLC_HEADLESS"), &headless);
+
    const bool has_logind = wlc_logind_available();
 
    if (getuid() != geteuid() || getgid() != getegid()) {
       wlc_log(WLC_LOG_INFO, "Doing work on SUID/SGID side and dropping permissions");
       privileged = true;
-   } else if (!x11display && !has_logind && access("/dev/input/event0", R_OK | W_OK) != 0) {
+   } else if (!x11display && !headless && !has_logind && access("/dev/input/event0", R_OK | W_OK) != 0) {
       die("Not running from X11 and no access to /dev/input/event0 or logind unavailable");
    }
 
@@ -311,7 +500,7 @@ wlc_init(void)
 #ifdef HAS_LOGIND
    // Init logind if we are not running as SUID.
    // We need event loop for logind to work, and thus we won't allow it on SUID process.
-   if (!privileged && !x11display && has_logind) {
+   if (!privileged && !x11display && !headless && has_logind) {
       if (!(wlc.display = wl_display_create()))
          die("Failed to create wayland display");
 
@@ -323,7 +512,7 @@ wlc_init(void)
    (void)privileged;
 #endif
 
-   if (!x11display)
+   if (!x11display && !headless)
       wlc_tty_init(vt);
 
    // -- we open tty before dropping permissions
@@ -339,6 +528,9 @@ wlc_init(void)
 
    // -- permissions are now dropped
 
+   // after fd process is forked, so it won't inherit a process with dead thread
+   log_start();
+
    wl_signal_init(&wlc.signals.terminate);
    wl_signal_init(&wlc.signals.activate);
    wl_signal_init(&wlc.signals.compositor);
@@ -364,11 +556,14 @@ wlc_init(void)
    if (wl_display_init_shm(wlc.display) != 0)
       die("Failed to init shm");
 
-   if (!wlc_udev_init())
+   // not fatal, compositor works the same without traces
+   wlc_trace_init();
+
+   if (!headless && !wlc_udev_init())
       die("Failed to init udev");
 
    const char *libinput = getenv("WLC_LIBINPUT");
-   if (!x11display || (libinput && !chck_cstreq(libinput, "0"))) {
+   if (!headless && (!x11display || (libinput && !chck_cstreq(libinput, "0")))) {
       if (!wlc_input_init())
          die("Failed to init input");
    }
@@ -2,6 +2,7 @@
 #define _WLC_XWAYLAND_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef ENABLE_XWAYLAND
 
@@ -12,6 +13,14 @@ void wlc_xwayland_terminate(void);
 
 #else
 
+struct wl_client;
+
+static inline struct wl_client*
+wlc_xwayland_get_client(void)
+{
+   return NULL;
+}
+
 static inline bool
 wlc_xwayland_init(void)
 {
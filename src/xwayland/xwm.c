@@ -35,7 +35,7 @@ paired_for_id(struct wlc_xwm *xwm, xcb_window_t window)
 
    wlc_handle *h;
    struct wlc_view *view;
-   if (!(h = chck_hash_table_get(&xwm->paired, window)) || !(view = convert_from_wlc_handle(*h, "view")))
+   if (!(h = chck_hash_table_get(&xwm->paired, window)) || !(view = convert_from_wlc_handle(*h, WLC_TYPE_VIEW)))
       return NULL;
 
    return &view->x11;
@@ -294,7 +294,7 @@ link_surface(struct wlc_xwm *xwm, struct wlc_x11_window *win, struct wl_resource
       return;
 
    struct wlc_surface *surface;
-   if (!resource || !(surface = convert_from_wl_resource(resource, "surface"))) {
+   if (!resource || !(surface = convert_from_wl_resource(resource, WLC_TYPE_SURFACE))) {
       wlc_dlog(WLC_DBG_XWM, "-> Surface resource for x11 window (%u) does not exist yet", win->id);
       return;
    }
@@ -0,0 +1,489 @@
+#include "wayland-presentation-time-client-protocol.h"
+#include "client.h"
+#include "macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <chck/math/math.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+/**
+ * Render loop benchmark.
+ *
+ * Runs wlc on headless outputs and drives it with synthetic SHM clients for a fixed time.
+ * Reports commit to present latency percentiles and uploads per second measured by the client,
+ * and CPU time per repaint, CPU time of the whole process per frame and peak memory of the compositor.
+ *
+ * usage: wlc-bench [-m windows,fullscreen,subsurfaces] [-n windows] [-d depth] [-s seconds]
+ *
+ * Output size, refresh rate and renderer follow WLC_HEADLESS_SIZE, WLC_HEADLESS_REFRESH and WLC_RENDERER.
+ */
+
+enum mix {
+   MIX_WINDOWS = 1<<0, // many small windows
+   MIX_FULLSCREEN = 1<<1, // one fullscreen window damaged whole every frame
+   MIX_SUBSURFACES = 1<<2, // window with deep chain of desynchronized subsurfaces
+};
+
+static struct {
+   uint32_t mixes;
+   uint32_t windows, depth, seconds;
+} config = {
+   .mixes = MIX_WINDOWS | MIX_FULLSCREEN | MIX_SUBSURFACES,
+   .windows = 32,
+   .depth = 8,
+   .seconds = 10,
+};
+
+static struct compositor_test compositor;
+
+static uint64_t
+get_time_ns(clockid_t clock)
+{
+   struct timespec ts;
+   clock_gettime(clock, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct bench_buffer {
+   struct wl_buffer *wbuf;
+   uint32_t *data;
+   size_t size;
+   bool busy;
+};
+
+struct bench_surface {
+   struct wl_surface *surface;
+   struct wl_shell_surface *ssurface;
+   struct wl_subsurface *subsurface;
+   struct wl_callback *frame;
+   struct bench_buffer buffers[2];
+   uint32_t width, height, color;
+   bool starved; // no free buffer when frame was due
+};
+
+struct bench_feedback {
+   struct wp_presentation_feedback *feedback;
+   uint64_t commit;
+};
+
+static struct {
+   struct client_test client;
+   struct bench_surface *surfaces;
+   uint32_t nsurfaces;
+   struct chck_iter_pool latencies; // uint64_t, commit to present in ns
+   uint64_t commits, presented, discarded;
+   bool done;
+} bench;
+
+static void surface_redraw(struct bench_surface *s);
+
+static void
+buffer_release(void *data, struct wl_buffer *wbuf)
+{
+   (void)wbuf;
+   struct bench_surface *s = data;
+
+   for (uint32_t i = 0; i < LENGTH(s->buffers); ++i) {
+      if (s->buffers[i].wbuf == wbuf)
+         s->buffers[i].busy = false;
+   }
+
+   if (s->starved && !bench.done) {
+      s->starved = false;
+      surface_redraw(s);
+   }
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+   .release = buffer_release,
+};
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+   (void)time;
+   struct bench_surface *s = data;
+   wl_callback_destroy(callback);
+   s->frame = NULL;
+
+   if (!bench.done)
+      surface_redraw(s);
+}
+
+static const struct wl_callback_listener frame_listener = {
+   .done = frame_done,
+};
+
+static void
+feedback_sync_output(void *data, struct wp_presentation_feedback *feedback, struct wl_output *output)
+{
+   (void)data, (void)feedback, (void)output;
+}
+
+static void
+feedback_presented(void *data, struct wp_presentation_feedback *feedback, uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, uint32_t flags)
+{
+   (void)refresh, (void)seq_hi, (void)seq_lo, (void)flags;
+   struct bench_feedback *fb = data;
+
+   // presentation clock is CLOCK_MONOTONIC, same as commit timestamps
+   const uint64_t presented = (((uint64_t)tv_sec_hi << 32) | tv_sec_lo) * 1000000000 + tv_nsec;
+   const uint64_t latency = (presented > fb->commit ? presented - fb->commit : 0);
+   assert(chck_iter_pool_push_back(&bench.latencies, &latency));
+   bench.presented++;
+
+   wp_presentation_feedback_destroy(feedback);
+   free(fb);
+}
+
+static void
+feedback_discarded(void *data, struct wp_presentation_feedback *feedback)
+{
+   struct bench_feedback *fb = data;
+   bench.discarded++;
+   wp_presentation_feedback_destroy(feedback);
+   free(fb);
+}
+
+static const struct wp_presentation_feedback_listener feedback_listener = {
+   .sync_output = feedback_sync_output,
+   .presented = feedback_presented,
+   .discarded = feedback_discarded,
+};
+
+static void
+buffer_create(struct bench_surface *s, struct bench_buffer *b)
+{
+   assert(s && b);
+
+   int fd;
+   const size_t stride = s->width * 4;
+   b->size = stride * s->height;
+   assert((fd = os_create_anonymous_file(b->size)) >= 0);
+   assert((b->data = mmap(NULL, b->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) != MAP_FAILED);
+   struct wl_shm_pool *pool;
+   assert((pool = wl_shm_create_pool(bench.client.shm, fd, b->size)));
+   assert((b->wbuf = wl_shm_pool_create_buffer(pool, 0, s->width, s->height, stride, WL_SHM_FORMAT_ARGB8888)));
+   wl_buffer_add_listener(b->wbuf, &buffer_listener, s);
+   wl_shm_pool_destroy(pool);
+   close(fd);
+}
+
+static void
+surface_redraw(struct bench_surface *s)
+{
+   assert(s);
+
+   struct bench_buffer *b = NULL;
+   for (uint32_t i = 0; i < LENGTH(s->buffers) && !b; ++i) {
+      if (!s->buffers[i].busy)
+         b = &s->buffers[i];
+   }
+
+   if (!b) {
+      // compositor still holds both buffers, draw once one is released
+      s->starved = true;
+      return;
+   }
+
+   // cheap stand-in for client rendering, every frame has new contents
+   s->color = 0xff000000 | ((s->color + 0x010305) & 0xffffff);
+   for (size_t i = 0; i < b->size / 4; ++i)
+      b->data[i] = s->color;
+
+   wl_surface_attach(s->surface, b->wbuf, 0, 0);
+   wl_surface_damage(s->surface, 0, 0, s->width, s->height);
+
+   assert((s->frame = wl_surface_frame(s->surface)));
+   wl_callback_add_listener(s->frame, &frame_listener, s);
+
+   struct bench_feedback *fb;
+   assert((fb = calloc(1, sizeof(struct bench_feedback))));
+   assert((fb->feedback = wp_presentation_feedback(bench.client.presentation, s->surface)));
+   wp_presentation_feedback_add_listener(fb->feedback, &feedback_listener, fb);
+   fb->commit = get_time_ns(CLOCK_MONOTONIC);
+
+   wl_surface_commit(s->surface);
+   b->busy = true;
+   bench.commits++;
+}
+
+static struct bench_surface*
+surface_add(uint32_t width, uint32_t height, struct bench_surface *parent)
+{
+   struct bench_surface *s = &bench.surfaces[bench.nsurfaces++];
+   s->width = width;
+   s->height = height;
+   s->color = bench.nsurfaces * 0x102030;
+   assert((s->surface = wl_compositor_create_surface(bench.client.compositor)));
+
+   for (uint32_t i = 0; i < LENGTH(s->buffers); ++i)
+      buffer_create(s, &s->buffers[i]);
+
+   if (parent) {
+      assert((s->subsurface = wl_subcompositor_get_subsurface(bench.client.subcompositor, s->surface, parent->surface)));
+      wl_subsurface_set_position(s->subsurface, 4, 4);
+      wl_subsurface_set_desync(s->subsurface);
+   } else {
+      assert((s->ssurface = wl_shell_get_shell_surface(bench.client.shell, s->surface)));
+      wl_shell_surface_add_listener(s->ssurface, &shell_surface_listener, s);
+      wl_shell_surface_set_toplevel(s->ssurface);
+   }
+
+   return s;
+}
+
+static bool
+get_output_size(struct client_test *client, uint32_t *out_w, uint32_t *out_h)
+{
+   struct output *o;
+   if (!(o = chck_iter_pool_get(&client->outputs, 0)))
+      return false;
+
+   struct mode *m;
+   chck_iter_pool_for_each(&o->modes, m) {
+      if (!(m->flags & WL_OUTPUT_MODE_CURRENT))
+         continue;
+
+      *out_w = m->width;
+      *out_h = m->height;
+      return true;
+   }
+
+   return false;
+}
+
+static int
+compare_u64(const void *a, const void *b)
+{
+   const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+   return (x > y) - (x < y);
+}
+
+static double
+percentile_ms(const uint64_t *sorted, size_t memb, uint32_t percent)
+{
+   if (!memb)
+      return 0.0;
+
+   const size_t index = (memb - 1) * percent / 100;
+   return sorted[index] / 1e6;
+}
+
+static void
+client_report(double seconds)
+{
+   size_t memb;
+   uint64_t *latencies = chck_iter_pool_to_c_array(&bench.latencies, &memb);
+   qsort(latencies, memb, sizeof(uint64_t), compare_u64);
+
+   printf("surfaces:      %u\n", bench.nsurfaces);
+   printf("commits:       %" PRIu64 " (%.1f/s)\n", bench.commits, bench.commits / seconds);
+   printf("uploads:       %" PRIu64 " (%.1f/s)\n", bench.presented, bench.presented / seconds);
+   printf("discarded:     %" PRIu64 "\n", bench.discarded);
+   printf("latency (ms):  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+          percentile_ms(latencies, memb, 50), percentile_ms(latencies, memb, 90),
+          percentile_ms(latencies, memb, 99), percentile_ms(latencies, memb, 100));
+   fflush(stdout);
+}
+
+static int
+client_main(void)
+{
+   struct client_test *client = &bench.client;
+   client_test_create(client, "bench", 1, 1);
+   client_test_roundtrip(client);
+   assert(client->presentation && client->subcompositor);
+   assert(chck_iter_pool(&bench.latencies, 0, 4096, sizeof(uint64_t)));
+
+   const uint32_t max_surfaces = config.windows + 1 + (config.depth + 1);
+   assert((bench.surfaces = calloc(max_surfaces, sizeof(struct bench_surface))));
+
+   if (config.mixes & MIX_WINDOWS) {
+      for (uint32_t i = 0; i < config.windows; ++i)
+         surface_add(128, 128, NULL);
+   }
+
+   if (config.mixes & MIX_FULLSCREEN) {
+      uint32_t w = 1920, h = 1080;
+      get_output_size(client, &w, &h);
+      struct bench_surface *s = surface_add(w, h, NULL);
+      wl_shell_surface_set_fullscreen(s->ssurface, WL_SHELL_SURFACE_FULLSCREEN_METHOD_DEFAULT, 0, NULL);
+   }
+
+   if (config.mixes & MIX_SUBSURFACES) {
+      struct bench_surface *parent = surface_add(256, 256, NULL);
+      for (uint32_t i = 0; i < config.depth; ++i) {
+         const uint32_t size = (8 * (i + 1) < 240 ? 256 - 8 * (i + 1) : 16);
+         parent = surface_add(size, size, parent);
+      }
+   }
+
+   // children first, so subsurfaces have contents once their parents get mapped
+   for (uint32_t i = bench.nsurfaces; i > 0; --i)
+      surface_redraw(&bench.surfaces[i - 1]);
+
+   const uint64_t start = get_time_ns(CLOCK_MONOTONIC), duration = (uint64_t)config.seconds * 1000000000;
+   while (!bench.done && wl_display_dispatch(client->display) != -1)
+      bench.done = (get_time_ns(CLOCK_MONOTONIC) - start >= duration);
+
+   client_report((get_time_ns(CLOCK_MONOTONIC) - start) / 1e9);
+   TEST_EXIT_STATUS = EXIT_SUCCESS;
+   return client_test_end(client);
+}
+
+static struct {
+   struct wlc_frame_stats stats; // of the output rendered last, outputs are gone once wlc_run returns
+   uint64_t cpu_start, wall_start;
+   uint64_t frames;
+   uint64_t repaint, repaints; // summed CPU time of the repaints reported by frame stats
+   uint32_t placed;
+} server;
+
+static bool
+view_created(wlc_handle view)
+{
+   const wlc_handle output = wlc_view_get_output(view);
+   const struct wlc_size *r = wlc_output_get_virtual_resolution(output);
+
+   // tile windows left to right, top to bottom, wrapping over when the output is full
+   const uint32_t cell = 160, columns = chck_maxu32((r ? r->w : 1920) / cell, 1);
+   const struct wlc_geometry *current = wlc_view_get_geometry(view);
+   const struct wlc_geometry g = {
+      .origin = { (server.placed % columns) * cell, ((server.placed / columns) * cell) % chck_maxu32((r ? r->h : 1080), cell) },
+      .size = (current ? current->size : (struct wlc_size){ 128, 128 }),
+   };
+   server.placed++;
+
+   wlc_view_set_mask(view, wlc_output_get_mask(output));
+   wlc_view_set_geometry(view, 0, &g);
+   wlc_view_bring_to_front(view);
+   return true;
+}
+
+static void
+view_request_state(wlc_handle view, enum wlc_view_state_bit state, bool toggle)
+{
+   wlc_view_set_state(view, state, toggle);
+
+   const struct wlc_size *r;
+   if (state == WLC_BIT_FULLSCREEN && toggle && (r = wlc_output_get_virtual_resolution(wlc_view_get_output(view))))
+      wlc_view_set_geometry(view, 0, &(struct wlc_geometry){ .origin = { 0, 0 }, .size = *r });
+}
+
+static void
+output_render_post(wlc_handle output)
+{
+   server.frames++;
+
+   // stats are recorded after the post hook, so they describe the previous repaint of this output
+   const struct wlc_frame_stats *stats;
+   if ((stats = wlc_output_get_frame_stats(output))) {
+      server.stats = *stats;
+      server.repaint += stats->repaint;
+      server.repaints += (stats->frames > 0);
+   }
+}
+
+static void
+compositor_ready(void)
+{
+   server.cpu_start = get_time_ns(CLOCK_PROCESS_CPUTIME_ID);
+   server.wall_start = get_time_ns(CLOCK_MONOTONIC);
+   compositor_test_fork_client(&compositor, client_main);
+}
+
+static void
+compositor_report(void)
+{
+   const double seconds = (get_time_ns(CLOCK_MONOTONIC) - server.wall_start) / 1e9;
+   const double cpu_ms = (get_time_ns(CLOCK_PROCESS_CPUTIME_ID) - server.cpu_start) / 1e6;
+
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+
+   printf("repaints:      %" PRIu64 " (%.1f/s)\n", server.frames, server.frames / seconds);
+   printf("repaint cpu:   %.3f ms/frame\n", (server.repaints ? server.repaint / 1e6 / server.repaints : 0.0));
+   printf("process cpu:   %.3f ms/frame (%.1f%% of one core)\n", (server.frames ? cpu_ms / server.frames : 0.0), cpu_ms / (seconds * 10.0));
+   printf("missed frames: %" PRIu64 "\n", server.stats.missed);
+   printf("last frame:    repaint %.3f ms  gpu %.3f ms  flip %.3f ms\n", server.stats.repaint / 1e6, server.stats.gpu / 1e6, server.stats.flip / 1e6);
+   printf("peak memory:   %ld KiB\n", usage.ru_maxrss);
+}
+
+static void
+cb_log_problems(enum wlc_log_type type, const char *str)
+{
+   if (type == WLC_LOG_WARN || type == WLC_LOG_ERROR)
+      fprintf(stderr, "%s\n", str);
+}
+
+static bool
+parse_mixes(const char *str)
+{
+   config.mixes = 0;
+
+   char *copy, *save = NULL;
+   assert((copy = strdup(str)));
+   for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+      if (chck_cstreq(tok, "windows")) {
+         config.mixes |= MIX_WINDOWS;
+      } else if (chck_cstreq(tok, "fullscreen")) {
+         config.mixes |= MIX_FULLSCREEN;
+      } else if (chck_cstreq(tok, "subsurfaces")) {
+         config.mixes |= MIX_SUBSURFACES;
+      } else {
+         free(copy);
+         return false;
+      }
+   }
+
+   free(copy);
+   return (config.mixes != 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+   int opt;
+   while ((opt = getopt(argc, argv, "m:n:d:s:")) != -1) {
+      bool valid = false;
+      switch (opt) {
+         case 'm':
+            valid = parse_mixes(optarg);
+            break;
+         case 'n':
+            valid = chck_cstr_to_u32(optarg, &config.windows);
+            break;
+         case 'd':
+            valid = chck_cstr_to_u32(optarg, &config.depth);
+            break;
+         case 's':
+            valid = chck_cstr_to_u32(optarg, &config.seconds) && config.seconds > 0;
+            break;
+      }
+
+      if (!valid) {
+         fprintf(stderr, "usage: %s [-m windows,fullscreen,subsurfaces] [-n windows] [-d depth] [-s seconds]\n", argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+
+   wlc_set_view_created_cb(view_created);
+   wlc_set_view_request_state_cb(view_request_state);
+   wlc_set_output_render_post_cb(output_render_post);
+   wlc_set_compositor_ready_cb(compositor_ready);
+
+   compositor_test_create(&compositor, "bench");
+
+   // keep the report readable, only problems are logged
+   wlc_log_set_handler(cb_log_problems);
+   wlc_run();
+
+   compositor_report();
+   return compositor_test_end(&compositor);
+}
@@ -24,6 +24,7 @@ struct client_test {
    struct wl_registry *registry;
    struct wl_compositor *compositor;
    struct wl_shell *shell;
+   struct wl_subcompositor *subcompositor;
    struct wl_shm *shm;
    struct wl_seat *seat;
 
@@ -31,6 +32,10 @@ struct client_test {
    struct background *background;
 #endif
 
+#ifdef PRESENTATION_TIME_CLIENT_PROTOCOL_H
+   struct wp_presentation *presentation;
+#endif
+
    struct {
       struct wl_surface *surface;
       struct wl_shell_surface *ssurface;
@@ -261,6 +266,8 @@ handle_global(void *data, struct wl_registry *registry, uint32_t name, const cha
       assert((test->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 1)));
    } else if (chck_cstreq(interface, "wl_shell")) {
       assert((test->shell = wl_registry_bind(registry, name, &wl_shell_interface, 1)));
+   } else if (chck_cstreq(interface, "wl_subcompositor")) {
+      assert((test->subcompositor = wl_registry_bind(registry, name, &wl_subcompositor_interface, 1)));
    } else if (chck_cstreq(interface, "wl_shm")) {
       assert((test->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1)));
       wl_shm_add_listener(test->shm, &shm_listener, test);
@@ -273,6 +280,10 @@ handle_global(void *data, struct wl_registry *registry, uint32_t name, const cha
 #ifdef BACKGROUND_CLIENT_PROTOCOL_H
    } else if (chck_cstreq(interface, "background")) {
       assert((test->background = wl_registry_bind(registry, name, &background_interface, 1)));
+#endif
+#ifdef PRESENTATION_TIME_CLIENT_PROTOCOL_H
+   } else if (chck_cstreq(interface, "wp_presentation")) {
+      assert((test->presentation = wl_registry_bind(registry, name, &wp_presentation_interface, 1)));
 #endif
    }
 }
@@ -394,6 +405,10 @@ compositor_test_create(struct compositor_test *test, const char *name)
    test->name = name;
    wlc_log_set_handler(cb_log);
    setup_signals(compositor_sigterm);
+
+   // Compositor tests don't need display, seat or tty
+   setenv("WLC_HEADLESS", "1", false);
+   setenv("WLC_XWAYLAND", "0", false);
    assert(wlc_init());
 }
 
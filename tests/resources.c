@@ -1,4 +1,6 @@
 #include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
 #include <wlc/wlc.h>
 #include "resources/resources.h"
 
@@ -39,7 +41,28 @@ static bool
 constructor2(struct contains_source *ptr)
 {
    assert(ptr);
-   assert(wlc_source(&ptr->source, "test2", constructor, destructor, 1, sizeof(struct wlc_resource)));
+   assert(wlc_source(&ptr->source, WLC_TYPE_SURFACE, constructor, destructor, 1, sizeof(struct wlc_resource)));
+   return true;
+}
+
+struct owns_sources {
+   struct wlc_source buffers, callbacks;
+};
+
+static void
+destructor3(struct owns_sources *ptr)
+{
+   assert(ptr);
+   wlc_source_release(&ptr->buffers);
+   wlc_source_release(&ptr->callbacks);
+}
+
+static bool
+constructor3(struct owns_sources *ptr)
+{
+   assert(ptr);
+   assert(wlc_source(&ptr->buffers, WLC_TYPE_BUFFER, NULL, NULL, 4, sizeof(struct wlc_resource)));
+   assert(wlc_source(&ptr->callbacks, WLC_TYPE_CALLBACK, NULL, NULL, 4, sizeof(struct wlc_resource)));
    return true;
 }
 
@@ -51,21 +74,21 @@ main(void)
       assert(wlc_resources_init());
 
       struct wlc_source source;
-      assert(wlc_source(&source, "test", constructor, destructor, 1, sizeof(struct wlc_resource)));
+      assert(wlc_source(&source, WLC_TYPE_VIEW, constructor, destructor, 1, sizeof(struct wlc_resource)));
 
       struct wlc_resource *ptr;
       assert(!constructor_called);
       assert((ptr = wlc_handle_create(&source)));
       assert(constructor_called);
-      assert(source.pool.items.count == 1);
+      assert(source.pool.count == 1);
 
       wlc_handle handle;
 #pragma GCC diagnostic ignored "-Wpointer-arith"
       assert(!convert_to_wlc_handle(NULL));
 #pragma GCC diagnostic warning "-Wpointer-arith"
       assert((handle = convert_to_wlc_handle(ptr)));
-      assert(!convert_from_wlc_handle(handle, "invalid"));
-      assert(convert_from_wlc_handle(handle, "test") == ptr);
+      assert(!convert_from_wlc_handle(handle, WLC_TYPE_OUTPUT));
+      assert(convert_from_wlc_handle(handle, WLC_TYPE_VIEW) == ptr);
 
       const char *test = "foobar";
       wlc_handle_set_user_data(handle, test);
@@ -74,10 +97,41 @@ main(void)
       assert(!destructor_called);
       wlc_handle_release(handle);
       assert(destructor_called);
-      assert(!convert_from_wlc_handle(handle, "invalid"));
-      assert(!convert_from_wlc_handle(handle, "test"));
+      assert(!convert_from_wlc_handle(handle, WLC_TYPE_OUTPUT));
+      assert(!convert_from_wlc_handle(handle, WLC_TYPE_VIEW));
       assert(!wlc_handle_get_user_data(handle));
-      assert(source.pool.items.count == 0);
+      assert(source.pool.count == 0);
+
+      wlc_source_release(&source);
+      wlc_resources_terminate();
+   }
+
+   // TEST: Stale handle does not alias object that reuses its slot
+   {
+      assert(wlc_resources_init());
+
+      struct wlc_source source;
+      assert(wlc_source(&source, WLC_TYPE_VIEW, constructor, destructor, 1, sizeof(struct wlc_resource)));
+
+      struct wlc_resource *ptr;
+      assert((ptr = wlc_handle_create(&source)));
+
+      wlc_handle handle;
+      assert((handle = convert_to_wlc_handle(ptr)));
+      wlc_handle_release(handle);
+
+      wlc_handle handle2;
+      assert((ptr = wlc_handle_create(&source)));
+      assert((handle2 = convert_to_wlc_handle(ptr)));
+      assert(handle2 != handle);
+      assert(!convert_from_wlc_handle(handle, WLC_TYPE_VIEW));
+      assert(convert_from_wlc_handle(handle2, WLC_TYPE_VIEW) == ptr);
+
+      // releasing stale handle must not release the new object
+      assert(!(destructor_called = false));
+      wlc_handle_release(handle);
+      assert(!destructor_called);
+      assert(convert_from_wlc_handle(handle2, WLC_TYPE_VIEW) == ptr);
 
       wlc_source_release(&source);
       wlc_resources_terminate();
@@ -88,11 +142,11 @@ main(void)
       assert(wlc_resources_init());
 
       struct wlc_source source;
-      assert(wlc_source(&source, "test", constructor, destructor, 1, sizeof(struct wlc_resource)));
+      assert(wlc_source(&source, WLC_TYPE_VIEW, constructor, destructor, 1, sizeof(struct wlc_resource)));
 
       struct wlc_resource *ptr;
       assert((ptr = wlc_handle_create(&source)));
-      assert(source.pool.items.count == 1);
+      assert(source.pool.count == 1);
 
       wlc_handle handle;
       assert((handle = convert_to_wlc_handle(ptr)));
@@ -101,8 +155,8 @@ main(void)
       wlc_source_release(&source);
       assert(destructor_called);
 
-      assert(source.pool.items.count == 0);
-      assert(!convert_from_wlc_handle(handle, "test"));
+      assert(source.pool.count == 0);
+      assert(!convert_from_wlc_handle(handle, WLC_TYPE_VIEW));
 
       wlc_resources_terminate();
    }
@@ -112,11 +166,11 @@ main(void)
       assert(wlc_resources_init());
 
       struct wlc_source source;
-      assert(wlc_source(&source, "test", constructor, destructor, 1, sizeof(struct wlc_resource)));
+      assert(wlc_source(&source, WLC_TYPE_VIEW, constructor, destructor, 1, sizeof(struct wlc_resource)));
 
       struct wlc_resource *ptr;
       assert((ptr = wlc_handle_create(&source)));
-      assert(source.pool.items.count == 1);
+      assert(source.pool.count == 1);
 
       wlc_handle handle;
       assert((handle = convert_to_wlc_handle(ptr)));
@@ -125,20 +179,20 @@ main(void)
       wlc_resources_terminate();
       assert(destructor_called);
 
-      assert(!convert_from_wlc_handle(handle, "test"));
+      assert(!convert_from_wlc_handle(handle, WLC_TYPE_VIEW));
       wlc_source_release(&source);
    }
 
-   // TEST: Relocation of source inside container of handle, when the handle's source changes location
+   // TEST: Source inside container of handle keeps its address, when the containing source grows
    {
       assert(wlc_resources_init());
 
       struct wlc_source source;
-      assert(wlc_source(&source, "test", constructor2, destructor2, 1, sizeof(struct contains_source)));
+      assert(wlc_source(&source, WLC_TYPE_VIEW, constructor2, destructor2, 1, sizeof(struct contains_source)));
 
       struct contains_source *ptr;
       assert((ptr = wlc_handle_create(&source)));
-      assert(source.pool.items.count == 1);
+      assert(source.pool.count == 1);
       void *original_source = &ptr->source;
 
       wlc_handle handle;
@@ -149,26 +203,24 @@ main(void)
 
       wlc_handle handle2;
       assert((handle2 = convert_to_wlc_handle(ptr2)));
-      assert(convert_from_wlc_handle(handle2, "test2") == ptr2);
-
-      // Play with heap until realloc does not return linear memory anymore
-      {
-         void *original = source.pool.items.buffer;
-         do {
-            void *garbage;
-            assert((garbage = malloc(1024)));
-            assert(wlc_handle_create(&source));
-            free(garbage);
-         } while (original == source.pool.items.buffer);
+      assert(convert_from_wlc_handle(handle2, WLC_TYPE_SURFACE) == ptr2);
+
+      // Grow well past the first chunk
+      for (uint32_t i = 0; i < 1024; ++i) {
+         void *garbage;
+         assert((garbage = malloc(1024)));
+         assert(wlc_handle_create(&source));
+         free(garbage);
       }
 
-      // So this should be true
-      assert(ptr = convert_from_wlc_handle(handle, "test"));
-      assert(original_source != &ptr->source);
+      // So nothing should have moved
+      assert(ptr = convert_from_wlc_handle(handle, WLC_TYPE_VIEW));
+      assert(original_source == &ptr->source);
+      assert(convert_from_wlc_handle(handle2, WLC_TYPE_SURFACE) == ptr2);
 
       wlc_resources_terminate();
 
-      assert(!convert_from_wlc_handle(handle2, "test2"));
+      assert(!convert_from_wlc_handle(handle2, WLC_TYPE_SURFACE));
       wlc_source_release(&source);
    }
 
@@ -181,7 +233,7 @@ main(void)
       };
 
       struct wlc_source source;
-      assert(wlc_source(&source, "test", constructor, destructor, 1024, sizeof(struct container)));
+      assert(wlc_source(&source, WLC_TYPE_VIEW, constructor, destructor, 1024, sizeof(struct container)));
 
       wlc_handle first = 0;
       const uint32_t iters = 0xFFFFF;
@@ -189,20 +241,67 @@ main(void)
          struct container *ptr = wlc_handle_create(&source);
          ptr->self = convert_to_wlc_handle(ptr);
          if (!first) first = ptr->self;
-         assert(convert_from_wlc_handle(first, "test"));
+         assert(convert_from_wlc_handle(first, WLC_TYPE_VIEW));
       }
-      assert(source.pool.items.count == iters);
+      assert(source.pool.count == iters);
 
       for (uint32_t i = iters / 2, d = iters / 2; i < iters; ++i, --d) {
-         assert(((struct container*)convert_from_wlc_handle(i + 1, "test"))->self == i + 1);
-         assert(((struct container*)convert_from_wlc_handle(d + 1, "test"))->self == d + 1);
+         assert(((struct container*)convert_from_wlc_handle(i + 1, WLC_TYPE_VIEW))->self == i + 1);
+         assert(((struct container*)convert_from_wlc_handle(d + 1, WLC_TYPE_VIEW))->self == d + 1);
          wlc_handle_release(i + 1);
          wlc_handle_release(d + 1);
       }
-      assert(source.pool.items.count == 0);
+      assert(source.pool.count == 0);
+
+      assert(!convert_from_wlc_handle(first, WLC_TYPE_VIEW));
+      wlc_source_release(&source);
+      wlc_resources_terminate();
+   }
+
+   // TEST: Benchmark (teardown of surfaces owning sources, while lots of unrelated handles are alive)
+   {
+      assert(wlc_resources_init());
+
+      struct wlc_source unrelated;
+      assert(wlc_source(&unrelated, WLC_TYPE_REGION, NULL, NULL, 1024, sizeof(struct wlc_resource)));
+
+      const uint32_t others = 0xFFFF;
+      for (uint32_t i = 0; i < others; ++i)
+         assert(wlc_handle_create(&unrelated));
+
+      struct wlc_source source;
+      assert(wlc_source(&source, WLC_TYPE_SURFACE, constructor3, destructor3, 32, sizeof(struct owns_sources)));
+
+      enum { surfaces = 1000 };
+      wlc_handle owners[surfaces];
+      for (uint32_t i = 0; i < surfaces; ++i) {
+         struct owns_sources *ptr;
+         assert((ptr = wlc_handle_create(&source)));
+         owners[i] = convert_to_wlc_handle(ptr);
+
+         for (uint32_t j = 0; j < 4; ++j) {
+            assert(wlc_handle_create(&ptr->buffers));
+            assert(wlc_handle_create(&ptr->callbacks));
+         }
+      }
+
+      struct timespec start, end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (uint32_t i = 0; i < surfaces; ++i)
+         wlc_handle_release(owners[i]);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      assert(source.pool.count == 0);
+      assert(unrelated.pool.count == others);
+      for (uint32_t i = 0; i < surfaces; ++i)
+         assert(!convert_from_wlc_handle(owners[i], WLC_TYPE_SURFACE));
+
+      const double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+      printf("Teardown of %u surfaces with %u other handles alive: %.3f ms\n", surfaces, others, ms);
 
-      assert(!convert_from_wlc_handle(first, "test"));
       wlc_source_release(&source);
+      wlc_source_release(&unrelated);
+      assert(unrelated.pool.count == 0);
       wlc_resources_terminate();
    }
 